@@ -28,14 +28,21 @@ DEFINES += \
 	SIGNALMONITOR_LIBRARY \
 	QT_DEPRECATED_WARNINGS #emit warnings if depracted Qt features are used
 
+include(src/signalmonitorcore.pri)
+
 SOURCES += \
 	src/thirdparty/qcustomplot/qcustomplot.cpp \
 	src/signalmonitor.cpp \
 	src/signalmonitorform.cpp \
-	src/bitdepthconverter.cpp \
 	src/imagedisplay.cpp \
+	src/frameitem.cpp \
 	src/scrollingplot.cpp \
-	src/imagemetriccalculator.cpp \
+	src/ratecontroller.cpp \
+	src/frameingest.cpp \
+	src/configurationstore.cpp \
+	src/flightrecorder.cpp \
+	src/replaysource.cpp \
+	src/pipelinestage.cpp \
 	src/overlayitems/anchorpoint.cpp \
 	src/overlayitems/overlayitem.cpp \
 	src/overlayitems/rectoverlay.cpp
@@ -44,11 +51,18 @@ HEADERS += \
 	src/thirdparty/qcustomplot/qcustomplot.h \
 	src/signalmonitor.h \
 	src/signalmonitorform.h \
-	src/signalmonitorparameters.h \
-	src/bitdepthconverter.h \
 	src/imagedisplay.h \
+	src/frameitem.h \
 	src/scrollingplot.h \
-	src/imagemetriccalculator.h \
+	src/ratecontroller.h \
+	src/ingeststatistics.h \
+	src/frameingest.h \
+	src/configurationstore.h \
+	src/flightrecorder.h \
+	src/replaysource.h \
+	src/boundedqueue.h \
+	src/triplebuffer.h \
+	src/pipelinestage.h \
 	src/overlayitems/anchorpoint.h \
 	src/overlayitems/overlayitem.h \
 	src/overlayitems/rectoverlay.h
@@ -1,64 +1,179 @@
 #include "bitdepthconverter.h"
-#include <QtMath>
+#include "tracer.h"
 
 
 BitDepthConverter::BitDepthConverter(QObject *parent) : QObject(parent)
 {
-	this->output8bitData = nullptr;
-	this->bitDepth = 0;
-	this->length = 0;
-	this->conversionRunning = false;
+	this->numberOfSlots.storeRelease(CONVERTER_DEFAULT_NUMBER_OF_SLOTS);
+	this->latencyMonitor = nullptr;
+	this->taskPool = nullptr;
+	this->pendingMapping = DisplayMapping::fullRange();
+	this->mappingVersion.storeRelease(0);
+	this->appliedMappingVersion = -1;
+	this->appliedBitDepth = 0;
+	this->fullRangeLinear = true;
+	this->linearConversion = LinearConversion::forBitDepth(16);
+	this->kernel = bestConversionKernel();
 }
 
 BitDepthConverter::~BitDepthConverter()
 {
-	if(this->output8bitData != nullptr){
-		free(this->output8bitData);
-	}
 }
 
-void BitDepthConverter::convertDataTo8bit(void *inputData, int bitDepth, int samplesPerLine, int linesPerFrame) {
-	if(!this->conversionRunning){
-		this->conversionRunning = true;
-		int length = samplesPerLine * linesPerFrame;
+bool BitDepthConverter::convertDataTo8bit(FrameDescriptor frame) {
+	TRACE_SCOPE("conversion");
+	TRACE_FLOW_END("frame to display", frame.handoffTimestamp);
+	int bitDepth = static_cast<int>(frame.bitDepth);
+	int samplesPerLine = static_cast<int>(frame.samplesPerLine);
+	int linesPerFrame = static_cast<int>(frame.linesPerFrame);
+	size_t length = static_cast<size_t>(samplesPerLine) * static_cast<size_t>(linesPerFrame);
+	if(bitDepth == 0 || bitDepth > 32 || length == 0){
+		emit error(tr("BitDepthConverter: Invalid data dimensions!"));
+		return false;
+	}
 
-		//check if new output8bitData-buffer needs to be created (due to resize or first time use)
-		if(this->output8bitData == nullptr || this->bitDepth != bitDepth || this->length != length){
-			if(bitDepth == 0 || length == 0){
-				emit error(tr("BitDepthConverter: Invalid data dimensions!"));
-				return;
-			}
-			this->bitDepth = bitDepth;
-			this->length = length;
-			if(this->output8bitData != nullptr){
-				free(this->output8bitData);
-				this->output8bitData = nullptr; //assign nullptr to avoid dangling pointer
-			}
-			this->output8bitData = static_cast<uchar*>(malloc(length*sizeof(uchar)));
-		}
-		//no conversion needed if inputData is already 8bit or below
-		if (bitDepth <= 8){
-			memcpy(this->output8bitData, inputData, length * sizeof(uchar));
+	//no conversion needed if inputData is already 8bit or below and the display mapping does not change it, the input frame is passed on as it is
+	this->updateLookupTable(frame.bitDepth);
+	if(bitDepth <= 8 && this->lookupTable.isIdentity()){
+		if(this->latencyMonitor != nullptr){
+			this->latencyMonitor->record(STAGE_CONVERSION, frame.handoffTimestamp, LatencyMonitor::now());
 		}
-		//convert to 8 bit element by element
-		else if (bitDepth >= 9 && bitDepth <=16){
-			float factor = 255 / (qPow(2,bitDepth) - 1);
-			for(int i=0; i<length; i++){
-				this->output8bitData[i] = static_cast<ushort*>(inputData)[i] * factor;
-				//this->output8bitData[i] = static_cast<uchar*>(inputData)[2*i+1]; //for 16 bit to 8 bit this is also possible
+		emit converted8bitData(frame);
+		return true;
+	}
+
+	//check if output slots need to be resized (due to resize or first time use). this is only possible while no converted frame is waiting for display,
+	//until then frames of a new size are dropped
+	int numberOfSlots = this->numberOfSlots.loadAcquire();
+	if(this->output8bitData.getBytesPerSlot() != length || this->output8bitData.getNumberOfSlots() != numberOfSlots){
+		if(!this->output8bitData.isIdle()){
+			if(this->output8bitData.getBytesPerSlot() != length){
+				return false;
 			}
+		}else if(!this->output8bitData.reserve(length, numberOfSlots)){
+			emit error(tr("BitDepthConverter: Could not allocate memory for converted frames!"));
+			return false;
 		}
-		else if (bitDepth > 16 && bitDepth <=32){
-			float factor = 255 / (qPow(2,bitDepth) - 1);
-			for(int i=0; i<length; i++){
-				this->output8bitData[i] = static_cast<unsigned int*>(inputData)[i] * factor;
+	}
+
+	//the number of slots covers the frames queued and processed by the render stage, so a free slot is only missing while slots are resized
+	int slot = this->output8bitData.acquire();
+	if(slot < 0){
+		return false;
+	}
+	uchar* output = static_cast<uchar*>(this->output8bitData.getSlot(slot));
+
+	//convert to 8 bit with one lookup per element or, for the linear mapping of the full range, with the vectorized kernels.
+	//the frame is split into tiles of lines that are converted in parallel by the task pool
+	if(bitDepth > 8 && this->fullRangeLinear){
+		if(bitDepth <= 16){
+			this->parallelForLines(linesPerFrame, samplesPerLine, [&](int firstLine, int endLine) {
+				this->convertLinesLinear<quint16>(frame, output, firstLine, endLine);
+			});
+		}else{
+			this->parallelForLines(linesPerFrame, samplesPerLine, [&](int firstLine, int endLine) {
+				this->convertLinesLinear<quint32>(frame, output, firstLine, endLine);
+			});
+		}
+	}else if(bitDepth <= 8){
+		this->parallelForLines(linesPerFrame, samplesPerLine, [&](int firstLine, int endLine) {
+			this->convertLines<uchar>(frame, output, firstLine, endLine);
+		});
+	}else if(bitDepth <= 16){
+		this->parallelForLines(linesPerFrame, samplesPerLine, [&](int firstLine, int endLine) {
+			this->convertLines<ushort>(frame, output, firstLine, endLine);
+		});
+	}else{
+		this->parallelForLines(linesPerFrame, samplesPerLine, [&](int firstLine, int endLine) {
+			this->convertLines<unsigned int>(frame, output, firstLine, endLine);
+		});
+	}
+
+	FrameDescriptor convertedFrame = frame;
+	convertedFrame.data = output;
+	convertedFrame.pool = &this->output8bitData;
+	convertedFrame.slot = slot;
+	convertedFrame.bitDepth = 8;
+	convertedFrame.bytesPerLine = frame.samplesPerLine;
+	if(this->latencyMonitor != nullptr){
+		this->latencyMonitor->record(STAGE_CONVERSION, frame.handoffTimestamp, LatencyMonitor::now());
+	}
+
+	//receivers that keep the converted frame retain it during the emit, the reference of acquire() is given up afterwards
+	emit converted8bitData(convertedFrame);
+	releaseFrame(convertedFrame);
+	return true;
+}
+
+void BitDepthConverter::setDisplayMapping(const DisplayMapping& mapping) {
+	QMutexLocker locker(&this->mappingMutex);
+	if(mapping == this->pendingMapping){
+		return;
+	}
+	this->pendingMapping = mapping;
+	this->mappingVersion.ref();
+}
+
+void BitDepthConverter::setConversionKernel(CONVERSION_KERNEL kernel) {
+	this->kernel = conversionKernelAvailable(kernel) ? kernel : KERNEL_SCALAR;
+}
+
+void BitDepthConverter::updateLookupTable(unsigned int bitDepth) {
+	//the table is only rebuilt if the display mapping or the bit depth changed, building it takes longer than converting a small frame
+	int version = this->mappingVersion.loadAcquire();
+	if(version == this->appliedMappingVersion && bitDepth == this->appliedBitDepth){
+		return;
+	}
+	this->mappingMutex.lock();
+	DisplayMapping mapping = this->pendingMapping;
+	version = this->mappingVersion.loadAcquire();
+	this->mappingMutex.unlock();
+	this->lookupTable.build(mapping, bitDepth);
+	this->fullRangeLinear = mapping.isFullRangeLinear();
+	this->linearConversion = LinearConversion::forBitDepth(bitDepth);
+	this->appliedMappingVersion = version;
+	this->appliedBitDepth = bitDepth;
+}
+
+template<typename Body>
+void BitDepthConverter::parallelForLines(int linesPerFrame, int samplesPerLine, const Body& body) {
+	int minimumLinesPerTask = qMax(1, CONVERTER_MINIMUM_SAMPLES_PER_TASK/qMax(1, samplesPerLine));
+	if(this->taskPool != nullptr){
+		this->taskPool->parallelFor(0, linesPerFrame, minimumLinesPerTask, [&body](int chunk, int begin, int end) {
+			Q_UNUSED(chunk)
+			body(begin, end);
+		});
+	}else{
+		body(0, linesPerFrame);
+	}
+}
+
+template<typename T>
+void BitDepthConverter::convertLines(const FrameDescriptor& frame, uchar* output, int firstLine, int endLine) {
+	const char* inputBytes = static_cast<const char*>(frame.data);
+	const uchar* table = this->lookupTable.getTable();
+	for(int line = firstLine; line < endLine; line++){
+		const T* input = reinterpret_cast<const T*>(inputBytes + static_cast<size_t>(line)*frame.bytesPerLine);
+		uchar* outputLine = output + static_cast<size_t>(line)*frame.samplesPerLine;
+		if(sizeof(T) <= 2){
+			//every possible sample has its own entry
+			for(unsigned int i = 0; i < frame.samplesPerLine; i++){
+				outputLine[i] = table[input[i]];
 			}
-		//do nothing if bit depth is out of range
 		}else{
-			return;
+			for(unsigned int i = 0; i < frame.samplesPerLine; i++){
+				outputLine[i] = table[this->lookupTable.getIndex(input[i])];
+			}
 		}
+	}
+}
 
-		emit converted8bitData(output8bitData, samplesPerLine, linesPerFrame);
-		this->conversionRunning = false;
+template<typename T>
+void BitDepthConverter::convertLinesLinear(const FrameDescriptor& frame, uchar* output, int firstLine, int endLine) {
+	const char* inputBytes = static_cast<const char*>(frame.data);
+	for(int line = firstLine; line < endLine; line++){
+		const T* input = reinterpret_cast<const T*>(inputBytes + static_cast<size_t>(line)*frame.bytesPerLine);
+		uchar* outputLine = output + static_cast<size_t>(line)*frame.samplesPerLine;
+		convertLinearTo8bit(input, outputLine, frame.samplesPerLine, this->linearConversion, this->kernel);
 	}
 }
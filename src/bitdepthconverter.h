@@ -2,6 +2,17 @@
 #define BITDEPTHCONVERTER_H
 
 #include <QObject>
+#include <QMutex>
+#include <QAtomicInteger>
+#include "latencymonitor.h"
+#include "framedescriptor.h"
+#include "taskpool.h"
+#include "framepool.h"
+#include "displaylookuptable.h"
+#include "conversionkernels.h"
+
+#define CONVERTER_MINIMUM_SAMPLES_PER_TASK 65536
+#define CONVERTER_DEFAULT_NUMBER_OF_SLOTS 3
 
 class BitDepthConverter : public QObject
 {
@@ -10,17 +21,38 @@ public:
 	explicit BitDepthConverter(QObject *parent = nullptr);
 	~BitDepthConverter();
 
+	void setLatencyMonitor(LatencyMonitor* latencyMonitor) {this->latencyMonitor = latencyMonitor;}
+	void setTaskPool(TaskPool* taskPool) {this->taskPool = taskPool;}
+	void setNumberOfSlots(int numberOfSlots) {this->numberOfSlots.storeRelease(qMax(1, numberOfSlots));} //may be called from any thread, the slots are resized with the next frame
+	void setDisplayMapping(const DisplayMapping& mapping); //may be called from any thread, the lookup table is rebuilt with the next frame
+	void setConversionKernel(CONVERSION_KERNEL kernel); //default: best kernel of the cpu. not thread safe, intended for validation and benchmarks
+	CONVERSION_KERNEL getConversionKernel() const {return this->kernel;}
+
 private:
-	uchar* output8bitData;
-	int bitDepth;
-	int length;
-	bool conversionRunning;
+	FramePool output8bitData;
+	QAtomicInteger<int> numberOfSlots;
+	LatencyMonitor* latencyMonitor;
+	TaskPool* taskPool;
+	QMutex mappingMutex;
+	DisplayMapping pendingMapping;
+	QAtomicInteger<int> mappingVersion;
+	int appliedMappingVersion;
+	unsigned int appliedBitDepth;
+	DisplayLookupTable lookupTable;
+	bool fullRangeLinear;
+	LinearConversion linearConversion;
+	CONVERSION_KERNEL kernel;
+
+	void updateLookupTable(unsigned int bitDepth);
+	template <typename Body> void parallelForLines(int linesPerFrame, int samplesPerLine, const Body& body);
+	template <typename T> void convertLines(const FrameDescriptor& frame, uchar* output, int firstLine, int endLine);
+	template <typename T> void convertLinesLinear(const FrameDescriptor& frame, uchar* output, int firstLine, int endLine);
 
 public slots:
-	void convertDataTo8bit(void *inputData, int bitDepth, int samplesPerLine, int linesPerFrame);
+	bool convertDataTo8bit(FrameDescriptor frame); //returns false if the frame was dropped
 
 signals:
-	void converted8bitData(uchar *output8bitData, unsigned int samplesPerLine, unsigned int linesPerFrame);
+	void converted8bitData(FrameDescriptor frame);
 	void info(QString);
 	void error(QString);
 };
@@ -0,0 +1,158 @@
+#ifndef BOUNDEDQUEUE_H
+#define BOUNDEDQUEUE_H
+
+#include <QtGlobal>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QList>
+#include <QVector>
+
+enum OVERFLOW_POLICY {
+	OVERFLOW_DROP_OLDEST, //a new item replaces the oldest queued item
+	OVERFLOW_DROP_NEWEST //a new item is rejected if the queue is full
+};
+
+struct QueueCounters {
+	quint64 enqueued;
+	quint64 dequeued;
+	quint64 dropped;
+	int depth;
+	int maximumDepth;
+	int capacity;
+};
+
+//thread safe fifo with a fixed capacity. items that do not fit are never silently lost: push() and setCapacity()
+//hand every dropped item back to the caller, so resources that belong to it can be released.
+//the items are stored in a ring that is allocated with the capacity, push() and pop() never allocate
+template <typename T>
+class BoundedQueue
+{
+public:
+	explicit BoundedQueue(int capacity = 1, OVERFLOW_POLICY policy = OVERFLOW_DROP_OLDEST)
+		: capacity(qMax(1, capacity)),
+		policy(policy),
+		enqueued(0),
+		dequeued(0),
+		dropped(0),
+		maximumDepth(0),
+		head(0),
+		count(0)
+	{
+		this->items.resize(this->capacity);
+	}
+
+	//returns false if item itself was dropped. if an older item was dropped instead, it is stored in droppedItem and hasDropped is set
+	bool push(const T& item, T* droppedItem, bool* hasDropped) {
+		QMutexLocker locker(&this->mutex);
+		*hasDropped = false;
+		if(this->count >= this->capacity){
+			this->dropped++;
+			if(this->policy == OVERFLOW_DROP_NEWEST){
+				return false;
+			}
+			*droppedItem = this->takeOldest();
+			*hasDropped = true;
+		}
+		this->items[(this->head + this->count) % this->capacity] = item;
+		this->count++;
+		this->enqueued++;
+		this->maximumDepth = qMax(this->maximumDepth, this->count);
+		return true;
+	}
+
+	bool pop(T* item) {
+		QMutexLocker locker(&this->mutex);
+		if(this->count == 0){
+			return false;
+		}
+		*item = this->takeOldest();
+		this->dequeued++;
+		return true;
+	}
+
+	//returns the items that do not fit into the new capacity, oldest first
+	QList<T> setCapacity(int capacity) {
+		QMutexLocker locker(&this->mutex);
+		QList<T> removedItems;
+		int newCapacity = qMax(1, capacity);
+		while(this->count > newCapacity){
+			removedItems.append(this->takeOldest());
+			this->dropped++;
+		}
+		QVector<T> remainingItems(newCapacity);
+		for(int i = 0; i < this->count; i++){
+			remainingItems[i] = this->items.at((this->head + i) % this->capacity);
+		}
+		this->items = remainingItems;
+		this->capacity = newCapacity;
+		this->head = 0;
+		return removedItems;
+	}
+
+	QList<T> clear() {
+		QMutexLocker locker(&this->mutex);
+		QList<T> removedItems;
+		while(this->count > 0){
+			removedItems.append(this->takeOldest());
+		}
+		return removedItems;
+	}
+
+	void setPolicy(OVERFLOW_POLICY policy) {
+		QMutexLocker locker(&this->mutex);
+		this->policy = policy;
+	}
+
+	OVERFLOW_POLICY getPolicy() const {
+		QMutexLocker locker(&this->mutex);
+		return this->policy;
+	}
+
+	bool isFull() const {
+		QMutexLocker locker(&this->mutex);
+		return this->count >= this->capacity;
+	}
+
+	bool isEmpty() const {
+		QMutexLocker locker(&this->mutex);
+		return this->count == 0;
+	}
+
+	int getCapacity() const {
+		QMutexLocker locker(&this->mutex);
+		return this->capacity;
+	}
+
+	QueueCounters getCounters() const {
+		QMutexLocker locker(&this->mutex);
+		QueueCounters counters;
+		counters.enqueued = this->enqueued;
+		counters.dequeued = this->dequeued;
+		counters.dropped = this->dropped;
+		counters.depth = this->count;
+		counters.maximumDepth = this->maximumDepth;
+		counters.capacity = this->capacity;
+		return counters;
+	}
+
+private:
+	mutable QMutex mutex;
+	QVector<T> items;
+	int capacity;
+	OVERFLOW_POLICY policy;
+	quint64 enqueued;
+	quint64 dequeued;
+	quint64 dropped;
+	int maximumDepth;
+	int head; //index of the oldest item
+	int count;
+
+	T takeOldest() {
+		T item = this->items.at(this->head);
+		this->head = (this->head + 1) % this->capacity;
+		this->count--;
+		return item;
+	}
+};
+
+#endif //BOUNDEDQUEUE_H
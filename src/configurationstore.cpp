@@ -0,0 +1,67 @@
+#include "configurationstore.h"
+#include <QThread>
+#include <string.h>
+
+
+ConfigurationStore::ConfigurationStore()
+	: sequence(0),
+	version(0)
+{
+	MonitorConfiguration initialConfiguration;
+	memset(&initialConfiguration, 0, sizeof(initialConfiguration));
+	initialConfiguration.version = 0;
+	initialConfiguration.bufferSource = PROCESSED;
+	initialConfiguration.imageMetric = AVERAGE;
+	initialConfiguration.roi = QRect(50, 50, 400, 800);
+	initialConfiguration.frameNr = 0;
+	initialConfiguration.bufferNr = -1;
+	initialConfiguration.flightRecorderTrigger = TRIGGER_OFF;
+	initialConfiguration.flightRecorderThreshold = 0.0;
+	this->store(initialConfiguration);
+}
+
+ConfigurationStore::~ConfigurationStore() {
+}
+
+MonitorConfiguration ConfigurationStore::getSnapshot() const {
+	quint64 copy[CONFIGURATIONSTORE_WORDS];
+	while(true){
+		quint64 sequenceBefore = this->sequence.loadAcquire();
+		if((sequenceBefore & 1) == 0){
+			for(size_t i = 0; i < CONFIGURATIONSTORE_WORDS; i++){
+				copy[i] = this->words[i].loadAcquire();
+			}
+			if(this->sequence.loadAcquire() == sequenceBefore){
+				break;
+			}
+		}
+		//the gui thread is publishing, it needs a few nanoseconds unless it was preempted itself
+		QThread::yieldCurrentThread();
+	}
+	MonitorConfiguration configuration;
+	memcpy(&configuration, copy, sizeof(configuration));
+	return configuration;
+}
+
+quint64 ConfigurationStore::publish(const MonitorConfiguration& configuration) {
+	this->version++;
+	MonitorConfiguration newConfiguration = configuration;
+	newConfiguration.version = this->version;
+	this->store(newConfiguration);
+	return this->version;
+}
+
+void ConfigurationStore::store(const MonitorConfiguration& configuration) {
+	//the padding of the last word is zero, so the copy in getSnapshot() never reads an uninitialized value
+	quint64 copy[CONFIGURATIONSTORE_WORDS] = {};
+	memcpy(copy, &configuration, sizeof(configuration));
+
+	//odd sequence number while the words are written. every word is stored with release semantics, so a reader that
+	//sees a new word also sees the odd sequence number when it checks again
+	quint64 sequenceBefore = this->sequence.loadAcquire();
+	this->sequence.storeRelease(sequenceBefore + 1);
+	for(size_t i = 0; i < CONFIGURATIONSTORE_WORDS; i++){
+		this->words[i].storeRelease(copy[i]);
+	}
+	this->sequence.storeRelease(sequenceBefore + 2);
+}
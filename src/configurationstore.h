@@ -0,0 +1,44 @@
+#ifndef CONFIGURATIONSTORE_H
+#define CONFIGURATIONSTORE_H
+
+#include <QtGlobal>
+#include <QRect>
+#include <QAtomicInteger>
+#include "signalmonitorparameters.h"
+
+//settings that are used in the signal chain. a published configuration is never modified. it is copied word by word, so it has to stay trivially copyable
+struct MonitorConfiguration {
+	quint64 version;
+	BUFFER_SOURCE bufferSource;
+	IMAGE_METRIC imageMetric;
+	QRect roi;
+	int frameNr;
+	int bufferNr;
+	FLIGHTRECORDER_TRIGGER flightRecorderTrigger;
+	double flightRecorderThreshold;
+};
+
+#define CONFIGURATIONSTORE_WORDS ((sizeof(MonitorConfiguration) + sizeof(quint64) - 1)/sizeof(quint64))
+
+//publishes versioned configuration snapshots with a sequence lock over an inline copy, nothing is allocated or freed.
+//getSnapshot() is lock free and may be called from any thread: it copies the words of the snapshot and retries if the
+//sequence number shows that publish() ran meanwhile (odd: a publish is in progress, changed: a publish finished).
+//publish() must be called from a single thread (the gui thread). a reader that is preempted during the copy only retries
+class ConfigurationStore
+{
+public:
+	ConfigurationStore();
+	~ConfigurationStore();
+
+	MonitorConfiguration getSnapshot() const;
+	quint64 publish(const MonitorConfiguration& configuration);
+
+private:
+	QAtomicInteger<quint64> sequence;
+	QAtomicInteger<quint64> words[CONFIGURATIONSTORE_WORDS];
+	quint64 version;
+
+	void store(const MonitorConfiguration& configuration);
+};
+
+#endif //CONFIGURATIONSTORE_H
@@ -0,0 +1,227 @@
+#include "conversionkernels.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CONVERSIONKERNELS_SSE2
+#include <emmintrin.h>
+#endif
+
+//avx2 kernels are compiled with a target attribute (gcc, clang) or without special flags (msvc) and only called if the cpu supports them
+#if defined(CONVERSIONKERNELS_SSE2) && (defined(__x86_64__) || defined(_M_X64)) && (defined(__GNUC__) || defined(_MSC_VER))
+#define CONVERSIONKERNELS_AVX2
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define CONVERSIONKERNELS_TARGET_AVX2
+#else
+#define CONVERSIONKERNELS_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+
+LinearConversion LinearConversion::forBitDepth(unsigned int bitDepth) {
+	LinearConversion conversion;
+	conversion.bitDepth = qBound(9u, bitDepth, 32u);
+	conversion.maxValue = conversion.bitDepth == 32 ? 0xFFFFFFFFu : (1u << conversion.bitDepth) - 1u;
+	conversion.multiplier = 0;
+	conversion.shift = 0;
+	if(conversion.bitDepth <= 16){
+		//largest shift whose rounded up reciprocal 255*2^(16+shift)/maxValue still fits into 16 bit.
+		//this is exact for all samples from 0 to maxValue for every bit depth from 9 to 16
+		while(((255ull << (16 + conversion.shift + 1))/conversion.maxValue) + 1 < 65536){
+			conversion.shift++;
+		}
+		conversion.multiplier = static_cast<quint16>(((255ull << (16 + conversion.shift))/conversion.maxValue) + 1);
+	}
+	return conversion;
+}
+
+static inline void convertScalar16(const quint16* input, uchar* output, size_t count, const LinearConversion& conversion) {
+	quint32 maxValue = conversion.maxValue;
+	quint32 multiplier = conversion.multiplier;
+	int shift = 16 + conversion.shift;
+	for(size_t i = 0; i < count; i++){
+		quint32 sample = qMin(static_cast<quint32>(input[i]), maxValue);
+		output[i] = static_cast<uchar>((sample*multiplier) >> shift);
+	}
+}
+
+static inline void convertScalar32(const quint32* input, uchar* output, size_t count, const LinearConversion& conversion) {
+	quint32 maxValue = conversion.maxValue;
+	unsigned int bitDepth = conversion.bitDepth;
+	for(size_t i = 0; i < count; i++){
+		quint64 x = static_cast<quint64>(qMin(input[i], maxValue))*255u;
+		output[i] = static_cast<uchar>((x + (x >> bitDepth) + 1) >> bitDepth);
+	}
+}
+
+#ifdef CONVERSIONKERNELS_SSE2
+static void convertSse2_16(const quint16* input, uchar* output, size_t count, const LinearConversion& conversion) {
+	__m128i maxValue = _mm_set1_epi16(static_cast<short>(conversion.maxValue));
+	__m128i multiplier = _mm_set1_epi16(static_cast<short>(conversion.multiplier));
+	__m128i shift = _mm_cvtsi32_si128(conversion.shift);
+	size_t i = 0;
+	for(; i + 16 <= count; i += 16){
+		__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i));
+		__m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i + 8));
+		//unsigned minimum without sse4.1: a - saturated(a - maxValue)
+		a = _mm_sub_epi16(a, _mm_subs_epu16(a, maxValue));
+		b = _mm_sub_epi16(b, _mm_subs_epu16(b, maxValue));
+		a = _mm_srl_epi16(_mm_mulhi_epu16(a, multiplier), shift);
+		b = _mm_srl_epi16(_mm_mulhi_epu16(b, multiplier), shift);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(output + i), _mm_packus_epi16(a, b));
+	}
+	convertScalar16(input + i, output + i, count - i, conversion);
+}
+
+static inline __m128i convertSse2Vector32(__m128i samples, __m128i maxValue, __m128i signedMaxValue, __m128i factor, __m128i shift) {
+	//unsigned minimum without sse4.1: compare with flipped sign bits
+	__m128i above = _mm_cmpgt_epi32(_mm_xor_si128(samples, _mm_set1_epi32(static_cast<int>(0x80000000u))), signedMaxValue);
+	samples = _mm_or_si128(_mm_andnot_si128(above, samples), _mm_and_si128(above, maxValue));
+	//sample*255 of the even and the odd lanes in 64 bit, then the division by 2^bitDepth-1
+	__m128i one = _mm_set_epi32(0, 1, 0, 1);
+	__m128i even = _mm_mul_epu32(samples, factor);
+	__m128i odd = _mm_mul_epu32(_mm_srli_epi64(samples, 32), factor);
+	even = _mm_srl_epi64(_mm_add_epi64(_mm_add_epi64(even, _mm_srl_epi64(even, shift)), one), shift);
+	odd = _mm_srl_epi64(_mm_add_epi64(_mm_add_epi64(odd, _mm_srl_epi64(odd, shift)), one), shift);
+	return _mm_or_si128(even, _mm_slli_epi64(odd, 32));
+}
+
+static void convertSse2_32(const quint32* input, uchar* output, size_t count, const LinearConversion& conversion) {
+	__m128i maxValue = _mm_set1_epi32(static_cast<int>(conversion.maxValue));
+	__m128i signedMaxValue = _mm_set1_epi32(static_cast<int>(conversion.maxValue ^ 0x80000000u));
+	__m128i factor = _mm_set1_epi32(255);
+	__m128i shift = _mm_cvtsi32_si128(static_cast<int>(conversion.bitDepth));
+	size_t i = 0;
+	for(; i + 16 <= count; i += 16){
+		__m128i a = convertSse2Vector32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i)), maxValue, signedMaxValue, factor, shift);
+		__m128i b = convertSse2Vector32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i + 4)), maxValue, signedMaxValue, factor, shift);
+		__m128i c = convertSse2Vector32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i + 8)), maxValue, signedMaxValue, factor, shift);
+		__m128i d = convertSse2Vector32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i + 12)), maxValue, signedMaxValue, factor, shift);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(output + i), _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d)));
+	}
+	convertScalar32(input + i, output + i, count - i, conversion);
+}
+#endif
+
+#ifdef CONVERSIONKERNELS_AVX2
+CONVERSIONKERNELS_TARGET_AVX2 static void convertAvx2_16(const quint16* input, uchar* output, size_t count, const LinearConversion& conversion) {
+	__m256i maxValue = _mm256_set1_epi16(static_cast<short>(conversion.maxValue));
+	__m256i multiplier = _mm256_set1_epi16(static_cast<short>(conversion.multiplier));
+	__m128i shift = _mm_cvtsi32_si128(conversion.shift);
+	size_t i = 0;
+	for(; i + 32 <= count; i += 32){
+		__m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(input + i));
+		__m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(input + i + 16));
+		a = _mm256_srl_epi16(_mm256_mulhi_epu16(_mm256_min_epu16(a, maxValue), multiplier), shift);
+		b = _mm256_srl_epi16(_mm256_mulhi_epu16(_mm256_min_epu16(b, maxValue), multiplier), shift);
+		//packus works within the 128 bit lanes, the permutation restores the order of the samples
+		__m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), 0xD8);
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(output + i), packed);
+	}
+	convertScalar16(input + i, output + i, count - i, conversion);
+}
+
+CONVERSIONKERNELS_TARGET_AVX2 static inline __m256i convertAvx2Vector32(__m256i samples, __m256i maxValue, __m256i factor, __m128i shift) {
+	samples = _mm256_min_epu32(samples, maxValue);
+	__m256i one = _mm256_set1_epi64x(1);
+	__m256i even = _mm256_mul_epu32(samples, factor);
+	__m256i odd = _mm256_mul_epu32(_mm256_srli_epi64(samples, 32), factor);
+	even = _mm256_srl_epi64(_mm256_add_epi64(_mm256_add_epi64(even, _mm256_srl_epi64(even, shift)), one), shift);
+	odd = _mm256_srl_epi64(_mm256_add_epi64(_mm256_add_epi64(odd, _mm256_srl_epi64(odd, shift)), one), shift);
+	return _mm256_or_si256(even, _mm256_slli_epi64(odd, 32));
+}
+
+CONVERSIONKERNELS_TARGET_AVX2 static void convertAvx2_32(const quint32* input, uchar* output, size_t count, const LinearConversion& conversion) {
+	__m256i maxValue = _mm256_set1_epi32(static_cast<int>(conversion.maxValue));
+	__m256i factor = _mm256_set1_epi32(255);
+	__m128i shift = _mm_cvtsi32_si128(static_cast<int>(conversion.bitDepth));
+	__m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+	size_t i = 0;
+	for(; i + 32 <= count; i += 32){
+		__m256i a = convertAvx2Vector32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(input + i)), maxValue, factor, shift);
+		__m256i b = convertAvx2Vector32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(input + i + 8)), maxValue, factor, shift);
+		__m256i c = convertAvx2Vector32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(input + i + 16)), maxValue, factor, shift);
+		__m256i d = convertAvx2Vector32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(input + i + 24)), maxValue, factor, shift);
+		//both packs work within the 128 bit lanes, every 32 bit element holds 4 neighbouring samples afterwards
+		__m256i packed = _mm256_packus_epi16(_mm256_packs_epi32(a, b), _mm256_packs_epi32(c, d));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(output + i), _mm256_permutevar8x32_epi32(packed, order));
+	}
+	convertScalar32(input + i, output + i, count - i, conversion);
+}
+
+static bool cpuSupportsAvx2() {
+#ifdef _MSC_VER
+	//avx2 needs the cpu feature and the operating system has to save the ymm registers
+	int info[4];
+	__cpuid(info, 0);
+	if(info[0] < 7){
+		return false;
+	}
+	__cpuid(info, 1);
+	bool osxsave = (info[2] & (1 << 27)) != 0;
+	if(!osxsave || (_xgetbv(0) & 6) != 6){
+		return false;
+	}
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+#else
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2");
+#endif
+}
+#endif
+
+CONVERSION_KERNEL bestConversionKernel() {
+	//evaluated once, the cpu does not change while the process runs
+	static const CONVERSION_KERNEL kernel = conversionKernelAvailable(KERNEL_AVX2) ? KERNEL_AVX2 : (conversionKernelAvailable(KERNEL_SSE2) ? KERNEL_SSE2 : KERNEL_SCALAR);
+	return kernel;
+}
+
+bool conversionKernelAvailable(CONVERSION_KERNEL kernel) {
+	switch(kernel){
+		case KERNEL_SCALAR: return true;
+#ifdef CONVERSIONKERNELS_SSE2
+		case KERNEL_SSE2: return true;
+#endif
+#ifdef CONVERSIONKERNELS_AVX2
+		case KERNEL_AVX2: {
+			static const bool avx2 = cpuSupportsAvx2();
+			return avx2;
+		}
+#endif
+		default: return false;
+	}
+}
+
+const char* conversionKernelName(CONVERSION_KERNEL kernel) {
+	switch(kernel){
+		case KERNEL_SCALAR: return "scalar";
+		case KERNEL_SSE2: return "sse2";
+		case KERNEL_AVX2: return "avx2";
+		default: return "unknown";
+	}
+}
+
+void convertLinearTo8bit(const quint16* input, uchar* output, size_t count, const LinearConversion& conversion, CONVERSION_KERNEL kernel) {
+	switch(kernel){
+#ifdef CONVERSIONKERNELS_AVX2
+		case KERNEL_AVX2: convertAvx2_16(input, output, count, conversion); break;
+#endif
+#ifdef CONVERSIONKERNELS_SSE2
+		case KERNEL_SSE2: convertSse2_16(input, output, count, conversion); break;
+#endif
+		default: convertScalar16(input, output, count, conversion); break;
+	}
+}
+
+void convertLinearTo8bit(const quint32* input, uchar* output, size_t count, const LinearConversion& conversion, CONVERSION_KERNEL kernel) {
+	switch(kernel){
+#ifdef CONVERSIONKERNELS_AVX2
+		case KERNEL_AVX2: convertAvx2_32(input, output, count, conversion); break;
+#endif
+#ifdef CONVERSIONKERNELS_SSE2
+		case KERNEL_SSE2: convertSse2_32(input, output, count, conversion); break;
+#endif
+		default: convertScalar32(input, output, count, conversion); break;
+	}
+}
@@ -0,0 +1,35 @@
+#ifndef CONVERSIONKERNELS_H
+#define CONVERSIONKERNELS_H
+
+#include <QtGlobal>
+#include <stddef.h>
+
+enum CONVERSION_KERNEL {
+	KERNEL_SCALAR,
+	KERNEL_SSE2,
+	KERNEL_AVX2,
+	NUMBER_OF_CONVERSION_KERNELS
+};
+
+//constants of the linear mapping of the full range of a bit depth (9 - 32 bit) to 8 bit: floor(sample*255/(2^bitDepth-1)),
+//samples above the range are shown as 255. the result is exact, no float arithmetic is involved:
+//up to 16 bit the division is a 16 bit multiplication with a rounded up reciprocal followed by a shift,
+//above 16 bit the division by 2^bitDepth-1 is (x + (x >> bitDepth) + 1) >> bitDepth with x = sample*255 in 64 bit
+struct LinearConversion {
+	unsigned int bitDepth;
+	quint32 maxValue;
+	quint16 multiplier; //up to 16 bit
+	int shift; //up to 16 bit
+
+	static LinearConversion forBitDepth(unsigned int bitDepth);
+};
+
+//vectorized kernels for the linear full range conversion. the best kernel of the cpu is selected at runtime,
+//every other available kernel can be selected explicitly, e.g. for validation and benchmarks
+CONVERSION_KERNEL bestConversionKernel();
+bool conversionKernelAvailable(CONVERSION_KERNEL kernel);
+const char* conversionKernelName(CONVERSION_KERNEL kernel);
+void convertLinearTo8bit(const quint16* input, uchar* output, size_t count, const LinearConversion& conversion, CONVERSION_KERNEL kernel);
+void convertLinearTo8bit(const quint32* input, uchar* output, size_t count, const LinearConversion& conversion, CONVERSION_KERNEL kernel);
+
+#endif //CONVERSIONKERNELS_H
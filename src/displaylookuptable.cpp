@@ -0,0 +1,73 @@
+#include "displaylookuptable.h"
+#include <cmath>
+
+
+DisplayLookupTable::DisplayLookupTable()
+	: table(DISPLAY_LOOKUP_TABLE_SIZE, 0),
+	offset(0),
+	shift(0),
+	identity(false)
+{
+}
+
+void DisplayLookupTable::build(const DisplayMapping& mapping, unsigned int bitDepth) {
+	double low = 0;
+	double high = 0;
+	getRange(mapping, bitDepth, &low, &high);
+	double maxValue = std::ldexp(1.0, static_cast<int>(bitDepth)) - 1.0;
+
+	//samples with more than 16 bit: only the window needs the resolution of the table, everything above it is 255 anyway
+	this->offset = 0;
+	this->shift = 0;
+	if(bitDepth > 16){
+		double firstSample = qBound(0.0, std::floor(low), maxValue);
+		double lastSample = qBound(firstSample, std::ceil(high), maxValue);
+		this->offset = static_cast<quint32>(firstSample);
+		quint32 span = static_cast<quint32>(lastSample) - this->offset;
+		while((span >> this->shift) >= DISPLAY_LOOKUP_TABLE_SIZE){
+			this->shift++;
+		}
+	}
+
+	uchar* entries = this->table.data();
+	for(int i = 0; i < DISPLAY_LOOKUP_TABLE_SIZE; i++){
+		entries[i] = mapSample(static_cast<double>(this->offset) + std::ldexp(static_cast<double>(i), this->shift), mapping, low, high);
+	}
+
+	//8 bit frames are passed on without conversion if the mapping would not change them
+	this->identity = bitDepth <= 8;
+	for(int i = 0; this->identity && i < 256; i++){
+		this->identity = entries[i] == i;
+	}
+}
+
+void DisplayLookupTable::getRange(const DisplayMapping& mapping, unsigned int bitDepth, double* low, double* high) {
+	if(mapping.window > 0){
+		*low = mapping.level - mapping.window/2.0;
+		*high = mapping.level + mapping.window/2.0;
+	}else{
+		*low = 0;
+		*high = std::ldexp(1.0, static_cast<int>(bitDepth)) - 1.0;
+	}
+}
+
+uchar DisplayLookupTable::mapSample(double sample, const DisplayMapping& mapping, double low, double high) {
+	if(high <= low){
+		return sample >= high ? 255 : 0;
+	}
+	double value = 0;
+	if(mapping.isLinear()){
+		//scaled before the division, so the full range of the bit depth maps exactly like floor(sample*255/maxValue)
+		value = std::floor((sample - low)*255.0/(high - low));
+	}else{
+		double t = qBound(0.0, (sample - low)/(high - low), 1.0);
+		if(mapping.logarithmic){
+			t = std::log1p(t*(DISPLAY_LOG_RANGE - 1.0))/std::log(DISPLAY_LOG_RANGE);
+		}
+		if(mapping.gamma > 0 && mapping.gamma != 1.0){
+			t = std::pow(t, 1.0/mapping.gamma);
+		}
+		value = std::floor(t*255.0);
+	}
+	return static_cast<uchar>(qBound(0.0, value, 255.0));
+}
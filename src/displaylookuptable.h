@@ -0,0 +1,60 @@
+#ifndef DISPLAYLOOKUPTABLE_H
+#define DISPLAYLOOKUPTABLE_H
+
+#include <QtGlobal>
+#include <QVector>
+
+#define DISPLAY_LOOKUP_TABLE_SIZE 65536
+#define DISPLAY_LOG_RANGE 1000.0 //dynamic range of the logarithmic mapping, the lowest displayed value is shown 1/1000 of full scale above black
+
+//mapping of the samples of a frame to the 8 bit display. samples from level-window/2 to level+window/2 are mapped to 0 - 255,
+//samples outside this range are clamped. a window of 0 or below displays the full range of the bit depth
+struct DisplayMapping {
+	double level;
+	double window;
+	double gamma; //exponent 1/gamma is applied, values above 1 brighten dark areas
+	bool logarithmic;
+
+	static DisplayMapping fullRange() {
+		DisplayMapping mapping = {0.0, 0.0, 1.0, false};
+		return mapping;
+	}
+	bool isLinear() const {return !this->logarithmic && (this->gamma == 1.0 || this->gamma <= 0);}
+	bool isFullRangeLinear() const {return this->window <= 0 && this->isLinear();}
+	bool operator==(const DisplayMapping& other) const {
+		return this->level == other.level && this->window == other.window && this->gamma == other.gamma && this->logarithmic == other.logarithmic;
+	}
+	bool operator!=(const DisplayMapping& other) const {return !(*this == other);}
+};
+
+//precomputed 8 bit value of every sample, so the conversion of a frame is one table lookup per pixel.
+//samples with up to 16 bit index the table directly. samples with more bits are offset to the lower end of the window
+//and shifted right until the window fits into the table, every entry then covers 2^shift neighbouring samples
+class DisplayLookupTable
+{
+public:
+	DisplayLookupTable();
+
+	void build(const DisplayMapping& mapping, unsigned int bitDepth);
+	bool isIdentity() const {return this->identity;}
+	const uchar* getTable() const {return this->table.constData();}
+	quint32 getOffset() const {return this->offset;}
+	int getShift() const {return this->shift;}
+
+	inline int getIndex(quint32 sample) const {
+		quint32 index = sample > this->offset ? (sample - this->offset) >> this->shift : 0;
+		return index < DISPLAY_LOOKUP_TABLE_SIZE ? static_cast<int>(index) : DISPLAY_LOOKUP_TABLE_SIZE-1;
+	}
+	quint32 getFirstSampleOfIndex(int index) const {return this->offset + (static_cast<quint32>(index) << this->shift);}
+
+	static void getRange(const DisplayMapping& mapping, unsigned int bitDepth, double* low, double* high);
+	static uchar mapSample(double sample, const DisplayMapping& mapping, double low, double high);
+
+private:
+	QVector<uchar> table;
+	quint32 offset;
+	int shift;
+	bool identity;
+};
+
+#endif //DISPLAYLOOKUPTABLE_H
@@ -0,0 +1,282 @@
+#include "flightrecorder.h"
+#include "latencymonitor.h"
+#include <QFile>
+#include <QDir>
+#include <QDateTime>
+#include <QtMath>
+#include <cstring>
+
+
+FlightRecorderWriter::FlightRecorderWriter(FlightRecorder* recorder)
+	: QThread(),
+	recorder(recorder)
+{
+	this->setObjectName("Signal Monitor flight recorder");
+}
+
+void FlightRecorderWriter::run() {
+	this->recorder->writerLoop();
+}
+
+
+FlightRecorder::FlightRecorder(QObject* parent)
+	: QObject(parent),
+	activeRing(0),
+	source(RAW),
+	numberOfFrames(0),
+	bytesPerSample(FLIGHTRECORDER_DEFAULT_BYTES_PER_SAMPLE),
+	samplesPerFrame(0),
+	bytesPerFrame(0),
+	folder(QDir::tempPath()),
+	writer(nullptr),
+	dumpPending(false),
+	dumpRunning(false),
+	stopping(false),
+	ringPreparing(false),
+	geometryOutdated(false),
+	pendingRing(0),
+	pendingTriggerTimestamp(0),
+	pendingTriggerTimeMsSinceEpoch(0)
+{
+	for(Ring& ring : this->rings){
+		ring.next = 0;
+		ring.count = 0;
+	}
+}
+
+FlightRecorder::~FlightRecorder() {
+	//a dump that was already triggered is still written
+	if(this->writer != nullptr){
+		this->mutex.lock();
+		this->stopping = true;
+		this->wakeUp.wakeAll();
+		this->mutex.unlock();
+		this->writer->wait();
+		delete this->writer;
+	}
+}
+
+void FlightRecorder::setRecording(BUFFER_SOURCE source, int numberOfFrames, size_t samplesPerFrame) {
+	//samplesPerFrame: size of the roi, the slots only need to hold the roi clipped to the frame
+	this->mutex.lock();
+	this->source.storeRelease(source);
+	this->numberOfFrames.storeRelease(qMax(0, numberOfFrames));
+	this->samplesPerFrame = samplesPerFrame;
+	this->mutex.unlock();
+	this->applyGeometry();
+}
+
+void FlightRecorder::maintain() {
+	//called periodically in the gui thread, adapts the slots to a changed sample size of the recorded frames
+	this->applyGeometry();
+}
+
+void FlightRecorder::applyGeometry() {
+	//gui thread only. the geometry is taken under the lock, the rings are resized without it, so capture() is not stalled by the allocation
+	this->mutex.lock();
+	int numberOfFrames = this->numberOfFrames.loadAcquire();
+	size_t bytesPerFrame = this->samplesPerFrame*static_cast<size_t>(this->bytesPerSample.loadAcquire());
+	if(!this->geometryOutdated && numberOfFrames == this->rings[this->activeRing].headers.size() && bytesPerFrame == this->bytesPerFrame){
+		this->mutex.unlock();
+		return;
+	}
+	this->bytesPerFrame = bytesPerFrame;
+
+	//the frozen ring of a running dump keeps its geometry, the writer adapts it after the dump and the next call swaps it in
+	this->geometryOutdated = this->dumpPending || this->dumpRunning;
+	if(this->geometryOutdated){
+		this->mutex.unlock();
+		return;
+	}
+	this->ringPreparing = true;
+	int inactiveRing = 1-this->activeRing;
+	this->mutex.unlock();
+
+	//frames of the old geometry are discarded: the prepared ring takes over empty and the former active ring is resized afterwards
+	this->prepareRing(&this->rings[inactiveRing], bytesPerFrame, numberOfFrames);
+	this->mutex.lock();
+	this->rings[inactiveRing].next = 0;
+	this->rings[inactiveRing].count = 0;
+	this->activeRing = inactiveRing;
+	this->mutex.unlock();
+	this->prepareRing(&this->rings[1-inactiveRing], bytesPerFrame, numberOfFrames);
+
+	QMutexLocker locker(&this->mutex);
+	this->ringPreparing = false;
+}
+
+void FlightRecorder::setFolder(QString folder) {
+	QMutexLocker locker(&this->mutex);
+	this->folder = folder;
+}
+
+void FlightRecorder::capture(const FrameDescriptor& frame) {
+	if(this->numberOfFrames.loadAcquire() <= 0 || frame.data == nullptr || static_cast<int>(frame.source) != this->source.loadAcquire()){
+		return;
+	}
+
+	//only the roi is kept, clipped to the frame
+	int firstSample = qMax(0, frame.roi.x());
+	int endSample = qMin(static_cast<int>(frame.samplesPerLine), frame.roi.x()+frame.roi.width());
+	int firstLine = qMax(0, frame.roi.y());
+	int endLine = qMin(static_cast<int>(frame.linesPerFrame), frame.roi.y()+frame.roi.height());
+	if(endSample <= firstSample || endLine <= firstLine){
+		return;
+	}
+	size_t bytesPerSample = static_cast<size_t>(qCeil(static_cast<double>(frame.bitDepth)/8.0));
+	size_t bytesPerRoiLine = static_cast<size_t>(endSample-firstSample)*bytesPerSample;
+	size_t dataSize = bytesPerRoiLine*static_cast<size_t>(endLine-firstLine);
+	if(static_cast<int>(bytesPerSample) != this->bytesPerSample.loadAcquire()){
+		this->bytesPerSample.storeRelease(static_cast<int>(bytesPerSample));
+	}
+
+	QMutexLocker locker(&this->mutex);
+	Ring& ring = this->rings[this->activeRing];
+	int numberOfSlots = ring.headers.size();
+	if(numberOfSlots == 0 || dataSize > ring.data.getBytesPerSlot()){
+		return;
+	}
+	char* destination = static_cast<char*>(ring.data.getSlot(ring.next));
+	const char* source = static_cast<const char*>(frame.data) + static_cast<size_t>(firstSample)*bytesPerSample;
+	for(int line = firstLine; line < endLine; line++){
+		memcpy(destination, source + static_cast<size_t>(line)*frame.bytesPerLine, bytesPerRoiLine);
+		destination += bytesPerRoiLine;
+	}
+	FlightRecordFrameHeader& header = ring.headers[ring.next];
+	header.sequenceNumber = frame.sequenceNumber;
+	header.configurationVersion = frame.configurationVersion;
+	header.acquisitionTimestamp = frame.acquisitionTimestamp;
+	header.source = static_cast<quint32>(frame.source);
+	header.bitDepth = frame.bitDepth;
+	header.bufferNr = frame.bufferNr;
+	header.frameNr = frame.frameNr;
+	header.roiX = firstSample;
+	header.roiY = firstLine;
+	header.roiWidth = endSample-firstSample;
+	header.roiHeight = endLine-firstLine;
+	header.bytesPerSample = static_cast<quint32>(bytesPerSample);
+	header.dataSize = static_cast<quint32>(dataSize);
+	ring.next = (ring.next+1)%numberOfSlots;
+	ring.count = qMin(ring.count+1, numberOfSlots);
+}
+
+bool FlightRecorder::trigger(QString reason) {
+	QMutexLocker locker(&this->mutex);
+	Ring& ring = this->rings[this->activeRing];
+	if(this->dumpPending || this->dumpRunning || ring.count == 0){
+		return false;
+	}
+
+	//the full ring is handed to the writer, the other ring takes over. it was allocated with the same geometry by setRecording() or after the last dump
+	Ring& nextRing = this->rings[1-this->activeRing];
+	if(this->ringPreparing || nextRing.headers.isEmpty()){
+		return false;
+	}
+	nextRing.next = 0;
+	nextRing.count = 0;
+	this->pendingRing = this->activeRing;
+	this->activeRing = 1-this->activeRing;
+	this->pendingTriggerTimestamp = LatencyMonitor::now();
+	this->pendingTriggerTimeMsSinceEpoch = QDateTime::currentMSecsSinceEpoch();
+	QString timeString = QDateTime::fromMSecsSinceEpoch(this->pendingTriggerTimeMsSinceEpoch).toString("yyyyMMdd_hhmmss_zzz");
+	this->pendingFileName = QDir(this->folder).filePath("flightrecord_" + timeString + ".sfr");
+	this->pendingReason = reason;
+	this->dumpPending = true;
+	if(this->writer == nullptr){
+		this->writer = new FlightRecorderWriter(this);
+		this->writer->start(QThread::LowPriority);
+	}
+	this->wakeUp.wakeAll();
+	return true;
+}
+
+bool FlightRecorder::prepareRing(Ring* ring, size_t bytesPerSlot, int numberOfSlots) {
+	if(ring->data.getBytesPerSlot() == bytesPerSlot && ring->headers.size() == numberOfSlots){
+		return true;
+	}
+	if(numberOfSlots <= 0 || bytesPerSlot == 0 || !ring->data.reserve(bytesPerSlot, numberOfSlots)){
+		//turned off (or out of memory): the memory of the ring is given back
+		ring->data.release();
+		ring->headers.clear();
+		ring->count = 0;
+		return false;
+	}
+	//frames of the old geometry are discarded
+	ring->headers.fill(FlightRecordFrameHeader(), numberOfSlots);
+	ring->next = 0;
+	ring->count = 0;
+	return true;
+}
+
+void FlightRecorder::writerLoop() {
+	forever{
+		this->mutex.lock();
+		while(!this->dumpPending && !this->stopping){
+			this->wakeUp.wait(&this->mutex);
+		}
+		if(!this->dumpPending){
+			this->mutex.unlock();
+			break;
+		}
+		//the frozen ring is not touched by capture() or trigger() until the dump is finished
+		int frozenRing = this->pendingRing;
+		this->dumpPending = false;
+		this->dumpRunning = true;
+		QString fileName = this->pendingFileName;
+		QString reason = this->pendingReason;
+		qint64 triggerTimestamp = this->pendingTriggerTimestamp;
+		qint64 triggerTimeMsSinceEpoch = this->pendingTriggerTimeMsSinceEpoch;
+		this->mutex.unlock();
+
+		const Ring& ring = this->rings[frozenRing];
+		if(this->writeRing(ring, fileName, triggerTimestamp, triggerTimeMsSinceEpoch)){
+			emit dumped(fileName, ring.count, reason);
+		}else{
+			emit error(tr("Could not write flight record to ") + fileName);
+		}
+
+		//the geometry may have changed during the dump. the frozen ring is adapted before it is released, capture() and trigger()
+		//do not touch it until then, so the mutex is not held while memory is allocated
+		forever{
+			this->mutex.lock();
+			size_t bytesPerFrame = this->bytesPerFrame;
+			int numberOfFrames = this->numberOfFrames.loadAcquire();
+			this->mutex.unlock();
+			this->prepareRing(&this->rings[frozenRing], bytesPerFrame, numberOfFrames);
+			QMutexLocker locker(&this->mutex);
+			if(bytesPerFrame == this->bytesPerFrame && numberOfFrames == this->numberOfFrames.loadAcquire()){
+				this->dumpRunning = false;
+				break;
+			}
+		}
+	}
+}
+
+bool FlightRecorder::writeRing(const Ring& ring, QString fileName, qint64 triggerTimestamp, qint64 triggerTimeMsSinceEpoch) {
+	QFile file(fileName);
+	if(!file.open(QFile::WriteOnly|QFile::Truncate)){
+		return false;
+	}
+	FlightRecordFileHeader fileHeader;
+	memset(&fileHeader, 0, sizeof(FlightRecordFileHeader));
+	memcpy(fileHeader.magic, FLIGHTRECORDER_MAGIC, sizeof(fileHeader.magic));
+	fileHeader.formatVersion = FLIGHTRECORDER_FORMAT_VERSION;
+	fileHeader.headerSize = sizeof(FlightRecordFileHeader);
+	fileHeader.frameHeaderSize = sizeof(FlightRecordFrameHeader);
+	fileHeader.numberOfFrames = static_cast<quint32>(ring.count);
+	fileHeader.triggerTimestamp = triggerTimestamp;
+	fileHeader.triggerTimeMsSinceEpoch = triggerTimeMsSinceEpoch;
+	bool ok = file.write(reinterpret_cast<const char*>(&fileHeader), sizeof(FlightRecordFileHeader)) == sizeof(FlightRecordFileHeader);
+
+	//oldest frame first
+	int numberOfSlots = ring.headers.size();
+	int first = ring.count < numberOfSlots ? 0 : ring.next;
+	for(int i = 0; ok && i < ring.count; i++){
+		int slot = (first+i)%numberOfSlots;
+		const FlightRecordFrameHeader& header = ring.headers.at(slot);
+		ok = file.write(reinterpret_cast<const char*>(&header), sizeof(FlightRecordFrameHeader)) == sizeof(FlightRecordFrameHeader);
+		ok = ok && file.write(static_cast<const char*>(ring.data.getSlot(slot)), header.dataSize) == static_cast<qint64>(header.dataSize);
+	}
+	file.close();
+	return ok;
+}
@@ -0,0 +1,127 @@
+#ifndef FLIGHTRECORDER_H
+#define FLIGHTRECORDER_H
+
+#include <QObject>
+#include <QString>
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QVector>
+#include "framearena.h"
+#include "framedescriptor.h"
+
+#define FLIGHTRECORDER_MAGIC "OCTPZSFR"
+#define FLIGHTRECORDER_FORMAT_VERSION 1
+#define FLIGHTRECORDER_DEFAULT_NUMBER_OF_FRAMES 64
+#define FLIGHTRECORDER_DEFAULT_BYTES_PER_SAMPLE 2 //until the first frame was captured
+
+//a flight record file starts with this header, followed by numberOfFrames frames (oldest first).
+//every frame is a FlightRecordFrameHeader followed by dataSize bytes of roi data (roiWidth samples per line, roiHeight lines)
+struct FlightRecordFileHeader {
+	char magic[8];
+	quint32 formatVersion;
+	quint32 headerSize;
+	quint32 frameHeaderSize;
+	quint32 numberOfFrames;
+	qint64 triggerTimestamp; //LatencyMonitor::now() when the recorder was triggered
+	qint64 triggerTimeMsSinceEpoch;
+};
+
+struct FlightRecordFrameHeader {
+	quint64 sequenceNumber;
+	quint64 configurationVersion;
+	qint64 acquisitionTimestamp;
+	quint32 source; //BUFFER_SOURCE
+	quint32 bitDepth;
+	quint32 bufferNr;
+	quint32 frameNr;
+	qint32 roiX; //roi clipped to the frame
+	qint32 roiY;
+	qint32 roiWidth;
+	qint32 roiHeight;
+	quint32 bytesPerSample;
+	quint32 dataSize;
+};
+
+static_assert(sizeof(FlightRecordFileHeader) == 40, "FlightRecordFileHeader must not contain padding");
+static_assert(sizeof(FlightRecordFrameHeader) == 64, "FlightRecordFrameHeader must not contain padding");
+
+class FlightRecorder;
+
+class FlightRecorderWriter : public QThread
+{
+public:
+	explicit FlightRecorderWriter(FlightRecorder* recorder);
+
+protected:
+	void run() override;
+
+private:
+	FlightRecorder* recorder;
+};
+
+//keeps the roi of the last frames of one source in a ring of preallocated slots. trigger() freezes the ring and a background thread
+//writes it to a new file in the output folder, while new frames are captured into a second ring. capture() and trigger()
+//may be called from any thread, they never allocate: both rings are allocated by setRecording() and maintain() in the gui thread
+//(or by the background thread for the frozen ring, after its dump). a new geometry is reserved in the inactive ring without holding the lock
+//and swapped in afterwards, during a dump the active ring keeps its geometry until the dump is finished.
+//the slots are sized for the sample size of the last captured frame, frames that do not fit are not recorded until the next maintain().
+//a trigger is ignored while the previous dump is still being written.
+class FlightRecorder : public QObject
+{
+	Q_OBJECT
+public:
+	explicit FlightRecorder(QObject* parent = nullptr);
+	~FlightRecorder();
+
+	void setRecording(BUFFER_SOURCE source, int numberOfFrames, size_t samplesPerFrame);
+	void maintain();
+	void setFolder(QString folder);
+	bool isEnabled() const {return this->numberOfFrames.loadAcquire() > 0;}
+
+	void capture(const FrameDescriptor& frame);
+	bool trigger(QString reason);
+
+private:
+	friend class FlightRecorderWriter;
+
+	struct Ring {
+		FrameArena data;
+		QVector<FlightRecordFrameHeader> headers;
+		int next;
+		int count;
+	};
+
+	Ring rings[2];
+	int activeRing;
+	QAtomicInteger<int> source; //BUFFER_SOURCE of the recorded frames
+	QAtomicInteger<int> numberOfFrames;
+	QAtomicInteger<int> bytesPerSample; //of the last captured frame
+	size_t samplesPerFrame;
+	size_t bytesPerFrame;
+	QString folder;
+	QMutex mutex;
+	QWaitCondition wakeUp;
+	FlightRecorderWriter* writer;
+	bool dumpPending;
+	bool dumpRunning;
+	bool stopping;
+	bool ringPreparing; //the inactive ring is resized by the gui thread, trigger() must not swap it in
+	bool geometryOutdated; //the geometry changed during a dump, the active ring is swapped after the dump
+	int pendingRing;
+	QString pendingFileName;
+	QString pendingReason;
+	qint64 pendingTriggerTimestamp;
+	qint64 pendingTriggerTimeMsSinceEpoch;
+
+	void applyGeometry();
+	bool prepareRing(Ring* ring, size_t bytesPerSlot, int numberOfSlots);
+	void writerLoop();
+	bool writeRing(const Ring& ring, QString fileName, qint64 triggerTimestamp, qint64 triggerTimeMsSinceEpoch);
+
+signals:
+	void dumped(QString fileName, int numberOfFrames, QString reason);
+	void error(QString);
+};
+
+#endif //FLIGHTRECORDER_H
@@ -0,0 +1,121 @@
+#include "framearena.h"
+#include <string.h>
+
+#ifdef Q_OS_LINUX
+#include <sys/mman.h>
+#endif
+
+
+FrameArena::FrameArena()
+	: memory(nullptr),
+	capacity(0),
+	bytesPerSlot(0),
+	slotStride(0),
+	numberOfSlots(0),
+	hugePagesEnabled(false),
+	memoryIsMapped(false)
+{
+}
+
+FrameArena::~FrameArena() {
+	this->release();
+}
+
+bool FrameArena::reserve(size_t bytesPerSlot, int numberOfSlots) {
+	if(bytesPerSlot == 0 || numberOfSlots <= 0){
+		return false;
+	}
+
+	//keep existing memory if the requested slots fit into it
+	size_t slotStride = roundUp(bytesPerSlot, FRAMEARENA_ALIGNMENT);
+	size_t requiredSize = slotStride*static_cast<size_t>(numberOfSlots);
+	if(requiredSize > this->capacity){
+		this->release();
+		if(!this->allocate(requiredSize)){
+			return false;
+		}
+	}
+
+	this->bytesPerSlot = bytesPerSlot;
+	this->slotStride = slotStride;
+	this->numberOfSlots = numberOfSlots;
+	return true;
+}
+
+void* FrameArena::getSlot(int index) const {
+	if(this->memory == nullptr || index < 0 || index >= this->numberOfSlots){
+		return nullptr;
+	}
+	return this->memory + this->slotStride*static_cast<size_t>(index);
+}
+
+void FrameArena::release() {
+	if(this->memory != nullptr){
+#ifdef Q_OS_LINUX
+		if(this->memoryIsMapped){
+			munmap(this->memory, this->capacity);
+		}else{
+			qFreeAligned(this->memory);
+		}
+#else
+		qFreeAligned(this->memory);
+#endif
+		this->memory = nullptr;
+	}
+	this->capacity = 0;
+	this->bytesPerSlot = 0;
+	this->slotStride = 0;
+	this->numberOfSlots = 0;
+	this->memoryIsMapped = false;
+}
+
+bool FrameArena::allocate(size_t size) {
+#ifdef Q_OS_LINUX
+	//large arenas are mapped at huge page granularity and marked as candidates for transparent huge pages.
+	//mmap only guarantees page alignment, so one huge page more is mapped and the unaligned head and tail are unmapped again
+	if(this->hugePagesEnabled && size >= FRAMEARENA_HUGE_PAGE_SIZE){
+		size_t mappedSize = roundUp(size, FRAMEARENA_HUGE_PAGE_SIZE);
+		void* mapped = mmap(nullptr, mappedSize + FRAMEARENA_HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if(mapped != MAP_FAILED){
+			char* base = static_cast<char*>(mapped);
+			char* aligned = reinterpret_cast<char*>(roundUp(reinterpret_cast<size_t>(base), FRAMEARENA_HUGE_PAGE_SIZE));
+			size_t head = static_cast<size_t>(aligned - base);
+			size_t tail = FRAMEARENA_HUGE_PAGE_SIZE - head;
+			if(head > 0){
+				munmap(base, head);
+			}
+			if(tail > 0){
+				munmap(aligned + mappedSize, tail);
+			}
+			madvise(aligned, mappedSize, MADV_HUGEPAGE);
+			this->memory = aligned;
+			this->capacity = mappedSize;
+			this->memoryIsMapped = true;
+			prefault(this->memory, this->capacity);
+			return true;
+		}
+	}
+#endif
+	this->memory = static_cast<char*>(qMallocAligned(size, FRAMEARENA_ALIGNMENT));
+	if(this->memory == nullptr){
+		return false;
+	}
+	this->capacity = size;
+	this->memoryIsMapped = false;
+	prefault(this->memory, this->capacity);
+	return true;
+}
+
+void FrameArena::prefault(char* memory, size_t size) {
+	//write one byte per page to make the operating system back the whole arena with physical memory now and not during the first copy
+	for(size_t i = 0; i < size; i += FRAMEARENA_PAGE_SIZE){
+		memory[i] = 0;
+	}
+	if(size > 0){
+		memory[size-1] = 0;
+	}
+}
+
+size_t FrameArena::roundUp(size_t value, size_t multiple) {
+	return ((value + multiple - 1)/multiple)*multiple;
+}
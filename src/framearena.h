@@ -0,0 +1,42 @@
+#ifndef FRAMEARENA_H
+#define FRAMEARENA_H
+
+#include <QtGlobal>
+#include <stddef.h>
+
+#define FRAMEARENA_ALIGNMENT 64
+#define FRAMEARENA_PAGE_SIZE 4096
+#define FRAMEARENA_HUGE_PAGE_SIZE (2*1024*1024)
+
+//one contiguous block of memory that is split into equally sized, 64 byte aligned frame slots.
+//the capacity only grows: if the frame size changes and the new slots still fit, the existing memory is reused.
+//newly allocated memory is pre-faulted, so the first copy after a resize does not trigger page faults.
+class FrameArena
+{
+public:
+	FrameArena();
+	~FrameArena();
+
+	bool reserve(size_t bytesPerSlot, int numberOfSlots);
+	void* getSlot(int index) const;
+	int getNumberOfSlots() const {return this->numberOfSlots;}
+	size_t getBytesPerSlot() const {return this->bytesPerSlot;}
+	size_t getCapacity() const {return this->capacity;}
+	void setHugePagesEnabled(bool enabled) {this->hugePagesEnabled = enabled;}
+	void release();
+
+private:
+	char* memory;
+	size_t capacity;
+	size_t bytesPerSlot;
+	size_t slotStride;
+	int numberOfSlots;
+	bool hugePagesEnabled;
+	bool memoryIsMapped;
+
+	bool allocate(size_t size);
+	static void prefault(char* memory, size_t size);
+	static size_t roundUp(size_t value, size_t multiple);
+};
+
+#endif //FRAMEARENA_H
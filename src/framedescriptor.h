@@ -0,0 +1,103 @@
+#ifndef FRAMEDESCRIPTOR_H
+#define FRAMEDESCRIPTOR_H
+
+#include <QtGlobal>
+#include <QMetaType>
+#include <QAtomicInteger>
+#include "signalmonitorparameters.h"
+
+class FramePool;
+
+//describes one frame that was copied by a FrameIngest. the descriptor is passed by value through all stages,
+//data points to a slot of a FramePool and stays valid as long as the stage that holds the descriptor keeps a reference
+struct FrameDescriptor {
+	void* data;
+	FramePool* pool; //pool that owns data, frames in a pool are reference counted (see framepool.h)
+	int slot;
+	quint64 sequenceNumber; //number of the frame within its source, the first emitted frame has number 1
+	BUFFER_SOURCE source;
+	unsigned int bitDepth;
+	unsigned int samplesPerLine;
+	unsigned int linesPerFrame;
+	unsigned int bytesPerLine; //stride between two lines in data
+	unsigned int bufferNr; //buffer of the volume the frame was taken from
+	unsigned int frameNr; //frame of the buffer the frame was taken from
+	quint64 configurationVersion; //version of the configuration snapshot the frame was selected with
+	IMAGE_METRIC imageMetric; //metric and roi of that snapshot
+	QRect roi;
+	qint64 acquisitionTimestamp; //LatencyMonitor::now() at the entry of the acquisition callback
+	qint64 handoffTimestamp; //LatencyMonitor::now() when the copy was emitted
+};
+Q_DECLARE_METATYPE(FrameDescriptor)
+
+enum SEQUENCE_EVENT {
+	SEQUENCE_IN_ORDER,
+	SEQUENCE_GAP,
+	SEQUENCE_DUPLICATE,
+	SEQUENCE_OUT_OF_ORDER
+};
+
+struct SequenceCounters {
+	quint64 inOrder;
+	quint64 gaps;
+	quint64 missingFrames;
+	quint64 duplicates;
+	quint64 outOfOrder;
+
+	quint64 errors() const {return this->gaps + this->duplicates + this->outOfOrder;}
+};
+
+//detects stale, duplicated and out of order frames at a consumer. check() must always be called from the same thread,
+//the counters can be read from any thread. a change of the frame source restarts the sequence without counting a gap
+class SequenceChecker
+{
+public:
+	SequenceChecker() : lastSource(-1), lastSequenceNumber(0), inOrder(0), gaps(0), missingFrames(0), duplicates(0), outOfOrder(0) {}
+
+	SEQUENCE_EVENT check(const FrameDescriptor& frame) {
+		if(static_cast<int>(frame.source) != this->lastSource || this->lastSequenceNumber == 0){
+			this->lastSource = static_cast<int>(frame.source);
+			this->lastSequenceNumber = frame.sequenceNumber;
+			this->inOrder.fetchAndAddRelaxed(1);
+			return SEQUENCE_IN_ORDER;
+		}
+		if(frame.sequenceNumber == this->lastSequenceNumber+1){
+			this->lastSequenceNumber = frame.sequenceNumber;
+			this->inOrder.fetchAndAddRelaxed(1);
+			return SEQUENCE_IN_ORDER;
+		}
+		if(frame.sequenceNumber > this->lastSequenceNumber){
+			this->missingFrames.fetchAndAddRelaxed(frame.sequenceNumber - this->lastSequenceNumber - 1);
+			this->lastSequenceNumber = frame.sequenceNumber;
+			this->gaps.fetchAndAddRelaxed(1);
+			return SEQUENCE_GAP;
+		}
+		if(frame.sequenceNumber == this->lastSequenceNumber){
+			this->duplicates.fetchAndAddRelaxed(1);
+			return SEQUENCE_DUPLICATE;
+		}
+		this->outOfOrder.fetchAndAddRelaxed(1);
+		return SEQUENCE_OUT_OF_ORDER;
+	}
+
+	SequenceCounters getCounters() const {
+		SequenceCounters counters;
+		counters.inOrder = this->inOrder.loadAcquire();
+		counters.gaps = this->gaps.loadAcquire();
+		counters.missingFrames = this->missingFrames.loadAcquire();
+		counters.duplicates = this->duplicates.loadAcquire();
+		counters.outOfOrder = this->outOfOrder.loadAcquire();
+		return counters;
+	}
+
+private:
+	int lastSource;
+	quint64 lastSequenceNumber;
+	QAtomicInteger<quint64> inOrder;
+	QAtomicInteger<quint64> gaps;
+	QAtomicInteger<quint64> missingFrames;
+	QAtomicInteger<quint64> duplicates;
+	QAtomicInteger<quint64> outOfOrder;
+};
+
+#endif //FRAMEDESCRIPTOR_H
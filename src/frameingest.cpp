@@ -0,0 +1,239 @@
+#include "frameingest.h"
+#include "streamingcopy.h"
+#include "tracer.h"
+#include "threadtuning.h"
+#include <QtMath>
+#include <string.h>
+
+
+FrameIngest::FrameIngest(BUFFER_SOURCE source, QObject *parent)
+	: QObject(parent),
+	source(source),
+	requestedNumberOfSlots(FRAMEINGEST_DEFAULT_NUMBER_OF_SLOTS),
+	streamingCopyEnabled(0),
+	acquisitionCores(0),
+	dimensionsOutdated(0),
+	latencyMonitor(nullptr),
+	configuration(nullptr),
+	downstreamStage(nullptr),
+	activeFrameBuffers(0),
+	slotPreparation(SLOTS_IDLE),
+	preparedBytesPerFrame(0),
+	preparedNumberOfSlots(0),
+	taskPool(nullptr),
+	sequenceNumber(0),
+	framesPerBuffer(0),
+	buffersPerVolume(0)
+{
+	for(FramePool& frameBuffers : this->frameBuffers){
+		frameBuffers.setHugePagesEnabled(true);
+	}
+}
+
+void FrameIngest::receiveBuffer(void* buffer, unsigned int bitDepth, unsigned int samplesPerLine, unsigned int linesPerFrame, unsigned int framesPerBuffer, unsigned int buffersPerVolume, unsigned int currentBufferNr, bool grabbingAllowed) {
+	//timestamp of the callback entry, the ingest and end to end latencies include the frame selection below
+	qint64 acquisitionTimestamp = LatencyMonitor::now();
+	this->recordAcquisitionCore();
+	if(!grabbingAllowed || this->configuration == nullptr){
+		this->statistics.countDropped(DROP_DISABLED);
+		return;
+	}
+
+	//all settings for this buffer are taken from one snapshot, so a settings change can not tear the frame selection or the metric calculation
+	MonitorConfiguration config = this->configuration->getSnapshot();
+	bool liveSource = this->source == RAW || this->source == PROCESSED;
+	if(!(config.bufferSource == this->source || (config.bufferSource == RAW_AND_PROCESSED && liveSource))){
+		this->statistics.countDropped(DROP_DISABLED);
+		return;
+	}
+
+	//check if current buffer is selected. If it is not selected discard it and do nothing (just return).
+	int bufferNr = qMin(config.bufferNr, static_cast<int>(buffersPerVolume-1));
+	if(!(bufferNr == -1 || bufferNr == static_cast<int>(currentBufferNr))){
+		this->statistics.countDropped(DROP_WRONG_BUFFER);
+		return;
+	}
+
+	//check if this buffer should be used according to target update rate and current processing load.
+	//a full downstream queue slows down the rate with either policy. with OVERFLOW_DROP_NEWEST the frame would be rejected and is not copied,
+	//with OVERFLOW_DROP_OLDEST it is still taken and replaces the oldest queued one
+	bool consumersBusy = this->downstreamStage != nullptr && this->downstreamStage->isFull();
+	bool busyConsumersRejectFrame = consumersBusy && this->downstreamStage->getPolicy() == OVERFLOW_DROP_NEWEST;
+	RateController::Decision decision = this->rateController.acceptFrame(consumersBusy, busyConsumersRejectFrame);
+	if(decision == RateController::SKIP){
+		this->statistics.countSkipped();
+		return;
+	}
+	if(decision == RateController::BUSY){
+		this->statistics.countDropped(DROP_BUSY);
+		return;
+	}
+	TRACE_SCOPE("ingest");
+
+	//calculate size of single frame
+	size_t bytesPerSample = static_cast<size_t>(ceil(static_cast<double>(bitDepth)/8.0));
+	size_t bytesPerFrame = samplesPerLine*linesPerFrame*bytesPerSample;
+
+	//check if number of frames per buffer has changed and emit maxFrames to update gui.
+	//after a source change the dimensions are sent again, because the gui may show the dimensions of another source
+	if(this->dimensionsOutdated.testAndSetOrdered(1, 0)){
+		this->framesPerBuffer = 0;
+		this->buffersPerVolume = 0;
+	}
+	if(this->framesPerBuffer != framesPerBuffer){
+		emit maxFrames(framesPerBuffer-1);
+		this->framesPerBuffer = framesPerBuffer;
+	}
+	//check if number of buffers per volume has changed and emit maxBuffers to update gui
+	if(this->buffersPerVolume != buffersPerVolume){
+		emit maxBuffers(buffersPerVolume-1);
+		this->buffersPerVolume = buffersPerVolume;
+	}
+
+	//check if buffer size or slot count changed. the copy buffers are not allocated here, a pool with the new geometry is prepared
+	//in the task pool. frames of a new size are dropped until it is ready, with only a new slot count the old slots are used meanwhile
+	int numberOfSlots = this->requestedNumberOfSlots.loadAcquire();
+	FramePool* frameBuffers = &this->frameBuffers[this->activeFrameBuffers];
+	if(frameBuffers->getBytesPerSlot() != bytesPerFrame || frameBuffers->getNumberOfSlots() != numberOfSlots){
+		if(bitDepth == 0 || samplesPerLine == 0 || linesPerFrame == 0 || framesPerBuffer == 0){
+			emit error(tr("Invalid data dimensions!"));
+			return;
+		}
+		if(this->swapFrameBuffers(bytesPerFrame, numberOfSlots)){
+			frameBuffers = &this->frameBuffers[this->activeFrameBuffers];
+		}else if(frameBuffers->getBytesPerSlot() != bytesPerFrame){
+			this->statistics.countDropped(DROP_BUSY);
+			return;
+		}
+	}
+
+	//all slots are still held by stages that did not process their frames yet
+	int slot = frameBuffers->acquire();
+	if(slot < 0){
+		this->statistics.countDropped(DROP_BUSY);
+		return;
+	}
+
+	//copy single frame of received data and emit it for further processing
+	void* copyBuffer = frameBuffers->getSlot(slot);
+	char* frameInBuffer = static_cast<char*>(buffer);
+	int frameNr = qBound(0, config.frameNr, static_cast<int>(framesPerBuffer-1));
+	{
+		//memcpy by default. the streaming copy keeps the caches of the OCTproZ thread clean but is slower on most systems, it is opt-in
+		TRACE_SCOPE("copy");
+		if(this->streamingCopyEnabled.loadAcquire()){
+			streamingCopy(copyBuffer, &(frameInBuffer[bytesPerFrame*frameNr]), bytesPerFrame);
+		}else{
+			memcpy(copyBuffer, &(frameInBuffer[bytesPerFrame*frameNr]), bytesPerFrame);
+		}
+	}
+	this->sequenceNumber++;
+	FrameDescriptor frame;
+	frame.data = copyBuffer;
+	frame.pool = frameBuffers;
+	frame.slot = slot;
+	frame.sequenceNumber = this->sequenceNumber;
+	frame.source = this->source;
+	frame.bitDepth = bitDepth;
+	frame.samplesPerLine = samplesPerLine;
+	frame.linesPerFrame = linesPerFrame;
+	frame.bytesPerLine = static_cast<unsigned int>(samplesPerLine*bytesPerSample);
+	frame.bufferNr = currentBufferNr;
+	frame.frameNr = static_cast<unsigned int>(frameNr);
+	frame.configurationVersion = config.version;
+	frame.imageMetric = config.imageMetric;
+	frame.roi = config.roi;
+	frame.acquisitionTimestamp = acquisitionTimestamp;
+
+	frame.handoffTimestamp = LatencyMonitor::now();
+	if(this->latencyMonitor != nullptr){
+		this->latencyMonitor->record(STAGE_INGEST, frame.acquisitionTimestamp, frame.handoffTimestamp);
+	}
+	TRACE_FLOW_BEGIN("frame to metric", frame.handoffTimestamp);
+	TRACE_FLOW_BEGIN("frame to display", frame.handoffTimestamp);
+	//receivers that keep the frame take their own reference while the signal is delivered (direct connection), the reference of acquire() is given up afterwards
+	emit newFrame(frame);
+	releaseFrame(frame);
+
+	this->statistics.countAccepted();
+}
+
+bool FrameIngest::swapFrameBuffers(size_t bytesPerFrame, int numberOfSlots) {
+	//called in the acquisition thread. returns true if the prepared pool was swapped in, otherwise its preparation is requested if needed
+	int state = this->slotPreparation.loadAcquire();
+	bool requested = this->preparedBytesPerFrame == bytesPerFrame && this->preparedNumberOfSlots == numberOfSlots;
+	if(state == SLOTS_READY && requested){
+		//the pool that was active so far keeps its frames until the stages release them
+		this->activeFrameBuffers = 1-this->activeFrameBuffers;
+		this->slotPreparation.storeRelease(SLOTS_IDLE);
+		return true;
+	}
+	if(state == SLOTS_PREPARING || (state == SLOTS_FAILED && requested)){
+		return false;
+	}
+	//the gui thread may have claimed the inactive pool to release its memory in the meantime
+	if(!this->slotPreparation.testAndSetOrdered(state, SLOTS_PREPARING)){
+		return false;
+	}
+	this->preparedBytesPerFrame = bytesPerFrame;
+	this->preparedNumberOfSlots = numberOfSlots;
+	if(this->taskPool != nullptr){
+		this->taskPool->submit([this]() {
+			this->prepareFrameBuffers();
+		});
+	}else{
+		this->prepareFrameBuffers();
+	}
+	return false;
+}
+
+void FrameIngest::prepareFrameBuffers() {
+	//runs in the task pool. the inactive pool can only be resized after the stages released all frames of the size before the last change,
+	//until then the preparation is requested again with every new frame
+	TRACE_SCOPE("prepare frame buffers");
+	FramePool* frameBuffers = &this->frameBuffers[1-this->activeFrameBuffers];
+	if(!frameBuffers->isIdle()){
+		this->slotPreparation.storeRelease(SLOTS_IDLE);
+		return;
+	}
+	if(!frameBuffers->reserve(this->preparedBytesPerFrame, this->preparedNumberOfSlots)){
+		emit error(tr("Could not allocate memory for frame buffers!"));
+		this->slotPreparation.storeRelease(SLOTS_FAILED);
+		return;
+	}
+	this->slotPreparation.storeRelease(SLOTS_READY);
+}
+
+void FrameIngest::releaseUnusedFrameBuffers() {
+	//called periodically in the gui thread. the memory of the pool that was swapped out is given back as soon as its frames are released
+	if(!this->slotPreparation.testAndSetOrdered(SLOTS_IDLE, SLOTS_PREPARING)){
+		return;
+	}
+	FramePool* frameBuffers = &this->frameBuffers[1-this->activeFrameBuffers];
+	if(frameBuffers->getNumberOfSlots() > 0 && frameBuffers->isIdle()){
+		frameBuffers->releaseMemory();
+	}
+	this->slotPreparation.storeRelease(SLOTS_IDLE);
+}
+
+void FrameIngest::recordAcquisitionCore() {
+	//remember the cores the OCTproZ thread that delivers the data is running on, so the worker threads can avoid them.
+	//the mask is collected by the gui once per status update, cores the thread has left are forgotten after a few updates
+	int core = currentCpuCore();
+	if(core < 0 || core >= THREADTUNING_MAX_CORES){
+		return;
+	}
+	quint64 coreBit = Q_UINT64_C(1) << core;
+	if(!(this->acquisitionCores.loadAcquire() & coreBit)){
+		this->acquisitionCores.fetchAndOrRelaxed(coreBit);
+	}
+}
+
+void FrameIngest::frameProcessed(qint64 nanoseconds) {
+	//called by the metric calculator of this source as soon as it is done with a frame
+	this->rateController.reportMetricCost(nanoseconds);
+}
+
+void FrameIngest::setTargetRate(double rateInHz) {
+	this->rateController.setTargetRate(rateInHz);
+}
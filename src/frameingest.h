@@ -0,0 +1,88 @@
+#ifndef FRAMEINGEST_H
+#define FRAMEINGEST_H
+
+#include <QObject>
+#include <QAtomicInteger>
+#include "signalmonitorparameters.h"
+#include "ratecontroller.h"
+#include "ingeststatistics.h"
+#include "framepool.h"
+#include "pipelinestage.h"
+#include "latencymonitor.h"
+#include "framedescriptor.h"
+#include "configurationstore.h"
+#include "taskpool.h"
+
+#define FRAMEINGEST_DEFAULT_NUMBER_OF_SLOTS 8
+
+enum SLOT_PREPARATION {
+	SLOTS_IDLE,
+	SLOTS_PREPARING, //the inactive pool is being reserved (or released), only the preparing thread touches it
+	SLOTS_READY, //the inactive pool has the requested geometry and is swapped in with the next frame
+	SLOTS_FAILED //the requested geometry could not be allocated, it is not requested again
+};
+
+//selects, copies and forwards single frames of one data source (raw, processed or replay).
+//receiveBuffer() is called from the OCTproZ thread that delivers the data (or from the replay thread), every source has its own FrameIngest with its own state and copy buffers.
+//the copies are taken from a FramePool, a slot is reused as soon as every stage that received the frame has released it.
+//the acquisition thread never allocates: if the frame size or the slot count changes, a second pool is reserved in the task pool
+//and swapped in with the first frame after it is ready. frames of a new size are dropped until then.
+class FrameIngest : public QObject
+{
+	Q_OBJECT
+public:
+	explicit FrameIngest(BUFFER_SOURCE source, QObject *parent = nullptr);
+
+	void receiveBuffer(void* buffer, unsigned int bitDepth, unsigned int samplesPerLine, unsigned int linesPerFrame, unsigned int framesPerBuffer, unsigned int buffersPerVolume, unsigned int currentBufferNr, bool grabbingAllowed);
+	void frameProcessed(qint64 nanoseconds);
+
+	BUFFER_SOURCE getSource() const {return this->source;}
+	RateController* getRateController() {return &this->rateController;}
+	IngestCounters getCounters() const {return this->statistics.getCounters();}
+	quint64 takeAcquisitionCores() {return this->acquisitionCores.fetchAndStoreOrdered(0);} //cores the delivering thread was seen on since the last call
+	void setLatencyMonitor(LatencyMonitor* latencyMonitor) {this->latencyMonitor = latencyMonitor;}
+	void setConfigurationStore(const ConfigurationStore* configuration) {this->configuration = configuration;}
+	void setTaskPool(TaskPool* taskPool) {this->taskPool = taskPool;}
+	void releaseUnusedFrameBuffers();
+	void setDownstreamStage(const PipelineStage* stage) {this->downstreamStage = stage;}
+	void setNumberOfSlots(int numberOfSlots) {this->requestedNumberOfSlots.storeRelease(qMax(1, numberOfSlots));}
+	void setStreamingCopyEnabled(bool enabled) {this->streamingCopyEnabled.storeRelease(enabled ? 1 : 0);}
+	void resendDimensions() {this->dimensionsOutdated.storeRelease(1);}
+
+private:
+	BUFFER_SOURCE source;
+	QAtomicInteger<int> requestedNumberOfSlots;
+	QAtomicInteger<int> streamingCopyEnabled;
+	QAtomicInteger<quint64> acquisitionCores;
+	QAtomicInteger<int> dimensionsOutdated;
+	RateController rateController;
+	IngestStatistics statistics;
+	LatencyMonitor* latencyMonitor;
+	const ConfigurationStore* configuration;
+	const PipelineStage* downstreamStage;
+
+	FramePool frameBuffers[2];
+	int activeFrameBuffers; //written by the acquisition thread only while no pool is prepared
+	QAtomicInteger<int> slotPreparation; //SLOT_PREPARATION
+	size_t preparedBytesPerFrame; //geometry of the requested pool, written by the acquisition thread before SLOTS_PREPARING is set
+	int preparedNumberOfSlots;
+	TaskPool* taskPool;
+	quint64 sequenceNumber;
+	unsigned int framesPerBuffer;
+	unsigned int buffersPerVolume;
+
+	void recordAcquisitionCore();
+	bool swapFrameBuffers(size_t bytesPerFrame, int numberOfSlots);
+	void prepareFrameBuffers();
+
+public slots:
+	void setTargetRate(double rateInHz);
+
+signals:
+	void newFrame(FrameDescriptor frame);
+	void maxFrames(int max);
+	void maxBuffers(int max);
+	void error(QString);
+};
+
+#endif //FRAMEINGEST_H
@@ -0,0 +1,31 @@
+#include "frameitem.h"
+#include <string.h>
+
+
+FrameItem::FrameItem(QGraphicsItem* parent) : QGraphicsItem(parent) {
+}
+
+void FrameItem::setFrame(const uchar* data, int width, int height, int bytesPerLine) {
+	//the image is only recreated if the frame size changes, every other frame is copied line by line into the existing image
+	if(this->image.width() != width || this->image.height() != height){
+		this->prepareGeometryChange();
+		this->image = QImage(width, height, QImage::Format_Grayscale8);
+	}
+	if(this->image.isNull()){
+		return;
+	}
+	for(int line = 0; line < height; line++){
+		memcpy(this->image.scanLine(line), data + static_cast<size_t>(line)*static_cast<size_t>(bytesPerLine), static_cast<size_t>(width));
+	}
+	this->update();
+}
+
+QRectF FrameItem::boundingRect() const {
+	return QRectF(0, 0, this->image.width(), this->image.height());
+}
+
+void FrameItem::paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget* widget) {
+	Q_UNUSED(option)
+	Q_UNUSED(widget)
+	painter->drawImage(QPointF(0, 0), this->image);
+}
@@ -0,0 +1,23 @@
+#ifndef FRAMEITEM_H
+#define FRAMEITEM_H
+
+#include <QGraphicsItem>
+#include <QImage>
+#include <QPainter>
+
+//shows an 8 bit frame in a QGraphicsScene. unlike QGraphicsPixmapItem the frame is copied into an image that is kept
+//between frames, so displaying a frame of the same size as the previous one does not allocate
+class FrameItem : public QGraphicsItem
+{
+public:
+	explicit FrameItem(QGraphicsItem* parent = nullptr);
+
+	void setFrame(const uchar* data, int width, int height, int bytesPerLine);
+	QRectF boundingRect() const override;
+	void paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget* widget = nullptr) override;
+
+private:
+	QImage image;
+};
+
+#endif //FRAMEITEM_H
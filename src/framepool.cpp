@@ -0,0 +1,69 @@
+#include "framepool.h"
+
+
+FramePool::FramePool()
+	: references(nullptr),
+	numberOfSlots(0),
+	nextSlot(0)
+{
+}
+
+FramePool::~FramePool() {
+	delete[] this->references;
+}
+
+bool FramePool::reserve(size_t bytesPerSlot, int numberOfSlots) {
+	if(!this->isIdle()){
+		return false;
+	}
+	if(!this->arena.reserve(bytesPerSlot, numberOfSlots)){
+		return false;
+	}
+	if(numberOfSlots != this->numberOfSlots){
+		delete[] this->references;
+		this->references = new QAtomicInteger<int>[numberOfSlots];
+		for(int i = 0; i < numberOfSlots; i++){
+			this->references[i].storeRelease(0);
+		}
+		this->numberOfSlots = numberOfSlots;
+		this->nextSlot = 0;
+	}
+	return true;
+}
+
+void FramePool::releaseMemory() {
+	this->arena.release();
+	delete[] this->references;
+	this->references = nullptr;
+	this->numberOfSlots = 0;
+	this->nextSlot = 0;
+}
+
+int FramePool::acquire() {
+	//slots are handed out round robin, so a freed slot is not reused immediately. acquire() is only called by the producer of the pool
+	for(int i = 0; i < this->numberOfSlots; i++){
+		int slot = (this->nextSlot+i)%this->numberOfSlots;
+		if(this->references[slot].testAndSetOrdered(0, 1)){
+			this->nextSlot = (slot+1)%this->numberOfSlots;
+			return slot;
+		}
+	}
+	return -1;
+}
+
+void FramePool::retain(int slot) {
+	this->references[slot].ref();
+}
+
+void FramePool::release(int slot) {
+	this->references[slot].deref();
+}
+
+bool FramePool::isIdle() const {
+	for(int i = 0; i < this->numberOfSlots; i++){
+		if(this->references[i].loadAcquire() != 0){
+			return false;
+		}
+	}
+	return true;
+}
@@ -0,0 +1,50 @@
+#ifndef FRAMEPOOL_H
+#define FRAMEPOOL_H
+
+#include <QtGlobal>
+#include <QAtomicInteger>
+#include "framearena.h"
+#include "framedescriptor.h"
+
+//frame slots with reference counts. a slot is only reused after every stage that holds a frame in it has released it,
+//so frames can wait in queues without being overwritten by newer frames.
+class FramePool
+{
+public:
+	FramePool();
+	~FramePool();
+
+	//changes the slot size and count. fails while any slot is in use
+	bool reserve(size_t bytesPerSlot, int numberOfSlots);
+	void releaseMemory(); //only while no slot is in use
+	int acquire();
+	void retain(int slot);
+	void release(int slot);
+	bool isIdle() const;
+
+	void* getSlot(int slot) const {return this->arena.getSlot(slot);}
+	size_t getBytesPerSlot() const {return this->arena.getBytesPerSlot();}
+	int getNumberOfSlots() const {return this->numberOfSlots;}
+	void setHugePagesEnabled(bool enabled) {this->arena.setHugePagesEnabled(enabled);}
+
+private:
+	FrameArena arena;
+	QAtomicInteger<int>* references;
+	int numberOfSlots;
+	int nextSlot;
+};
+
+//reference counting of the slot a frame descriptor points to. frames without a pool are not counted
+inline void retainFrame(const FrameDescriptor& frame) {
+	if(frame.pool != nullptr){
+		frame.pool->retain(frame.slot);
+	}
+}
+
+inline void releaseFrame(const FrameDescriptor& frame) {
+	if(frame.pool != nullptr){
+		frame.pool->release(frame.slot);
+	}
+}
+
+#endif //FRAMEPOOL_H
@@ -1,4 +1,5 @@
 #include "imagedisplay.h"
+#include "tracer.h"
 
 ImageDisplay::ImageDisplay(QWidget *parent) : QGraphicsView(parent)
 {
@@ -10,7 +11,7 @@ ImageDisplay::ImageDisplay(QWidget *parent) : QGraphicsView(parent)
 	setRenderHint(QPainter::Antialiasing);
 	setTransformationAnchor(AnchorUnderMouse);
 
-	this->inputItem = new QGraphicsPixmapItem();
+	this->inputItem = new FrameItem();
 	this->roiRect = new RectOverlay(inputItem);
 	this->scene->addItem(inputItem);
 	this->scene->update();
@@ -32,22 +33,12 @@ ImageDisplay::ImageDisplay(QWidget *parent) : QGraphicsView(parent)
 	this->frameHeight = 0;
 	this->mousePosX = 0;
 	this->mousePosY = 0;
-
-	//setup bitconverter
-	this->bitConverter = new BitDepthConverter();
-	this->bitConverter->moveToThread(&converterThread);
-	connect(this, &ImageDisplay::non8bitFrameReceived, this->bitConverter, &BitDepthConverter::convertDataTo8bit);
-	connect(this->bitConverter, &BitDepthConverter::info, this, &ImageDisplay::info);
-	connect(this->bitConverter, &BitDepthConverter::error, this, &ImageDisplay::error);
-	connect(this->bitConverter, &BitDepthConverter::converted8bitData, this, &ImageDisplay::displayFrame);
-	connect(&converterThread, &QThread::finished, this->bitConverter, &BitDepthConverter::deleteLater);
-	converterThread.start();
+	this->latencyMonitor = nullptr;
+	this->shown.storeRelease(0);
 }
 
 ImageDisplay::~ImageDisplay()
 {
-	converterThread.quit();
-	converterThread.wait();
 }
 
 void ImageDisplay::mouseDoubleClickEvent(QMouseEvent *event) {
@@ -107,6 +98,17 @@ void ImageDisplay::wheelEvent(QWheelEvent* event) {
 	QGraphicsView::wheelEvent(event);
 }
 
+void ImageDisplay::showEvent(QShowEvent* event) {
+	//the visibility is also read by the acquisition threads to decide if frames need to be converted for display
+	this->shown.storeRelease(1);
+	QGraphicsView::showEvent(event);
+}
+
+void ImageDisplay::hideEvent(QHideEvent* event) {
+	this->shown.storeRelease(0);
+	QGraphicsView::hideEvent(event);
+}
+
 void ImageDisplay::scaleView(qreal scaleFactor) {
 	qreal factor = transform().scale(scaleFactor, scaleFactor).mapRect(QRectF(0, 0, 1, 1)).width();
 	if (factor < 0.07 || factor > 100){
@@ -123,21 +125,18 @@ void ImageDisplay::zoomOut() {
 	this->scaleView(1/qreal(1.2));
 }
 
-void ImageDisplay::receiveFrame(void *frame, unsigned int bitDepth, unsigned int samplesPerLine, unsigned int linesPerFrame) {
-	if(!this->isVisible()){
-		return;
-	}
-	if(bitDepth != 8){
-		emit non8bitFrameReceived(frame, bitDepth, samplesPerLine, linesPerFrame);
-	}else{
-		this->displayFrame(static_cast<uchar*>(frame), samplesPerLine, linesPerFrame);
-	}
+void ImageDisplay::setLatencyMonitor(LatencyMonitor* latencyMonitor) {
+	this->latencyMonitor = latencyMonitor;
 }
 
-void ImageDisplay::displayFrame(uchar* frame, unsigned int samplesPerLine, unsigned int linesPerFrame) {
-	//create QPixmap from uchar array and update inputItem
-	QImage image(frame, samplesPerLine, linesPerFrame, samplesPerLine, QImage::Format_Grayscale8 );
-	this->inputItem->setPixmap(QPixmap::fromImage(image));
+void ImageDisplay::displayFrame(FrameDescriptor frame) {
+	//copy the 8 bit frame into inputItem. the frame is only valid during this call
+	int samplesPerLine = static_cast<int>(frame.samplesPerLine);
+	int linesPerFrame = static_cast<int>(frame.linesPerFrame);
+	{
+		TRACE_SCOPE("pixmap upload");
+		this->inputItem->setFrame(static_cast<const uchar*>(frame.data), samplesPerLine, linesPerFrame, static_cast<int>(frame.bytesPerLine));
+	}
 
 	//scale view if input sizes have changed
 	if(this->frameWidth != samplesPerLine || this->frameHeight != linesPerFrame){
@@ -3,24 +3,28 @@
 
 #include <QWidget>
 #include <QGraphicsView>
-#include <QGraphicsPixmapItem>
-#include <QThread>
+#include <QAtomicInteger>
 #include <QKeyEvent>
 #include <QWheelEvent>
 #include <QtMath>
-#include "bitdepthconverter.h"
+#include <QShowEvent>
+#include <QHideEvent>
+#include "latencymonitor.h"
+#include "framedescriptor.h"
 #include "rectoverlay.h"
+#include "frameitem.h"
 
 class ImageDisplay : public QGraphicsView
 {
 	Q_OBJECT
-	QThread converterThread;
 
 public:
 	explicit ImageDisplay(QWidget *parent = nullptr);
 	~ImageDisplay();
 
 	QRect getRoi(){return this->currentRoi;}
+	void setLatencyMonitor(LatencyMonitor* latencyMonitor);
+	bool isShown() const {return this->shown.loadAcquire() != 0;}
 
 private:
 	void mouseDoubleClickEvent(QMouseEvent* event) override;
@@ -28,28 +32,29 @@ private:
 	void mouseMoveEvent(QMouseEvent* event) override;
 	void keyPressEvent(QKeyEvent* event) override;
 	void wheelEvent(QWheelEvent* event) override;
+	void showEvent(QShowEvent* event) override;
+	void hideEvent(QHideEvent* event) override;
 	void scaleView(qreal scaleFactor);
 
 private:
-	BitDepthConverter* bitConverter;
 	QGraphicsScene* scene;
-	QGraphicsPixmapItem* inputItem;
+	FrameItem* inputItem;
 	int frameWidth;
 	int frameHeight;
 	int mousePosX;
 	int mousePosY;
 	RectOverlay* roiRect;
 	QRect currentRoi;
+	LatencyMonitor* latencyMonitor;
+	QAtomicInteger<int> shown;
 
 public slots:
 	void zoomIn();
 	void zoomOut();
-	void receiveFrame(void* frame, unsigned int bitDepth, unsigned int samplesPerLine, unsigned int linesPerFrame);
-	void displayFrame(uchar* frame, unsigned int samplesPerLine, unsigned int linesPerFrame);
+	void displayFrame(FrameDescriptor frame);
 	void setRoi(QRect roi);
 
 signals:
-	void non8bitFrameReceived(void *frame, unsigned int bitDepth, unsigned int samplesPerLine, unsigned int linesPerFrame);
 	void roiChanged(QRect);
 	void info(QString);
 	void error(QString);
@@ -1,112 +1,213 @@
 #include "imagemetriccalculator.h"
+#include "tracer.h"
+#include <limits>
 
 
 ImageMetricCalculator::ImageMetricCalculator(QObject *parent)
 	: QObject(parent),
-	calculationRunning(false),
-	selectedMetric(IMAGE_METRIC::SUM)
+	latencyMonitor(nullptr),
+	taskPool(nullptr),
+	metricRecorder(nullptr)
 {
 	this->stats = {0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0, 0, 1024, 1024};
-	this->roi.setRect(0, 0, 1024, 1024);
 }
 
-QPoint ImageMetricCalculator::indexToPoint(int index, int width) {
-	int x = index%width;
-	int y = index/width;
-	return QPoint(x, y);
-}
+void ImageMetricCalculator::calculateMetric(FrameDescriptor frame) {
+	TRACE_SCOPE("metric");
+	TRACE_FLOW_END("frame to metric", frame.handoffTimestamp);
+	qint64 startTimestamp = LatencyMonitor::now();
+	this->sequenceChecker.check(frame);
+	qreal metricValue = 0;
+	bool calculated = this->calculate(frame, &metricValue);
 
-qreal ImageMetricCalculator::standardDeviation(QVector<qreal> samples, qreal mean) {
-	qreal sum = 0;
-	for (int i = 0; i < samples.length(); i++){
-		sum = sum + qPow(samples.at(i) - mean, 2);
+	if(calculated){
+		qint64 endTimestamp = LatencyMonitor::now();
+		if(this->latencyMonitor != nullptr){
+			this->latencyMonitor->record(STAGE_QUEUE, frame.handoffTimestamp, startTimestamp);
+			this->latencyMonitor->record(STAGE_METRIC, startTimestamp, endTimestamp);
+		}
+		if(this->metricRecorder != nullptr && this->metricRecorder->isRecording()){
+			this->metricRecorder->append(this->createRecord(frame, metricValue, endTimestamp));
+		}
+		emit metricCalculated(metricValue, frame, endTimestamp);
 	}
-	return qSqrt(sum/(samples.length()));
+	emit calculationFinished(LatencyMonitor::now() - startTimestamp);
 }
 
-void ImageMetricCalculator::calculateMetric(void* frameBuffer, unsigned int bitDepth, unsigned int samplesPerLine, unsigned int linesPerFrame) {
-	if(!this->calculationRunning){
-		this->calculationRunning = true;
+bool ImageMetricCalculator::calculate(const FrameDescriptor& frame, qreal* metricValue) {
+	//set buffer datatype according bitdepth and start statistics calculation
+	//uchar
+	if(frame.bitDepth <= 8){
+		const unsigned char* frameData = static_cast<const unsigned char*>(frame.data);
+		*metricValue = this->calculateStatistics(frameData, frame.bytesPerLine, frame.samplesPerLine, frame.linesPerFrame, frame.roi, frame.imageMetric);
+	}
+	//ushort
+	else if(frame.bitDepth > 8 && frame.bitDepth <= 16){
+		const unsigned short* frameData = static_cast<const unsigned short*>(frame.data);
+		*metricValue = this->calculateStatistics(frameData, frame.bytesPerLine, frame.samplesPerLine, frame.linesPerFrame, frame.roi, frame.imageMetric);
+	}
+	//32 bit unsigned int. samples with more than 16 bit are stored in 4 bytes
+	else if(frame.bitDepth > 16 && frame.bitDepth <= 32){
+		const quint32* frameData = static_cast<const quint32*>(frame.data);
+		*metricValue = this->calculateStatistics(frameData, frame.bytesPerLine, frame.samplesPerLine, frame.linesPerFrame, frame.roi, frame.imageMetric);
+	}
+	else{
+		return false;
+	}
+	return true;
+}
 
-		//set buffer datatype according bitdepth and start statistics calculation
-		//uchar
-		if(bitDepth <= 8){
-			unsigned char* frame = static_cast<unsigned char*>(frameBuffer);
-			this->calculateStatistics(frame, bitDepth, samplesPerLine, linesPerFrame);
-		}
-		//ushort
-		else if(bitDepth > 8 && bitDepth <= 16){
-			unsigned short* frame = static_cast<unsigned short*>(frameBuffer);
-			this->calculateStatistics(frame, bitDepth, samplesPerLine, linesPerFrame);
-		}
-		//unsigned long int
-		else if(bitDepth > 16 && bitDepth <= 32){
-			unsigned long int* frame = static_cast<unsigned long int*>(frameBuffer);
-			this->calculateStatistics(frame, bitDepth, samplesPerLine, linesPerFrame);
-		}
+MetricRecord ImageMetricCalculator::createRecord(const FrameDescriptor& frame, qreal metricValue, qint64 timestamp) const {
+	//every calculated metric is recorded, independent of the plot and its maximum number of data points
+	MetricRecord record;
+	record.timestamp = timestamp;
+	record.acquisitionTimestamp = frame.acquisitionTimestamp;
+	record.sequenceNumber = frame.sequenceNumber;
+	record.configurationVersion = frame.configurationVersion;
+	record.source = static_cast<quint32>(frame.source);
+	record.imageMetric = static_cast<quint32>(frame.imageMetric);
+	record.flags = (frame.imageMetric == STDDEV || frame.imageMetric == COEFFVAR) ? METRICRECORD_HAS_DEVIATION : 0;
+	record.pixels = this->stats.pixels;
+	record.roiX = this->stats.roiX;
+	record.roiY = this->stats.roiY;
+	record.roiWidth = this->stats.roiWidth;
+	record.roiHeight = this->stats.roiHeight;
+	record.value = metricValue;
+	record.sum = this->stats.sum;
+	record.average = this->stats.average;
+	record.min = this->stats.min;
+	record.max = this->stats.max;
+	record.stdDeviation = this->stats.stdDeviation;
+	record.coeffOfVariation = this->stats.coeffOfVariation;
+	return record;
+}
 
-		this->calculationRunning = false;
+template<typename Body>
+void ImageMetricCalculator::parallelFor(int begin, int end, int minimumRangePerTask, const Body& body) {
+	if(this->taskPool != nullptr){
+		this->taskPool->parallelFor(begin, end, minimumRangePerTask, body);
+	}else if(end > begin){
+		body(0, begin, end);
 	}
 }
 
-void ImageMetricCalculator::setRoi(QRect roi) {
-	this->roi = roi;
+int ImageMetricCalculator::getNumberOfChunks(int begin, int end, int minimumRangePerTask) const {
+	if(this->taskPool != nullptr){
+		return this->taskPool->getNumberOfChunks(begin, end, minimumRangePerTask);
+	}
+	return end > begin ? 1 : 0;
 }
 
-void ImageMetricCalculator::setMetric(int metric) {
-	this->selectedMetric =static_cast<IMAGE_METRIC>(metric);
+template<typename T, bool withSquares>
+void ImageMetricCalculator::accumulateLine(const T* samples, int numberOfSamples, PartialStatistics* partial) {
+	//8 and 16 bit squares of a whole line fit into 64 bit (2^32 per sample), 32 bit squares need the 128 bit sum for every sample
+	quint64 sum = 0;
+	quint64 lineSumOfSquares = 0;
+	UInt128 wideSumOfSquares = {0, 0};
+	T minValue = partial->min < std::numeric_limits<T>::max() ? static_cast<T>(partial->min) : std::numeric_limits<T>::max();
+	T maxValue = static_cast<T>(partial->max);
+	for(int x = 0; x < numberOfSamples; x++){
+		T value = samples[x];
+		minValue = value < minValue ? value : minValue;
+		maxValue = value > maxValue ? value : maxValue;
+		sum += value;
+		if(withSquares){
+			quint64 square = static_cast<quint64>(value)*value;
+			if(sizeof(T) <= 2){
+				lineSumOfSquares += square;
+			}else{
+				wideSumOfSquares.add(square);
+			}
+		}
+	}
+	partial->sum += sum;
+	partial->sumOfSquares.add(lineSumOfSquares);
+	partial->sumOfSquares.add(wideSumOfSquares);
+	partial->min = qMin(partial->min, static_cast<quint32>(minValue));
+	partial->max = qMax(partial->max, static_cast<quint32>(maxValue));
 }
 
 template<typename T>
-void ImageMetricCalculator::calculateStatistics(T frame, unsigned int bitDepth, unsigned int samplesPerLine, unsigned int linesPerFrame) {
-	//init params for statistic calculation
-	int numberOfPossibleValues = static_cast<int>(pow(2, bitDepth));
-	qreal sum = 0;
-	qreal length = samplesPerLine*linesPerFrame;
-	qreal maxValue = 0;
-	qreal minValue = 999999999;
-	int pixels = 0;
-	QVector<qreal> samples;
-
-	//statistics calculation
-	for(int i = 0; i < length; i++){
-		if(this->roi.contains(this->indexToPoint(i, static_cast<int>(samplesPerLine)))){
-			qreal currValue = frame[i];
-			samples.append(currValue);
-			if(maxValue < currValue){maxValue = currValue;}
-			if(minValue > currValue){minValue = currValue;}
-			pixels++;
-			sum += currValue;
+qreal ImageMetricCalculator::calculateStatistics(const T* frame, unsigned int bytesPerLine, unsigned int samplesPerLine, unsigned int linesPerFrame, const QRect& roi, IMAGE_METRIC metric) {
+	//the roi is clipped to the frame and split into blocks of lines that are processed in parallel by the task pool
+	int firstSample = qMax(0, roi.x());
+	int endSample = qMin(static_cast<int>(samplesPerLine), roi.x()+roi.width());
+	int firstLine = qMax(0, roi.y());
+	int endLine = qMin(static_cast<int>(linesPerFrame), roi.y()+roi.height());
+	if(endSample <= firstSample){
+		endLine = firstLine;
+	}
+	int minimumLinesPerTask = qMax(1, METRIC_MINIMUM_SAMPLES_PER_TASK/qMax(1, endSample-firstSample));
+	const char* frameBytes = reinterpret_cast<const char*>(frame);
 
-			if(currValue>(numberOfPossibleValues-1)){
-				currValue = numberOfPossibleValues-1;
-			}
-			if(currValue<0){
-				currValue = 0;
+	//sum, sum of squares, min and max of every block of lines in one pass. the samples are integers, so the sums are accumulated exactly
+	//in integers (see accumulateLine()) and the result does not depend on the number of chunks or the order of the additions
+	bool withSquares = metric == STDDEV || metric == COEFFVAR;
+	int numberOfChunks = qMax(1, this->getNumberOfChunks(firstLine, endLine, minimumLinesPerTask));
+	if(this->partials.size() < numberOfChunks){
+		this->partials.resize(numberOfChunks);
+	}
+	PartialStatistics* partialData = this->partials.data();
+	for(int i = 0; i < numberOfChunks; i++){
+		partialData[i] = PartialStatistics(); //an empty roi keeps one empty partial
+		partialData[i].min = std::numeric_limits<quint32>::max();
+	}
+	this->parallelFor(firstLine, endLine, minimumLinesPerTask, [&](int chunk, int begin, int end) {
+		PartialStatistics partial = {0, {0, 0}, std::numeric_limits<quint32>::max(), 0, 0};
+		for(int line = begin; line < end; line++){
+			const T* samples = reinterpret_cast<const T*>(frameBytes + static_cast<size_t>(line)*bytesPerLine);
+			if(withSquares){
+				accumulateLine<T, true>(samples + firstSample, endSample-firstSample, &partial);
+			}else{
+				accumulateLine<T, false>(samples + firstSample, endSample-firstSample, &partial);
 			}
+			partial.pixels += endSample-firstSample;
 		}
+		partialData[chunk] = partial;
+	});
+
+	quint64 sum = 0;
+	UInt128 sumOfSquares = {0, 0};
+	quint32 maxValue = 0;
+	quint32 minValue = std::numeric_limits<quint32>::max();
+	int pixels = 0;
+	for(int i = 0; i < numberOfChunks; i++){
+		const PartialStatistics& partial = partialData[i];
+		sum += partial.sum;
+		sumOfSquares.add(partial.sumOfSquares);
+		maxValue = qMax(maxValue, partial.max);
+		minValue = qMin(minValue, partial.min);
+		pixels += partial.pixels;
+	}
+	qreal average = static_cast<qreal>(sum)/pixels;
+
+	//n*sum of squares - sum^2 is n^2 times the variance. both terms are below 2^126 (n < 2^31, samples < 2^32) and are subtracted
+	//exactly, so there is no cancellation. it is only converted to double for the square root
+	qreal scaledVariance = 0;
+	if(withSquares){
+		scaledVariance = sumOfSquares.multipliedBy(static_cast<quint64>(pixels)).minus(UInt128::multiply(sum, sum)).toDouble();
 	}
 
 	//update ImageStatistics struct
 	this->stats.max = maxValue;
-	this->stats.min = minValue;
+	this->stats.min = pixels > 0 ? static_cast<qreal>(minValue) : std::numeric_limits<qreal>::max();
 	this->stats.pixels = pixels;
-	this->stats.sum = sum;
-	this->stats.average = this->stats.sum/pixels;
-	this->stats.stdDeviation = this->standardDeviation(samples, this->stats.average);
+	this->stats.sum = static_cast<qreal>(sum);
+	this->stats.average = average;
+	this->stats.stdDeviation = qSqrt(scaledVariance)/pixels;
 	this->stats.coeffOfVariation = this->stats.stdDeviation/this->stats.average;
-	this->stats.roiX = this->roi.x();
-	this->stats.roiY = this->roi.y();
-	this->stats.roiWidth = this->roi.width();
-	this->stats.roiHeight = this->roi.height();
+	this->stats.roiX = roi.x();
+	this->stats.roiY = roi.y();
+	this->stats.roiWidth = roi.width();
+	this->stats.roiHeight = roi.height();
 
 	qreal metricValue = 0;
-	switch(this->selectedMetric){
+	switch(metric){
 		case SUM:metricValue = this->stats.sum; break;
 		case AVERAGE:metricValue =this->stats.average; break;
 		case STDDEV: metricValue = this->stats.stdDeviation; break;
 		case COEFFVAR: metricValue = this->stats.coeffOfVariation; break;
 		default: metricValue = this->stats.sum;
 	}
-	emit metricCalculated(metricValue);
+	return metricValue;
 }
@@ -2,13 +2,18 @@
 #define IMAGESMETRICCALCULATOR_H
 
 #define NUMBER_OF_HISTOGRAM_BUFFERS 2
+#define METRIC_MINIMUM_SAMPLES_PER_TASK 65536
 
 #include <QObject>
 #include <QVector>
 #include <QRect>
-#include <QApplication>
 #include <QtMath>
 #include "signalmonitorparameters.h"
+#include "latencymonitor.h"
+#include "framedescriptor.h"
+#include "taskpool.h"
+#include "metricrecorder.h"
+#include "uint128.h"
 
 struct ImageStatistics {
 	int pixels;
@@ -24,32 +29,53 @@ struct ImageStatistics {
 	int roiHeight;
 };
 
+//integer accumulators of a block of lines. a sum of up to 2^31 samples with 32 bit fits into 64 bit, the sum of their squares needs 128 bit
+struct PartialStatistics {
+	quint64 sum;
+	UInt128 sumOfSquares;
+	quint32 min;
+	quint32 max;
+	int pixels;
+};
+
 class ImageMetricCalculator : public QObject
 {
 	Q_OBJECT
 public:
 	explicit ImageMetricCalculator(QObject *parent = nullptr);
 
+	void setLatencyMonitor(LatencyMonitor* latencyMonitor) {this->latencyMonitor = latencyMonitor;}
+	void setTaskPool(TaskPool* taskPool) {this->taskPool = taskPool;}
+	void setMetricRecorder(MetricRecorder* metricRecorder) {this->metricRecorder = metricRecorder;}
+	SequenceCounters getSequenceCounters() const {return this->sequenceChecker.getCounters();}
+
+	//synchronous calculation without signals, used by calculateMetric() and by headless tools. the statistics of the last calculation can be read afterwards
+	bool calculate(const FrameDescriptor& frame, qreal* metricValue);
+	const ImageStatistics& getStatistics() const {return this->stats;}
+	MetricRecord createRecord(const FrameDescriptor& frame, qreal metricValue, qint64 timestamp) const;
+
 private:
-	bool calculationRunning;
 	ImageStatistics stats;
-	QRect roi;
-	IMAGE_METRIC selectedMetric;
+	LatencyMonitor* latencyMonitor;
+	SequenceChecker sequenceChecker;
+	TaskPool* taskPool;
+	MetricRecorder* metricRecorder;
+	QVector<PartialStatistics> partials; //reused for every frame, it only grows if the task pool uses more chunks than before
 
-	QPoint indexToPoint(int index, int width);
-	qreal standardDeviation(QVector<qreal> samples, qreal mean);
-	template <typename T> void calculateStatistics(T frame, unsigned int bitDepth, unsigned int samplesPerLine, unsigned int linesPerFrame);
+	template <typename Body> void parallelFor(int begin, int end, int minimumRangePerTask, const Body& body);
+	int getNumberOfChunks(int begin, int end, int minimumRangePerTask) const;
+	template <typename T, bool withSquares> static void accumulateLine(const T* samples, int numberOfSamples, PartialStatistics* partial);
+	template <typename T> qreal calculateStatistics(const T* frame, unsigned int bytesPerLine, unsigned int samplesPerLine, unsigned int linesPerFrame, const QRect& roi, IMAGE_METRIC metric);
 
 
 signals:
-	void metricCalculated(qreal);
+	void metricCalculated(qreal value, FrameDescriptor frame, qint64 calculationTimestamp);
+	void calculationFinished(qint64 nanoseconds);
 	void info(QString);
 	void error(QString);
 
 public slots:
-	void calculateMetric(void* frameBuffer, unsigned int bitDepth, unsigned int samplesPerLine, unsigned int linesPerFrame);
-	void setRoi(QRect roi);
-	void setMetric(int metric);
+	void calculateMetric(FrameDescriptor frame);
 };
 
 #endif //IMAGESMETRICCALCULATOR_H
@@ -0,0 +1,59 @@
+#ifndef INGESTSTATISTICS_H
+#define INGESTSTATISTICS_H
+
+#include <QtGlobal>
+#include <QAtomicInteger>
+
+enum DROP_REASON {
+	DROP_BUSY,
+	DROP_WRONG_BUFFER,
+	DROP_DISABLED,
+	NUMBER_OF_DROP_REASONS
+};
+
+struct IngestCounters {
+	quint64 accepted;
+	quint64 skipped;
+	quint64 dropped[NUMBER_OF_DROP_REASONS];
+
+	quint64 received() const {
+		quint64 total = this->accepted + this->skipped;
+		for(int i = 0; i < NUMBER_OF_DROP_REASONS; i++){
+			total += this->dropped[i];
+		}
+		return total;
+	}
+};
+
+//lock free buffer counters for one data source. Every counted event costs a single relaxed atomic increment,
+//so counting stays cheap even when the acquisition thread is overloaded.
+class IngestStatistics
+{
+public:
+	IngestStatistics() : accepted(0), skipped(0) {
+		for(int i = 0; i < NUMBER_OF_DROP_REASONS; i++){
+			this->dropped[i].storeRelease(0);
+		}
+	}
+
+	void countAccepted() {this->accepted.fetchAndAddRelaxed(1);}
+	void countSkipped() {this->skipped.fetchAndAddRelaxed(1);}
+	void countDropped(DROP_REASON reason) {this->dropped[reason].fetchAndAddRelaxed(1);}
+
+	IngestCounters getCounters() const {
+		IngestCounters counters;
+		counters.accepted = this->accepted.loadAcquire();
+		counters.skipped = this->skipped.loadAcquire();
+		for(int i = 0; i < NUMBER_OF_DROP_REASONS; i++){
+			counters.dropped[i] = this->dropped[i].loadAcquire();
+		}
+		return counters;
+	}
+
+private:
+	QAtomicInteger<quint64> accepted;
+	QAtomicInteger<quint64> skipped;
+	QAtomicInteger<quint64> dropped[NUMBER_OF_DROP_REASONS];
+};
+
+#endif //INGESTSTATISTICS_H
@@ -0,0 +1,158 @@
+#include "latencymonitor.h"
+#include <QFile>
+#include <QTextStream>
+#include <QtAlgorithms>
+#include <QtMath>
+#include <chrono>
+
+
+LatencyHistogram::LatencyHistogram()
+	: count(0),
+	sum(0),
+	maximum(0)
+{
+	this->reset();
+}
+
+void LatencyHistogram::record(qint64 nanoseconds) {
+	if(nanoseconds < 0){
+		nanoseconds = 0;
+	}
+	this->buckets[bucketIndex(nanoseconds)].fetchAndAddRelaxed(1);
+	this->count.fetchAndAddRelaxed(1);
+	this->sum.fetchAndAddRelaxed(static_cast<quint64>(nanoseconds));
+
+	qint64 currentMaximum = this->maximum.loadAcquire();
+	while(nanoseconds > currentMaximum && !this->maximum.testAndSetOrdered(currentMaximum, nanoseconds)){
+		currentMaximum = this->maximum.loadAcquire();
+	}
+}
+
+void LatencyHistogram::reset() {
+	for(int i = 0; i < LATENCYHISTOGRAM_BUCKETS; i++){
+		this->buckets[i].storeRelease(0);
+	}
+	this->count.storeRelease(0);
+	this->sum.storeRelease(0);
+	this->maximum.storeRelease(0);
+}
+
+quint64 LatencyHistogram::getCount() const {
+	return this->count.loadAcquire();
+}
+
+quint64 LatencyHistogram::getBucketCount(int bucket) const {
+	return this->buckets[bucket].loadAcquire();
+}
+
+qint64 LatencyHistogram::getMaximum() const {
+	return this->maximum.loadAcquire();
+}
+
+double LatencyHistogram::getMean() const {
+	quint64 count = this->getCount();
+	return count > 0 ? static_cast<double>(this->sum.loadAcquire())/count : 0.0;
+}
+
+qint64 LatencyHistogram::getPercentile(double percentile) const {
+	//returns the upper bound of the bucket that contains the requested percentile
+	quint64 count = this->getCount();
+	if(count == 0){
+		return 0;
+	}
+	quint64 target = static_cast<quint64>(qCeil(percentile/100.0*count));
+	quint64 accumulated = 0;
+	for(int i = 0; i < LATENCYHISTOGRAM_BUCKETS; i++){
+		accumulated += this->getBucketCount(i);
+		if(accumulated >= target){
+			return qMin(bucketUpperBound(i), this->getMaximum());
+		}
+	}
+	return this->getMaximum();
+}
+
+int LatencyHistogram::bucketIndex(qint64 nanoseconds) {
+	if(nanoseconds <= 0){
+		return 0;
+	}
+	quint64 value = static_cast<quint64>(nanoseconds);
+	int octave = 63 - qCountLeadingZeroBits(value);
+	int subBucket = octave >= 2 ? static_cast<int>((value >> (octave-2)) & 3) : static_cast<int>((value << (2-octave)) & 3);
+	int index = octave*LATENCYHISTOGRAM_SUB_BUCKETS + subBucket;
+	return qMin(index, LATENCYHISTOGRAM_BUCKETS-1);
+}
+
+qint64 LatencyHistogram::bucketLowerBound(int bucket) {
+	int octave = bucket/LATENCYHISTOGRAM_SUB_BUCKETS;
+	int subBucket = bucket%LATENCYHISTOGRAM_SUB_BUCKETS;
+	qint64 octaveStart = Q_INT64_C(1) << octave;
+	return octaveStart + (octaveStart*subBucket)/LATENCYHISTOGRAM_SUB_BUCKETS;
+}
+
+qint64 LatencyHistogram::bucketUpperBound(int bucket) {
+	return bucketLowerBound(bucket+1);
+}
+
+
+LatencyMonitor::LatencyMonitor() {
+}
+
+qint64 LatencyMonitor::now() {
+	//monotonic clock that is shared by all threads
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+QString LatencyMonitor::stageName(LATENCY_STAGE stage) {
+	switch(stage){
+		case STAGE_INGEST: return QString("Ingest");
+		case STAGE_QUEUE: return QString("Queue");
+		case STAGE_METRIC: return QString("Metric");
+		case STAGE_CONVERSION: return QString("Conversion");
+		case STAGE_PLOT: return QString("Plot");
+		case STAGE_END_TO_END: return QString("End to end");
+		default: return QString("Unknown");
+	}
+}
+
+void LatencyMonitor::record(LATENCY_STAGE stage, qint64 startTimestamp, qint64 endTimestamp) {
+	if(startTimestamp <= 0){
+		return;
+	}
+	this->histograms[stage].record(endTimestamp - startTimestamp);
+}
+
+void LatencyMonitor::reset() {
+	for(int i = 0; i < NUMBER_OF_LATENCY_STAGES; i++){
+		this->histograms[i].reset();
+	}
+}
+
+bool LatencyMonitor::saveToFile(QString fileName) const {
+	QFile file(fileName);
+	if(!file.open(QFile::WriteOnly|QFile::Truncate)){
+		return false;
+	}
+	QTextStream stream(&file);
+
+	//summary of all stages
+	stream << "Stage" << ";" << "Count" << ";" << "Mean (ns)" << ";" << "p50 (ns)" << ";" << "p90 (ns)" << ";" << "p99 (ns)" << ";" << "Max (ns)" << "\n";
+	for(int i = 0; i < NUMBER_OF_LATENCY_STAGES; i++){
+		const LatencyHistogram& histogram = this->histograms[i];
+		stream << stageName(static_cast<LATENCY_STAGE>(i)) << ";" << histogram.getCount() << ";" << QString::number(histogram.getMean(), 'f', 0) << ";"
+			<< histogram.getPercentile(50) << ";" << histogram.getPercentile(90) << ";" << histogram.getPercentile(99) << ";" << histogram.getMaximum() << "\n";
+	}
+
+	//all non empty buckets
+	stream << "\n" << "Stage" << ";" << "Bucket lower bound (ns)" << ";" << "Bucket upper bound (ns)" << ";" << "Count" << "\n";
+	for(int i = 0; i < NUMBER_OF_LATENCY_STAGES; i++){
+		const LatencyHistogram& histogram = this->histograms[i];
+		for(int bucket = 0; bucket < LATENCYHISTOGRAM_BUCKETS; bucket++){
+			quint64 bucketCount = histogram.getBucketCount(bucket);
+			if(bucketCount > 0){
+				stream << stageName(static_cast<LATENCY_STAGE>(i)) << ";" << LatencyHistogram::bucketLowerBound(bucket) << ";" << LatencyHistogram::bucketUpperBound(bucket) << ";" << bucketCount << "\n";
+			}
+		}
+	}
+	file.close();
+	return true;
+}
@@ -0,0 +1,65 @@
+#ifndef LATENCYMONITOR_H
+#define LATENCYMONITOR_H
+
+#include <QtGlobal>
+#include <QString>
+#include <QAtomicInteger>
+
+#define LATENCYHISTOGRAM_SUB_BUCKETS 4 //buckets per power of two
+#define LATENCYHISTOGRAM_OCTAVES 40 //covers 1 ns up to about 18 minutes
+#define LATENCYHISTOGRAM_BUCKETS (LATENCYHISTOGRAM_SUB_BUCKETS*LATENCYHISTOGRAM_OCTAVES)
+
+enum LATENCY_STAGE {
+	STAGE_INGEST, //callback entry to queue handoff (frame selection and copy in OCTproZ thread)
+	STAGE_QUEUE, //queue handoff to start of metric calculation
+	STAGE_METRIC, //metric calculation
+	STAGE_CONVERSION, //queue handoff to completed bit depth conversion
+	STAGE_PLOT, //end of metric calculation to value added to plot
+	STAGE_END_TO_END, //callback entry to value added to plot
+	NUMBER_OF_LATENCY_STAGES
+};
+
+//lock free histogram with logarithmically spaced buckets. record() may be called from any thread concurrently.
+class LatencyHistogram
+{
+public:
+	LatencyHistogram();
+
+	void record(qint64 nanoseconds);
+	void reset();
+	quint64 getCount() const;
+	quint64 getBucketCount(int bucket) const;
+	qint64 getMaximum() const;
+	double getMean() const;
+	qint64 getPercentile(double percentile) const;
+
+	static int bucketIndex(qint64 nanoseconds);
+	static qint64 bucketLowerBound(int bucket);
+	static qint64 bucketUpperBound(int bucket);
+
+private:
+	QAtomicInteger<quint64> buckets[LATENCYHISTOGRAM_BUCKETS];
+	QAtomicInteger<quint64> count;
+	QAtomicInteger<quint64> sum;
+	QAtomicInteger<qint64> maximum;
+};
+
+//collection of latency histograms, one for each stage of the signal chain
+class LatencyMonitor
+{
+public:
+	LatencyMonitor();
+
+	static qint64 now();
+	static QString stageName(LATENCY_STAGE stage);
+
+	void record(LATENCY_STAGE stage, qint64 startTimestamp, qint64 endTimestamp);
+	const LatencyHistogram& getHistogram(LATENCY_STAGE stage) const {return this->histograms[stage];}
+	void reset();
+	bool saveToFile(QString fileName) const;
+
+private:
+	LatencyHistogram histograms[NUMBER_OF_LATENCY_STAGES];
+};
+
+#endif //LATENCYMONITOR_H
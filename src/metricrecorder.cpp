@@ -0,0 +1,205 @@
+#include "metricrecorder.h"
+#include "latencymonitor.h"
+#include <QDateTime>
+#include <QVector>
+#include <cstring>
+#ifdef Q_OS_LINUX
+#include <fcntl.h>
+#endif
+
+#define METRICRECORDER_CHUNK_BYTES (static_cast<qint64>(METRICRECORDER_GROWTH_RECORDS)*static_cast<qint64>(sizeof(MetricRecord)))
+#define METRICRECORDER_ZERO_BLOCK_BYTES (1024*1024)
+
+
+MetricRecorder::MetricRecorder()
+	: header(nullptr),
+	growthFailed(false),
+	recording(0),
+	droppedRecords(0)
+{
+	this->currentChunk = {nullptr, 0};
+	this->nextChunk = {nullptr, 0};
+	this->retiredChunk = {nullptr, 0};
+}
+
+MetricRecorder::~MetricRecorder() {
+	this->close();
+}
+
+bool MetricRecorder::open(QString fileName) {
+	this->close();
+	this->file.setFileName(fileName);
+	if(!this->file.open(QFile::ReadWrite|QFile::Truncate)){
+		return false;
+	}
+	//header, the first chunk and the chunk after it are reserved right away
+	Chunk firstChunk = {nullptr, 0};
+	Chunk secondChunk = {nullptr, 0};
+	bool prepared = this->reserve(0, sizeof(MetricRecordFileHeader));
+	uchar* headerMemory = prepared ? this->file.map(0, sizeof(MetricRecordFileHeader)) : nullptr;
+	prepared = headerMemory != nullptr && this->prepareChunk(0, &firstChunk) && this->prepareChunk(METRICRECORDER_GROWTH_RECORDS, &secondChunk);
+	if(!prepared){
+		this->unmapChunk(&firstChunk);
+		this->unmapChunk(&secondChunk);
+		if(headerMemory != nullptr){
+			this->file.unmap(headerMemory);
+		}
+		this->file.close();
+		this->file.remove();
+		return false;
+	}
+
+	MetricRecordFileHeader* header = reinterpret_cast<MetricRecordFileHeader*>(headerMemory);
+	memset(header, 0, sizeof(MetricRecordFileHeader));
+	memcpy(header->magic, METRICRECORDER_MAGIC, sizeof(header->magic));
+	header->formatVersion = METRICRECORDER_FORMAT_VERSION;
+	header->headerSize = sizeof(MetricRecordFileHeader);
+	header->recordSize = sizeof(MetricRecord);
+	header->recordCount = 0;
+	header->startTimestamp = LatencyMonitor::now();
+	header->startTimeMsSinceEpoch = QDateTime::currentMSecsSinceEpoch();
+
+	QMutexLocker locker(&this->mutex);
+	this->header = header;
+	this->currentChunk = firstChunk;
+	this->nextChunk = secondChunk;
+	this->growthFailed = false;
+	this->droppedRecords.storeRelease(0);
+	this->recording.storeRelease(1);
+	return true;
+}
+
+void MetricRecorder::close() {
+	this->mutex.lock();
+	this->recording.storeRelease(0);
+	MetricRecordFileHeader* header = this->header;
+	Chunk chunks[] = {this->currentChunk, this->nextChunk, this->retiredChunk};
+	this->header = nullptr;
+	this->currentChunk = {nullptr, 0};
+	this->nextChunk = {nullptr, 0};
+	this->retiredChunk = {nullptr, 0};
+	this->mutex.unlock();
+	if(header == nullptr){
+		return;
+	}
+
+	//no append() uses the mappings any more, the reserved but unused part of the file is cut off
+	quint64 recordCount = header->recordCount;
+	for(Chunk& chunk : chunks){
+		this->unmapChunk(&chunk);
+	}
+	this->file.unmap(reinterpret_cast<uchar*>(header));
+	this->file.resize(sizeof(MetricRecordFileHeader) + recordCount*sizeof(MetricRecord));
+	this->file.close();
+}
+
+void MetricRecorder::maintain() {
+	this->mutex.lock();
+	Chunk retired = this->retiredChunk;
+	this->retiredChunk = {nullptr, 0};
+	bool prepareNext = this->header != nullptr && this->nextChunk.memory == nullptr && !this->growthFailed;
+	quint64 firstRecord = this->currentChunk.firstRecord + METRICRECORDER_GROWTH_RECORDS;
+	this->mutex.unlock();
+
+	//file operations are done without the mutex, append() keeps writing to the current chunk meanwhile
+	this->unmapChunk(&retired);
+	if(prepareNext){
+		Chunk chunk = {nullptr, 0};
+		bool prepared = this->prepareChunk(firstRecord, &chunk);
+		QMutexLocker locker(&this->mutex);
+		if(prepared){
+			this->nextChunk = chunk;
+		}else{
+			//the disk is probably full. the recording stops when the current chunk is full, everything recorded so far stays valid
+			this->growthFailed = true;
+		}
+	}
+}
+
+bool MetricRecorder::append(const MetricRecord& record) {
+	if(!this->isRecording()){
+		return false;
+	}
+	QMutexLocker locker(&this->mutex);
+	if(this->header == nullptr){
+		return false;
+	}
+	quint64 recordCount = this->header->recordCount;
+	if(recordCount >= this->currentChunk.firstRecord + METRICRECORDER_GROWTH_RECORDS){
+		if(this->nextChunk.memory == nullptr){
+			if(this->growthFailed){
+				this->recording.storeRelease(0);
+			}else{
+				//maintain() was not called for a whole chunk, the record is dropped instead of growing the file here
+				this->droppedRecords.fetchAndAddOrdered(1);
+			}
+			return false;
+		}
+		//only pointers are exchanged, maintain() unmaps the full chunk later
+		this->retiredChunk = this->currentChunk;
+		this->currentChunk = this->nextChunk;
+		this->nextChunk = {nullptr, 0};
+	}
+	uchar* destination = this->currentChunk.memory + (recordCount - this->currentChunk.firstRecord)*sizeof(MetricRecord);
+	memcpy(destination, &record, sizeof(MetricRecord));
+	this->header->recordCount = recordCount+1;
+	return true;
+}
+
+bool MetricRecorder::isOpen() const {
+	QMutexLocker locker(&this->mutex);
+	return this->header != nullptr;
+}
+
+quint64 MetricRecorder::getRecordCount() const {
+	QMutexLocker locker(&this->mutex);
+	return this->header != nullptr ? this->header->recordCount : 0;
+}
+
+bool MetricRecorder::prepareChunk(quint64 firstRecord, Chunk* chunk) {
+	qint64 offset = static_cast<qint64>(sizeof(MetricRecordFileHeader) + firstRecord*sizeof(MetricRecord));
+	if(!this->reserve(offset, METRICRECORDER_CHUNK_BYTES)){
+		return false;
+	}
+	uchar* memory = this->file.map(offset, METRICRECORDER_CHUNK_BYTES);
+	if(memory == nullptr){
+		return false;
+	}
+	chunk->memory = memory;
+	chunk->firstRecord = firstRecord;
+	return true;
+}
+
+bool MetricRecorder::reserve(qint64 offset, qint64 length) {
+	//resize() alone would only create a sparse file, writing to an unbacked page of a mapping on a full disk raises SIGBUS.
+	//the blocks are allocated for real, so a full disk is noticed here
+#ifdef Q_OS_LINUX
+	if(!this->file.flush()){
+		return false;
+	}
+	return posix_fallocate(this->file.handle(), offset, length) == 0;
+#else
+	if(this->file.size() < offset+length && !this->file.resize(offset+length)){
+		return false;
+	}
+	QVector<char> zeros(static_cast<int>(qMin(length, static_cast<qint64>(METRICRECORDER_ZERO_BLOCK_BYTES))), 0);
+	if(!this->file.seek(offset)){
+		return false;
+	}
+	for(qint64 written = 0; written < length;){
+		qint64 bytes = qMin(length - written, static_cast<qint64>(zeros.size()));
+		if(this->file.write(zeros.constData(), bytes) != bytes){
+			return false;
+		}
+		written += bytes;
+	}
+	return this->file.flush();
+#endif
+}
+
+void MetricRecorder::unmapChunk(Chunk* chunk) {
+	if(chunk->memory != nullptr){
+		this->file.unmap(chunk->memory);
+		chunk->memory = nullptr;
+	}
+}
@@ -0,0 +1,98 @@
+#ifndef METRICRECORDER_H
+#define METRICRECORDER_H
+
+#include <QtGlobal>
+#include <QString>
+#include <QFile>
+#include <QMutex>
+#include <QAtomicInteger>
+
+#define METRICRECORDER_MAGIC "OCTPZSMR"
+#define METRICRECORDER_FORMAT_VERSION 1
+#define METRICRECORDER_GROWTH_RECORDS 65536 //file grows in chunks of this many records
+#define METRICRECORD_HAS_DEVIATION 0x1 //stdDeviation and coeffOfVariation were calculated for this record
+
+//fixed header at the beginning of every recording. all values are little endian (the byte order of the recording machine).
+//recordCount is updated after every record, so a recording that was not closed properly can still be read up to the last record
+struct MetricRecordFileHeader {
+	char magic[8];
+	quint32 formatVersion;
+	quint32 headerSize;
+	quint32 recordSize;
+	quint32 reserved;
+	quint64 recordCount;
+	qint64 startTimestamp; //LatencyMonitor::now() when the recording was started
+	qint64 startTimeMsSinceEpoch; //wall clock time at startTimestamp, to convert record timestamps to dates
+};
+
+//one calculated metric. timestamps are LatencyMonitor::now() values in ns
+struct MetricRecord {
+	qint64 timestamp; //end of the metric calculation
+	qint64 acquisitionTimestamp;
+	quint64 sequenceNumber;
+	quint64 configurationVersion;
+	quint32 source; //BUFFER_SOURCE
+	quint32 imageMetric; //IMAGE_METRIC
+	quint32 flags;
+	qint32 pixels;
+	qint32 roiX;
+	qint32 roiY;
+	qint32 roiWidth;
+	qint32 roiHeight;
+	double value;
+	double sum;
+	double average;
+	double min;
+	double max;
+	double stdDeviation;
+	double coeffOfVariation;
+};
+
+static_assert(sizeof(MetricRecordFileHeader) == 48, "MetricRecordFileHeader must not contain padding");
+static_assert(sizeof(MetricRecord) == 120, "MetricRecord must not contain padding");
+
+//append only binary recording of calculated metrics in a memory mapped file. the file grows in chunks of
+//METRICRECORDER_GROWTH_RECORDS records that are mapped separately, the next chunk is always reserved on disk and mapped
+//before the current one is full. so append() only copies the record and switches to the prepared chunk, it never
+//resizes or maps the file. the disk blocks of a chunk are allocated before it is mapped, a full disk can not cause
+//a bus error while writing to the mapping, it stops the recording instead. the file is truncated to the recorded size on close().
+//append() may be called from any thread. open(), close() and maintain() must be called from a single thread, maintain() at least
+//once per chunk (the extension calls it with every status update). records that arrive while no chunk is prepared are dropped and counted
+class MetricRecorder
+{
+public:
+	MetricRecorder();
+	~MetricRecorder();
+
+	bool open(QString fileName);
+	void close();
+	void maintain(); //unmaps full chunks and prepares the next one
+	bool isRecording() const {return this->recording.loadAcquire() != 0;}
+	bool isOpen() const;
+	bool append(const MetricRecord& record);
+	quint64 getRecordCount() const;
+	quint64 getDroppedRecords() const {return static_cast<quint64>(this->droppedRecords.loadAcquire());}
+	QString getFileName() const {return this->file.fileName();}
+
+private:
+	struct Chunk {
+		uchar* memory;
+		quint64 firstRecord;
+	};
+
+	mutable QMutex mutex; //only protects the chunk pointers and the record count, no file operation is done while it is held
+	QFile file;
+	MetricRecordFileHeader* header;
+	Chunk currentChunk;
+	Chunk nextChunk;
+	Chunk retiredChunk;
+	bool growthFailed;
+	QAtomicInteger<int> recording;
+	QAtomicInteger<qint64> droppedRecords;
+
+	bool prepareChunk(quint64 firstRecord, Chunk* chunk);
+	bool reserve(qint64 offset, qint64 length);
+	void unmapChunk(Chunk* chunk);
+};
+
+#endif //METRICRECORDER_H
@@ -0,0 +1,167 @@
+#include "pipelinestage.h"
+#include "framepool.h"
+#include "latencymonitor.h"
+
+
+PipelineStage::PipelineStage(QString name, STAGE_INPUT input, int capacity, OVERFLOW_POLICY policy, QObject* parent)
+	: QObject(parent),
+	name(name),
+	input(input),
+	queue(capacity, policy),
+	taskPool(nullptr),
+	draining(0),
+	processed(0),
+	rejected(0),
+	busyNanoseconds(0),
+	polling(0)
+{
+	connect(&this->pollingTimer, &QTimer::timeout, this, &PipelineStage::poll);
+}
+
+PipelineStage::~PipelineStage() {
+	this->clear();
+}
+
+void PipelineStage::setCapacity(int capacity) {
+	if(this->input == STAGE_INPUT_LATEST_FRAME){
+		return;
+	}
+	QList<FrameDescriptor> removedFrames = this->queue.setCapacity(capacity);
+	for(const FrameDescriptor& frame : removedFrames){
+		releaseFrame(frame);
+	}
+}
+
+void PipelineStage::setPollingInterval(int milliseconds) {
+	//called in the thread of this object
+	this->polling.fetchAndStoreOrdered(milliseconds > 0 ? 1 : 0);
+	if(milliseconds > 0){
+		this->pollingTimer.start(milliseconds);
+	}else{
+		this->pollingTimer.stop();
+		this->poll(); //a frame that was pushed after the last timeout would be stuck without this
+	}
+}
+
+int PipelineStage::getCapacity() const {
+	return this->input == STAGE_INPUT_LATEST_FRAME ? 1 : this->queue.getCapacity();
+}
+
+void PipelineStage::setPolicy(OVERFLOW_POLICY policy) {
+	this->queue.setPolicy(policy);
+}
+
+OVERFLOW_POLICY PipelineStage::getPolicy() const {
+	return this->input == STAGE_INPUT_LATEST_FRAME ? OVERFLOW_DROP_OLDEST : this->queue.getPolicy();
+}
+
+bool PipelineStage::isFull() const {
+	//the mailbox always takes the new frame, so it never causes back pressure
+	return this->input == STAGE_INPUT_LATEST_FRAME ? false : this->queue.isFull();
+}
+
+StageCounters PipelineStage::getCounters() const {
+	StageCounters counters;
+	counters.queue = this->input == STAGE_INPUT_LATEST_FRAME ? this->latestFrame.getCounters() : this->queue.getCounters();
+	counters.queue.dropped += this->rejected.loadAcquire();
+	counters.processed = this->processed.loadAcquire();
+	counters.busyNanoseconds = this->busyNanoseconds.loadAcquire();
+	return counters;
+}
+
+bool PipelineStage::push(const FrameDescriptor& frame) {
+	//the reference is taken before the frame becomes visible to the draining thread
+	retainFrame(frame);
+	FrameDescriptor droppedFrame;
+	bool hasDropped = false;
+	bool accepted = false;
+	if(this->input == STAGE_INPUT_LATEST_FRAME){
+		accepted = this->latestFrame.write(frame, &droppedFrame, &hasDropped);
+	}else{
+		accepted = this->queue.push(frame, &droppedFrame, &hasDropped);
+	}
+	if(!accepted){
+		releaseFrame(frame);
+	}
+	if(hasDropped){
+		releaseFrame(droppedFrame);
+	}
+	if(accepted){
+		this->scheduleDrain();
+	}
+	return accepted;
+}
+
+void PipelineStage::clear() {
+	QList<FrameDescriptor> removedFrames = this->queue.clear();
+	for(const FrameDescriptor& frame : removedFrames){
+		releaseFrame(frame);
+	}
+	FrameDescriptor pendingFrame;
+	if(this->latestFrame.read(&pendingFrame)){
+		releaseFrame(pendingFrame);
+	}
+}
+
+bool PipelineStage::pop(FrameDescriptor* frame) {
+	if(this->input == STAGE_INPUT_LATEST_FRAME){
+		return this->latestFrame.read(frame);
+	}
+	return this->queue.pop(frame);
+}
+
+bool PipelineStage::isEmpty() const {
+	if(this->input == STAGE_INPUT_LATEST_FRAME){
+		return !this->latestFrame.hasNewItem();
+	}
+	return this->queue.isEmpty();
+}
+
+void PipelineStage::scheduleDrain() {
+	//at most one drain is scheduled at a time, so the frames of a stage are processed in order and never concurrently
+	if(!this->draining.testAndSetOrdered(0, 1)){
+		return;
+	}
+	if(this->taskPool != nullptr){
+		this->taskPool->submit([this]() {
+			this->drain();
+		});
+	}else if(this->polling.loadAcquire()){
+		//the flag stays set until the next timeout drains the stage, further pushes do not need to do anything
+		return;
+	}else{
+		QMetaObject::invokeMethod(this, "drain", Qt::QueuedConnection);
+	}
+}
+
+void PipelineStage::poll() {
+	//the flag is set by the push that found the stage idle, while polling nothing else drains the stage
+	if(this->draining.loadAcquire()){
+		this->drain();
+	}
+}
+
+void PipelineStage::drain() {
+	forever{
+		FrameDescriptor frame;
+		while(this->pop(&frame)){
+			qint64 startTimestamp = LatencyMonitor::now();
+			bool accepted = true;
+			if(this->processor){
+				accepted = this->processor(frame);
+			}
+			releaseFrame(frame);
+			this->busyNanoseconds.fetchAndAddRelaxed(LatencyMonitor::now() - startTimestamp);
+			if(accepted){
+				this->processed.fetchAndAddRelaxed(1);
+			}else{
+				this->rejected.fetchAndAddRelaxed(1);
+			}
+		}
+		//a frame that was pushed after the last pop but before the flag was reset would be stuck without this check
+		this->draining.storeRelease(0);
+		if(this->isEmpty() || !this->draining.testAndSetOrdered(0, 1)){
+			break;
+		}
+	}
+}
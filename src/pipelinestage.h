@@ -0,0 +1,77 @@
+#ifndef PIPELINESTAGE_H
+#define PIPELINESTAGE_H
+
+#include <QObject>
+#include <QString>
+#include <QAtomicInteger>
+#include <QTimer>
+#include <functional>
+#include "boundedqueue.h"
+#include "triplebuffer.h"
+#include "framedescriptor.h"
+#include "taskpool.h"
+
+enum STAGE_INPUT {
+	STAGE_INPUT_QUEUE, //frames wait in a BoundedQueue and are processed in order
+	STAGE_INPUT_LATEST_FRAME //only the newest frame waits in a TripleBuffer, older pending frames are replaced
+};
+
+struct StageCounters {
+	QueueCounters queue;
+	quint64 processed;
+	qint64 busyNanoseconds;
+};
+
+//one stage of the signal chain behind a bounded queue. push() may be called from any thread. the queued frames are
+//processed one after the other, either by a task in the task pool or, without a task pool, in the thread of this object.
+//every accepted frame holds a reference to its slot until it was processed or dropped. frames the processor rejects are counted as dropped, too.
+//with STAGE_INPUT_LATEST_FRAME capacity and policy are fixed to one frame that is replaced by every new frame.
+//without a task pool every push() posts an event to the thread of this object, which allocates. with a polling interval
+//the stage is drained by a timer in that thread instead, so pushing never allocates and at most delays a frame by the interval
+class PipelineStage : public QObject
+{
+	Q_OBJECT
+public:
+	typedef std::function<bool(const FrameDescriptor&)> Processor; //returns false if the frame could not be processed, it is counted as dropped
+
+	explicit PipelineStage(QString name, STAGE_INPUT input = STAGE_INPUT_QUEUE, int capacity = 1, OVERFLOW_POLICY policy = OVERFLOW_DROP_OLDEST, QObject* parent = nullptr);
+	~PipelineStage();
+
+	QString getName() const {return this->name;}
+	void setProcessor(Processor processor) {this->processor = processor;}
+	void setTaskPool(TaskPool* taskPool) {this->taskPool = taskPool;}
+	void setPollingInterval(int milliseconds);
+	void setCapacity(int capacity);
+	int getCapacity() const;
+	void setPolicy(OVERFLOW_POLICY policy);
+	OVERFLOW_POLICY getPolicy() const;
+	bool isFull() const;
+	StageCounters getCounters() const;
+
+	bool push(const FrameDescriptor& frame);
+	void clear();
+
+private:
+	QString name;
+	STAGE_INPUT input;
+	BoundedQueue<FrameDescriptor> queue;
+	TripleBuffer<FrameDescriptor> latestFrame;
+	Processor processor;
+	TaskPool* taskPool;
+	QAtomicInteger<int> draining;
+	QAtomicInteger<quint64> processed;
+	QAtomicInteger<quint64> rejected;
+	QAtomicInteger<qint64> busyNanoseconds;
+	QAtomicInteger<int> polling;
+	QTimer pollingTimer;
+
+	bool pop(FrameDescriptor* frame);
+	bool isEmpty() const;
+	void scheduleDrain();
+
+private slots:
+	void drain();
+	void poll();
+};
+
+#endif //PIPELINESTAGE_H
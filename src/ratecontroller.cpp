@@ -0,0 +1,95 @@
+#include "ratecontroller.h"
+#include <QtMath>
+
+#define NANOSECONDS_PER_SECOND 1000000000LL
+
+
+RateController::RateController()
+	: targetIntervalNs(0),
+	metricCostNs(0),
+	effectiveRateMilliHz(0),
+	lastAcceptedNs(-1),
+	rateWindowStartNs(0),
+	acceptedInWindow(0),
+	backoffFactor(1.0)
+{
+	this->clock.start();
+	this->setTargetRate(RATECONTROLLER_DEFAULT_RATE_HZ);
+}
+
+void RateController::setTargetRate(double rateInHz) {
+	if(rateInHz <= 0.0){
+		return;
+	}
+	this->targetIntervalNs.storeRelease(static_cast<qint64>(NANOSECONDS_PER_SECOND/rateInHz));
+}
+
+double RateController::getTargetRate() const {
+	qint64 interval = this->targetIntervalNs.loadAcquire();
+	return interval > 0 ? static_cast<double>(NANOSECONDS_PER_SECOND)/interval : 0.0;
+}
+
+double RateController::getEffectiveRate() const {
+	//report zero if no frame has been accepted recently, e.g. because acquisition stopped
+	qint64 lastAccepted = this->lastAcceptedNs.loadAcquire();
+	if(lastAccepted < 0 || this->clock.nsecsElapsed() - lastAccepted > 2*NANOSECONDS_PER_SECOND){
+		return 0.0;
+	}
+	return this->effectiveRateMilliHz.loadAcquire()/1000.0;
+}
+
+RateController::Decision RateController::acceptFrame(bool consumersBusy, bool busyConsumersRejectFrame) {
+	qint64 now = this->clock.nsecsElapsed();
+
+	//the minimal interval between two frames is given by the target rate or by the metric calculation, whichever is longer.
+	//the display is not taken into account: conversion and display only take the newest frame and drop the others
+	qint64 cost = this->metricCostNs.loadAcquire();
+	qint64 interval = qMax(this->targetIntervalNs.loadAcquire(), static_cast<qint64>(cost*RATECONTROLLER_COST_HEADROOM));
+	interval = static_cast<qint64>(interval*this->backoffFactor);
+
+	qint64 lastAccepted = this->lastAcceptedNs.loadAcquire();
+	if(lastAccepted >= 0 && now - lastAccepted < interval){
+		this->updateEffectiveRate(now);
+		return SKIP;
+	}
+
+	//a frame is due but the consumers are still working on earlier ones: back off and offer the next frame after the longer interval.
+	//if the consumers would reject the frame it is not copied at all, otherwise it is accepted and replaces an older queued frame
+	if(consumersBusy){
+		this->backoffFactor = qMin(RATECONTROLLER_MAX_BACKOFF, this->backoffFactor*1.5);
+		this->lastAcceptedNs.storeRelease(now);
+		if(busyConsumersRejectFrame){
+			this->updateEffectiveRate(now);
+			return BUSY;
+		}
+	}else{
+		//slowly recover from previous back off
+		this->backoffFactor = qMax(1.0, this->backoffFactor*0.95);
+	}
+
+	this->lastAcceptedNs.storeRelease(now);
+	this->acceptedInWindow++;
+	this->updateEffectiveRate(now);
+	return ACCEPT;
+}
+
+void RateController::reportMetricCost(qint64 nanoseconds) {
+	this->metricCostNs.storeRelease(smoothCost(this->metricCostNs.loadAcquire(), nanoseconds));
+}
+
+void RateController::updateEffectiveRate(qint64 now) {
+	qint64 windowLength = now - this->rateWindowStartNs;
+	if(windowLength >= NANOSECONDS_PER_SECOND){
+		this->effectiveRateMilliHz.storeRelease((this->acceptedInWindow*NANOSECONDS_PER_SECOND*1000LL)/windowLength);
+		this->rateWindowStartNs = now;
+		this->acceptedInWindow = 0;
+	}
+}
+
+qint64 RateController::smoothCost(qint64 previousCost, qint64 newCost) {
+	//exponential moving average, so single outliers do not throttle the monitor
+	if(previousCost <= 0){
+		return newCost;
+	}
+	return previousCost + (newCost - previousCost)/8;
+}
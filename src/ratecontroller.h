@@ -0,0 +1,47 @@
+#ifndef RATECONTROLLER_H
+#define RATECONTROLLER_H
+
+#include <QElapsedTimer>
+#include <QAtomicInteger>
+
+#define RATECONTROLLER_DEFAULT_RATE_HZ 10.0
+#define RATECONTROLLER_COST_HEADROOM 1.25
+#define RATECONTROLLER_MAX_BACKOFF 64.0
+
+//decides which incoming buffers are used, based on a target update rate and the measured processing cost per frame.
+//acceptFrame() is called from the acquisition thread, the cost reports may come from any worker thread.
+class RateController
+{
+public:
+	enum Decision {
+		SKIP,
+		BUSY,
+		ACCEPT
+	};
+
+	RateController();
+
+	void setTargetRate(double rateInHz);
+	double getTargetRate() const;
+	double getEffectiveRate() const;
+
+	Decision acceptFrame(bool consumersBusy, bool busyConsumersRejectFrame);
+	void reportMetricCost(qint64 nanoseconds);
+
+private:
+	QElapsedTimer clock;
+	QAtomicInteger<qint64> targetIntervalNs;
+	QAtomicInteger<qint64> metricCostNs;
+	QAtomicInteger<qint64> effectiveRateMilliHz;
+	QAtomicInteger<qint64> lastAcceptedNs;
+
+	//only accessed from the acquisition thread
+	qint64 rateWindowStartNs;
+	int acceptedInWindow;
+	double backoffFactor;
+
+	void updateEffectiveRate(qint64 now);
+	static qint64 smoothCost(qint64 previousCost, qint64 newCost);
+};
+
+#endif //RATECONTROLLER_H
@@ -0,0 +1,104 @@
+#include "referencemetric.h"
+#include <QRect>
+#include <cmath>
+#include <limits>
+
+
+quint32 ReferenceMetric::sampleAt(const FrameDescriptor& frame, int x, int y) {
+	//same storage as in the signal chain: up to 8 bit in 1 byte, up to 16 bit in 2 bytes, more than 16 bit in 4 bytes
+	const uchar* line = static_cast<const uchar*>(frame.data) + static_cast<size_t>(y)*frame.bytesPerLine;
+	if(frame.bitDepth <= 8){
+		return line[x];
+	}
+	if(frame.bitDepth <= 16){
+		return reinterpret_cast<const quint16*>(line)[x];
+	}
+	return reinterpret_cast<const quint32*>(line)[x];
+}
+
+ReferenceStatistics ReferenceMetric::calculateStatistics(const FrameDescriptor& frame) {
+	//the roi is clipped to the frame. an empty roi has no pixels, all other values are nan then
+	QRect roi = frame.roi.intersected(QRect(0, 0, static_cast<int>(frame.samplesPerLine), static_cast<int>(frame.linesPerFrame)));
+	ReferenceStatistics stats;
+	long double nan = std::numeric_limits<long double>::quiet_NaN();
+	stats.pixels = static_cast<qint64>(roi.width())*roi.height();
+	stats.sum = 0;
+	stats.min = nan;
+	stats.max = nan;
+	stats.average = nan;
+	stats.stdDeviation = nan;
+	stats.coeffOfVariation = nan;
+	if(stats.pixels <= 0){
+		stats.pixels = 0;
+		return stats;
+	}
+
+	//first pass: sum, min and max
+	long double minValue = std::numeric_limits<long double>::infinity();
+	long double maxValue = -std::numeric_limits<long double>::infinity();
+	long double sum = 0;
+	for(int y = roi.top(); y <= roi.bottom(); y++){
+		for(int x = roi.left(); x <= roi.right(); x++){
+			long double value = sampleAt(frame, x, y);
+			sum += value;
+			if(value < minValue){minValue = value;}
+			if(value > maxValue){maxValue = value;}
+		}
+	}
+	long double average = sum/stats.pixels;
+
+	//second pass: squared deviations from the mean
+	long double squaredDeviations = 0;
+	for(int y = roi.top(); y <= roi.bottom(); y++){
+		for(int x = roi.left(); x <= roi.right(); x++){
+			long double deviation = sampleAt(frame, x, y) - average;
+			squaredDeviations += deviation*deviation;
+		}
+	}
+
+	stats.sum = sum;
+	stats.min = minValue;
+	stats.max = maxValue;
+	stats.average = average;
+	stats.stdDeviation = std::sqrt(squaredDeviations/stats.pixels);
+	stats.coeffOfVariation = stats.stdDeviation/average;
+	return stats;
+}
+
+long double ReferenceMetric::metricValue(const ReferenceStatistics& stats, IMAGE_METRIC metric) {
+	switch(metric){
+		case SUM: return stats.sum;
+		case AVERAGE: return stats.average;
+		case STDDEV: return stats.stdDeviation;
+		case COEFFVAR: return stats.coeffOfVariation;
+		default: return stats.sum;
+	}
+}
+
+uchar ReferenceMetric::mapSampleTo8bit(quint32 sample, unsigned int bitDepth, const DisplayMapping& mapping) {
+	//window, level, logarithmic mapping and gamma evaluated directly for the sample, without lookup table
+	long double low = 0;
+	long double high = std::ldexp(1.0L, static_cast<int>(bitDepth)) - 1.0L;
+	if(mapping.window > 0){
+		low = static_cast<long double>(mapping.level) - static_cast<long double>(mapping.window)/2.0L;
+		high = static_cast<long double>(mapping.level) + static_cast<long double>(mapping.window)/2.0L;
+	}
+	if(high <= low){
+		return sample >= high ? 255 : 0;
+	}
+	long double t = (sample - low)/(high - low);
+	t = t < 0 ? 0 : (t > 1 ? 1 : t);
+	if(mapping.isLinear()){
+		//truncated like the conversion in the signal chain, scaled before the division so that samples on a step are exact
+		long double value = std::floor((sample - low)*255.0L/(high - low));
+		return static_cast<uchar>(value < 0 ? 0 : (value > 255 ? 255 : value));
+	}
+	if(mapping.logarithmic){
+		t = std::log1p(t*(static_cast<long double>(DISPLAY_LOG_RANGE) - 1.0L))/std::log(static_cast<long double>(DISPLAY_LOG_RANGE));
+	}
+	if(mapping.gamma > 0 && mapping.gamma != 1.0){
+		t = std::pow(t, 1.0L/static_cast<long double>(mapping.gamma));
+	}
+	long double value = std::floor(t*255.0L);
+	return static_cast<uchar>(value < 0 ? 0 : (value > 255 ? 255 : value));
+}
@@ -0,0 +1,31 @@
+#ifndef REFERENCEMETRIC_H
+#define REFERENCEMETRIC_H
+
+#include <QtGlobal>
+#include "framedescriptor.h"
+#include "displaylookuptable.h"
+
+struct ReferenceStatistics {
+	qint64 pixels;
+	long double sum;
+	long double min;
+	long double max;
+	long double average;
+	long double stdDeviation;
+	long double coeffOfVariation;
+};
+
+//scalar reference of the metric calculation and the bit depth conversion. it is kept as simple as possible and accumulates in
+//long double (64 bit mantissa on x86, sums of up to 2^32 samples of 32 bit are exact there; msvc uses double for long double).
+//it defines the expected results of ImageMetricCalculator and BitDepthConverter: every faster, threaded or vectorized path has
+//to agree with it within the tolerances of tools/signalmonitor-validate. it is not meant to be used in the signal chain
+class ReferenceMetric
+{
+public:
+	static quint32 sampleAt(const FrameDescriptor& frame, int x, int y);
+	static ReferenceStatistics calculateStatistics(const FrameDescriptor& frame);
+	static long double metricValue(const ReferenceStatistics& stats, IMAGE_METRIC metric);
+	static uchar mapSampleTo8bit(quint32 sample, unsigned int bitDepth, const DisplayMapping& mapping);
+};
+
+#endif //REFERENCEMETRIC_H
@@ -0,0 +1,265 @@
+#include "replaysource.h"
+#include "flightrecorder.h"
+#include "latencymonitor.h"
+#include <QStringList>
+#include <QtMath>
+#include <string.h>
+#include <climits>
+
+#ifdef Q_OS_LINUX
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+
+bool ReplayRawFormat::fromString(QString text, ReplayRawFormat* format) {
+	//"bit depth, samples per line, lines per frame, frames per buffer, buffers per volume, buffers per second"
+	QStringList values = text.split(",");
+	if(values.size() != 6){
+		return false;
+	}
+	bool ok[6];
+	ReplayRawFormat parsed;
+	parsed.bitDepth = values.at(0).trimmed().toUInt(&ok[0]);
+	parsed.samplesPerLine = values.at(1).trimmed().toUInt(&ok[1]);
+	parsed.linesPerFrame = values.at(2).trimmed().toUInt(&ok[2]);
+	parsed.framesPerBuffer = values.at(3).trimmed().toUInt(&ok[3]);
+	parsed.buffersPerVolume = values.at(4).trimmed().toUInt(&ok[4]);
+	parsed.buffersPerSecond = values.at(5).trimmed().toDouble(&ok[5]);
+	for(bool valueOk : ok){
+		if(!valueOk){
+			return false;
+		}
+	}
+	if(parsed.bitDepth == 0 || parsed.bitDepth > 32 || parsed.samplesPerLine == 0 || parsed.linesPerFrame == 0 || parsed.framesPerBuffer == 0 || parsed.buffersPerVolume == 0 || parsed.buffersPerSecond <= 0.0){
+		return false;
+	}
+	*format = parsed;
+	return true;
+}
+
+QString ReplayRawFormat::toString() const {
+	return QString("%1, %2, %3, %4, %5, %6").arg(this->bitDepth).arg(this->samplesPerLine).arg(this->linesPerFrame)
+		.arg(this->framesPerBuffer).arg(this->buffersPerVolume).arg(this->buffersPerSecond);
+}
+
+
+ReplaySource::ReplaySource(QObject* parent)
+	: QThread(parent),
+	mappedData(nullptr),
+	mappedSize(0),
+	flightRecord(false),
+	sink(nullptr),
+	speed(REPLAY_REAL_TIME),
+	stopRequested(0)
+{
+	this->setObjectName("Signal Monitor replay");
+}
+
+ReplaySource::~ReplaySource() {
+	this->stopReplay();
+	this->close();
+}
+
+bool ReplaySource::open(QString fileName, const ReplayRawFormat& rawFormat) {
+	if(this->isRunning()){
+		return false;
+	}
+	this->close();
+	this->file.setFileName(fileName);
+	if(!this->file.open(QFile::ReadOnly)){
+		return false;
+	}
+	this->mappedSize = this->file.size();
+	this->mappedData = this->mappedSize > 0 ? this->file.map(0, this->mappedSize) : nullptr;
+	if(this->mappedData == nullptr){
+		this->close();
+		return false;
+	}
+
+#ifdef Q_OS_LINUX
+	//the file is read front to back once, the kernel may use large read ahead and free pages behind the current position early
+	madvise(this->mappedData, static_cast<size_t>(this->mappedSize), MADV_SEQUENTIAL);
+#endif
+
+	//flight records are recognized by their magic, every other file is treated as OCTproZ raw recording
+	this->flightRecord = this->mappedSize >= static_cast<qint64>(sizeof(FlightRecordFileHeader)) && memcmp(this->mappedData, FLIGHTRECORDER_MAGIC, 8) == 0;
+	bool indexed = this->flightRecord ? this->indexFlightRecord() : this->indexRawFile(rawFormat);
+	if(!indexed || this->entries.isEmpty()){
+		this->close();
+		return false;
+	}
+	return true;
+}
+
+void ReplaySource::close() {
+	if(this->isRunning()){
+		return;
+	}
+	if(this->mappedData != nullptr){
+		this->file.unmap(this->mappedData);
+		this->mappedData = nullptr;
+	}
+	this->mappedSize = 0;
+	this->flightRecord = false;
+	this->entries.clear();
+	this->file.close();
+}
+
+void ReplaySource::stopReplay() {
+	this->stopRequested.storeRelease(1);
+	this->wait();
+	this->stopRequested.storeRelease(0);
+}
+
+bool ReplaySource::indexRawFile(const ReplayRawFormat& rawFormat) {
+	//a raw recording is a sequence of complete buffers, an incomplete buffer at the end of the file is ignored
+	size_t bytesPerSample = static_cast<size_t>(ceil(static_cast<double>(rawFormat.bitDepth)/8.0));
+	size_t bytesPerBuffer = static_cast<size_t>(rawFormat.samplesPerLine)*rawFormat.linesPerFrame*rawFormat.framesPerBuffer*bytesPerSample;
+	if(bytesPerBuffer == 0 || rawFormat.buffersPerSecond <= 0.0){
+		return false;
+	}
+	qint64 numberOfBuffers = this->mappedSize/static_cast<qint64>(bytesPerBuffer);
+	double nanosecondsPerBuffer = 1000000000.0/rawFormat.buffersPerSecond;
+	this->entries.reserve(static_cast<int>(qMin(numberOfBuffers, static_cast<qint64>(INT_MAX))));
+	for(qint64 i = 0; i < numberOfBuffers && i < INT_MAX; i++){
+		Entry entry;
+		entry.data = this->mappedData + i*static_cast<qint64>(bytesPerBuffer);
+		entry.size = bytesPerBuffer;
+		entry.bitDepth = rawFormat.bitDepth;
+		entry.samplesPerLine = rawFormat.samplesPerLine;
+		entry.linesPerFrame = rawFormat.linesPerFrame;
+		entry.framesPerBuffer = rawFormat.framesPerBuffer;
+		entry.buffersPerVolume = rawFormat.buffersPerVolume;
+		entry.bufferNr = static_cast<unsigned int>(i%rawFormat.buffersPerVolume);
+		entry.timestamp = static_cast<qint64>(i*nanosecondsPerBuffer);
+		this->entries.append(entry);
+	}
+	return true;
+}
+
+bool ReplaySource::indexFlightRecord() {
+	//every recorded roi is replayed as a buffer with a single frame, so the roi of the monitor refers to the recorded roi
+	FlightRecordFileHeader fileHeader;
+	memcpy(&fileHeader, this->mappedData, sizeof(FlightRecordFileHeader));
+	if(fileHeader.formatVersion != FLIGHTRECORDER_FORMAT_VERSION || fileHeader.headerSize < sizeof(FlightRecordFileHeader) || fileHeader.frameHeaderSize < sizeof(FlightRecordFrameHeader)){
+		return false;
+	}
+	qint64 offset = fileHeader.headerSize;
+	qint64 firstTimestamp = 0;
+	for(quint32 i = 0; i < fileHeader.numberOfFrames; i++){
+		if(offset + fileHeader.frameHeaderSize > this->mappedSize){
+			return false;
+		}
+		FlightRecordFrameHeader frameHeader;
+		memcpy(&frameHeader, this->mappedData + offset, sizeof(FlightRecordFrameHeader));
+		offset += fileHeader.frameHeaderSize;
+		//same limits as for raw files, the sample size has to match the bit depth as written by FlightRecorder::capture()
+		if(frameHeader.bitDepth == 0 || frameHeader.bitDepth > 32 || frameHeader.bytesPerSample != (frameHeader.bitDepth+7)/8){
+			return false;
+		}
+		size_t expectedSize = static_cast<size_t>(qMax(0, frameHeader.roiWidth))*static_cast<size_t>(qMax(0, frameHeader.roiHeight))*frameHeader.bytesPerSample;
+		if(frameHeader.dataSize != expectedSize || expectedSize == 0 || offset + frameHeader.dataSize > this->mappedSize){
+			return false;
+		}
+		if(i == 0){
+			firstTimestamp = frameHeader.acquisitionTimestamp;
+		}
+		Entry entry;
+		entry.data = this->mappedData + offset;
+		entry.size = frameHeader.dataSize;
+		entry.bitDepth = frameHeader.bitDepth;
+		entry.samplesPerLine = static_cast<unsigned int>(frameHeader.roiWidth);
+		entry.linesPerFrame = static_cast<unsigned int>(frameHeader.roiHeight);
+		entry.framesPerBuffer = 1;
+		entry.buffersPerVolume = 1;
+		entry.bufferNr = 0;
+		entry.timestamp = qMax(static_cast<qint64>(0), frameHeader.acquisitionTimestamp - firstTimestamp);
+		this->entries.append(entry);
+		offset += frameHeader.dataSize;
+	}
+	return true;
+}
+
+void ReplaySource::run() {
+	qint64 startTimestamp = LatencyMonitor::now();
+	qint64 readAheadEnd = 0;
+	qint64 replayedEnd = 0;
+	int replayedBuffers = 0;
+	bool stopped = false;
+	for(const Entry& entry : this->entries){
+		if(this->stopRequested.loadAcquire()){
+			stopped = true;
+			break;
+		}
+
+		//the read ahead window is extended in large steps, so madvise is not called for every buffer
+		qint64 bufferBegin = entry.data - this->mappedData;
+		qint64 bufferEnd = bufferBegin + static_cast<qint64>(entry.size);
+		if(bufferEnd > readAheadEnd){
+			qint64 windowEnd = qMin(this->mappedSize, bufferEnd + REPLAY_READ_AHEAD_BYTES);
+			this->adviseReadAhead(qMax(readAheadEnd, bufferBegin), windowEnd);
+			readAheadEnd = windowEnd;
+		}
+		if(bufferBegin - replayedEnd >= REPLAY_READ_AHEAD_BYTES){
+			this->adviseReplayed(replayedEnd, bufferBegin);
+			replayedEnd = bufferBegin;
+		}
+
+		if(this->speed.loadAcquire() == REPLAY_REAL_TIME && !this->waitUntil(startTimestamp + entry.timestamp)){
+			stopped = true;
+			break;
+		}
+		if(this->sink){
+			this->sink(const_cast<uchar*>(entry.data), entry.bitDepth, entry.samplesPerLine, entry.linesPerFrame, entry.framesPerBuffer, entry.buffersPerVolume, entry.bufferNr);
+		}
+		replayedBuffers++;
+	}
+	emit replayFinished(replayedBuffers, LatencyMonitor::now() - startTimestamp, stopped);
+}
+
+bool ReplaySource::waitUntil(qint64 timestamp) {
+	//sleeps in short steps, so a stop request or a switch to maximum speed is noticed quickly
+	qint64 remaining = timestamp - LatencyMonitor::now();
+	while(remaining > 0){
+		if(this->stopRequested.loadAcquire()){
+			return false;
+		}
+		if(this->speed.loadAcquire() != REPLAY_REAL_TIME){
+			return true;
+		}
+		QThread::usleep(static_cast<unsigned long>(qMin(remaining/1000 + 1, static_cast<qint64>(REPLAY_MAXIMUM_WAIT_US))));
+		remaining = timestamp - LatencyMonitor::now();
+	}
+	return true;
+}
+
+void ReplaySource::adviseReadAhead(qint64 begin, qint64 end) {
+#ifdef Q_OS_LINUX
+	//the kernel starts reading the window in the background, the copy in the ingest then mostly finds the pages in the page cache
+	uintptr_t pageSize = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+	uintptr_t alignedBegin = reinterpret_cast<uintptr_t>(this->mappedData + begin) & ~(pageSize-1);
+	uintptr_t alignedEnd = reinterpret_cast<uintptr_t>(this->mappedData + end);
+	if(alignedEnd > alignedBegin){
+		madvise(reinterpret_cast<void*>(alignedBegin), alignedEnd - alignedBegin, MADV_WILLNEED);
+	}
+#else
+	Q_UNUSED(begin)
+	Q_UNUSED(end)
+#endif
+}
+
+void ReplaySource::adviseReplayed(qint64 begin, qint64 end) {
+#ifdef Q_OS_LINUX
+	//replayed pages are not needed any more. the mapping is read only, so dropping them from this process never loses data
+	uintptr_t pageSize = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+	uintptr_t alignedBegin = (reinterpret_cast<uintptr_t>(this->mappedData + begin) + pageSize-1) & ~(pageSize-1);
+	uintptr_t alignedEnd = reinterpret_cast<uintptr_t>(this->mappedData + end) & ~(pageSize-1);
+	if(alignedEnd > alignedBegin){
+		madvise(reinterpret_cast<void*>(alignedBegin), alignedEnd - alignedBegin, MADV_DONTNEED);
+	}
+#else
+	Q_UNUSED(begin)
+	Q_UNUSED(end)
+#endif
+}
@@ -0,0 +1,90 @@
+#ifndef REPLAYSOURCE_H
+#define REPLAYSOURCE_H
+
+#include <QThread>
+#include <QFile>
+#include <QString>
+#include <QVector>
+#include <QAtomicInteger>
+#include <functional>
+
+#define REPLAY_READ_AHEAD_BYTES (32*1024*1024)
+#define REPLAY_MAXIMUM_WAIT_US 2000
+
+enum REPLAY_SPEED {
+	REPLAY_REAL_TIME,
+	REPLAY_MAXIMUM_SPEED
+};
+
+//OCTproZ raw recordings are plain buffers without a header, their dimensions have to be known.
+//buffersPerSecond is used for real time replay, flight records contain the acquisition timestamp of every frame instead
+struct ReplayRawFormat {
+	unsigned int bitDepth;
+	unsigned int samplesPerLine;
+	unsigned int linesPerFrame;
+	unsigned int framesPerBuffer;
+	unsigned int buffersPerVolume;
+	double buffersPerSecond;
+
+	static bool fromString(QString text, ReplayRawFormat* format);
+	QString toString() const;
+};
+
+//replays a recorded file through the same path as live data. the file is memory mapped, the kernel is told to read ahead
+//of the current position and to drop the pages that were already replayed, so files larger than the memory can be replayed.
+//the sink is called from the replay thread with the same arguments as Extension::rawDataReceived()
+class ReplaySource : public QThread
+{
+	Q_OBJECT
+public:
+	typedef std::function<void(void* buffer, unsigned int bitDepth, unsigned int samplesPerLine, unsigned int linesPerFrame, unsigned int framesPerBuffer, unsigned int buffersPerVolume, unsigned int currentBufferNr)> BufferSink;
+
+	explicit ReplaySource(QObject* parent = nullptr);
+	~ReplaySource();
+
+	void setSink(BufferSink sink) {this->sink = sink;}
+	bool open(QString fileName, const ReplayRawFormat& rawFormat);
+	void close();
+	void stopReplay();
+	void setSpeed(REPLAY_SPEED speed) {this->speed.storeRelease(static_cast<int>(speed));}
+	bool isFlightRecord() const {return this->flightRecord;}
+	int getNumberOfBuffers() const {return this->entries.size();}
+	QString getFileName() const {return this->file.fileName();}
+
+protected:
+	void run() override;
+
+private:
+	struct Entry {
+		const uchar* data;
+		size_t size;
+		unsigned int bitDepth;
+		unsigned int samplesPerLine;
+		unsigned int linesPerFrame;
+		unsigned int framesPerBuffer;
+		unsigned int buffersPerVolume;
+		unsigned int bufferNr;
+		qint64 timestamp; //ns, relative to the first entry
+	};
+
+	QFile file;
+	uchar* mappedData;
+	qint64 mappedSize;
+	bool flightRecord;
+	QVector<Entry> entries;
+	BufferSink sink;
+	QAtomicInteger<int> speed;
+	QAtomicInteger<int> stopRequested;
+
+	bool indexRawFile(const ReplayRawFormat& rawFormat);
+	bool indexFlightRecord();
+	void adviseReadAhead(qint64 begin, qint64 end); //byte offsets in the file
+	void adviseReplayed(qint64 begin, qint64 end);
+	bool waitUntil(qint64 timestamp);
+
+signals:
+	void replayFinished(int numberOfBuffers, qint64 nanoseconds, bool stopped);
+	void error(QString);
+};
+
+#endif //REPLAYSOURCE_H
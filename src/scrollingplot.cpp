@@ -1,4 +1,5 @@
 #include "scrollingplot.h"
+#include "tracer.h"
 #include <QPainterPathStroker>
 
 ScrollingPlot::ScrollingPlot(QWidget* parent) : QCustomPlot(parent){
@@ -25,11 +26,15 @@ ScrollingPlot::ScrollingPlot(QWidget* parent) : QCustomPlot(parent){
 	this->axisRect()->insetLayout()->setInsetAlignment(0, Qt::AlignRight|Qt::AlignBottom);
 
 	//configure curve graph
+	this->curveData = QSharedPointer<ScrollingPlotData>(new ScrollingPlotData());
 	this->addGraph();
+	this->graph(0)->setData(this->curveData);
 	this->setCurveColor(curveColor);
 
 	//configure reference curve graph
+	this->referenceCurveData = QSharedPointer<ScrollingPlotData>(new ScrollingPlotData());
 	this->addGraph();
+	this->graph(1)->setData(this->referenceCurveData);
 	this->setReferenceCurveColor(referenceCurveColor);
 
 	//configure axis
@@ -97,6 +102,18 @@ void ScrollingPlot::setAxisVisible(bool visible) {
 }
 
 void ScrollingPlot::addDataToCurves(double curveDataPoint, double referenceDataPoint){
+	TRACE_SCOPE("plot");
+	this->appendDataToCurves(curveDataPoint, referenceDataPoint);
+	this->updateCurves();
+}
+
+void ScrollingPlot::addDataToCurve(double curveDataPoint){
+	TRACE_SCOPE("plot");
+	this->appendDataToCurve(curveDataPoint);
+	this->updateCurve();
+}
+
+void ScrollingPlot::appendDataToCurves(double curveDataPoint, double referenceDataPoint){
 	this->dataPointCounter++;
 	if(this->dataPointCounter > this->maxDataPoints){
 		this->clearPlot();
@@ -104,7 +121,18 @@ void ScrollingPlot::addDataToCurves(double curveDataPoint, double referenceDataP
 
 	this->graph(0)->addData(dataPointCounter, curveDataPoint);
 	this->graph(1)->addData(dataPointCounter, referenceDataPoint);
+}
+
+void ScrollingPlot::appendDataToCurve(double curveDataPoint){
+	this->dataPointCounter++;
+	if(this->dataPointCounter > this->maxDataPoints){
+		this->clearPlot();
+	}
+
+	this->graph(0)->addData(dataPointCounter, curveDataPoint);
+}
 
+void ScrollingPlot::updateCurves(){
 	//scale y axis
 	this->rescaleAxes(true); //todo: disable auto rescaling if user zooms with mouse wheel and reactive it after double click
 	//this->graph(1)->rescaleValueAxis();
@@ -115,17 +143,13 @@ void ScrollingPlot::addDataToCurves(double curveDataPoint, double referenceDataP
 	this->xAxis2->setRange(dataPointCounter, this->visibleDataPoints, Qt::AlignRight);
 
 	this->zoomOutSlightly();
-	this->replot();
-}
-
-void ScrollingPlot::addDataToCurve(double curveDataPoint){
-	this->dataPointCounter++;
-	if(this->dataPointCounter > this->maxDataPoints){
-		this->clearPlot();
+	{
+		TRACE_SCOPE("replot");
+		this->replot();
 	}
+}
 
-	this->graph(0)->addData(dataPointCounter, curveDataPoint);
-
+void ScrollingPlot::updateCurve(){
 	//auto scroll plot in x direction
 	this->xAxis->setRange(dataPointCounter, this->visibleDataPoints, Qt::AlignRight);
 
@@ -138,7 +162,10 @@ void ScrollingPlot::addDataToCurve(double curveDataPoint){
 		this->yAxis->setRange(range.lower - padding, range.upper + padding);
 	}
 
-	this->replot();
+	{
+		TRACE_SCOPE("replot");
+		this->replot();
+	}
 }
 
 void ScrollingPlot::clearPlot() {
@@ -218,7 +245,10 @@ void ScrollingPlot::mouseDoubleClickEvent(QMouseEvent* event) {
 }
 
 void ScrollingPlot::setMaxNumberOfDataPoints(int maxDataPoints) {
+	//the capacity is only reserved, memory pages are not used before data points are written to them
 	this->maxDataPoints = maxDataPoints;
+	this->curveData->reserve(maxDataPoints);
+	this->referenceCurveData->reserve(maxDataPoints);
 }
 
 void ScrollingPlot::setNumberOfVisibleDataPoints(int visibleDataPoints) {
@@ -3,6 +3,13 @@
 
 #include "qcustomplot.h"
 
+//graph data with a capacity that can be reserved, so appending data points up to the maximum number of data points never allocates
+class ScrollingPlotData : public QCPGraphDataContainer
+{
+public:
+	void reserve(int size) {this->mData.reserve(size);}
+};
+
 class ScrollingPlot : public QCustomPlot
 {
 	Q_OBJECT
@@ -20,11 +27,20 @@ public:
 	void addDataToCurve(double curveDataPoint);
 	void clearPlot();
 
+	//the append methods only add data points, the plot is scrolled, scaled and redrawn by the next update call.
+	//this way several data points that arrived at once are drawn with one replot
+	void appendDataToCurves(double curveDataPoint, double referenceDataPoint);
+	void appendDataToCurve(double curveDataPoint);
+	void updateCurves();
+	void updateCurve();
+
 
 private:
 	void setAxisColor(QColor color);
 	void zoomOutSlightly();
 
+	QSharedPointer<ScrollingPlotData> curveData;
+	QSharedPointer<ScrollingPlotData> referenceCurveData;
 	QVector<qreal> sampleNumbers;
 	QVector<qreal> curve;
 	QVector<qreal> referenceCurve;
@@ -1,263 +1,640 @@
 #include "signalmonitor.h"
+#include "threadtuning.h"
+
+#define STATUS_UPDATE_INTERVAL_MS 500
+#define LOST_BUFFER_REPORT_INTERVAL_MS 10000
+#define METRIC_DISPLAY_INTERVAL_MS 10
+#define DISPLAY_POLLING_INTERVAL_MS 10
 
 
 SignalMonitor::SignalMonitor()
 	: Extension(),
-	form(new SignalMonitorForm()),
-	metricCalculator(new ImageMetricCalculator()),
-	bufferCounter(0),
-	copyBufferId(-1),
-	bytesPerFrameProcessed(0),
-	bytesPerFrameRaw(0),
-	isCalculating(false),
+	taskPool(nullptr),
+	form(nullptr),
+	ingestRaw(new FrameIngest(RAW, this)),
+	ingestProcessed(new FrameIngest(PROCESSED, this)),
+	ingestReplay(new FrameIngest(REPLAY, this)),
+	metricCalculatorRaw(nullptr),
+	metricCalculatorProcessed(nullptr),
+	metricCalculatorReplay(nullptr),
+	bitConverter(nullptr),
+	metricStageRaw(nullptr),
+	metricStageProcessed(nullptr),
+	metricStageReplay(nullptr),
+	convertStage(nullptr),
+	renderStage(nullptr),
+	flightRecorder(nullptr),
+	replaySource(nullptr),
 	active(false),
-	bufferNr(0),
-	nthBuffer(10),
-	frameNr(0)
+	metricSamples(METRIC_DISPLAY_QUEUE_CAPACITY, OVERFLOW_DROP_OLDEST),
+	reportedCountersRaw(),
+	reportedCountersProcessed(),
+	statusUpdateCounter(0),
+	acquisitionCoreHistory{},
+	acquisitionCoreHistoryIndex(0),
+	appliedWorkerCoreMask(0),
+	appliedWorkerNiceLevel(-1),
+	reportedThreadSettingsFailures(0),
+	flightRecorderConditionMet{0, 0, 0},
+	droppedMetricSamples{0, 0, 0}
 {
 	qRegisterMetaType<SignalMonitorParameters>("SignalMonitorParameters");
+	qRegisterMetaType<FrameDescriptor>("FrameDescriptor");
 
 	this->setType(EXTENSION);
 	this->displayStyle = SEPARATE_WINDOW;
 	this->name = "Signal Monitor";
 	this->toolTip = "OCT signal strength monitor";
 
-	this->setupGuiConnections();
-	this->setupMetricCalculator();
-	this->initializeFrameBuffers();
+	//OCTproZ loads every extension at startup. gui, worker threads and signal chain are only created when the extension is used (see createMonitor())
 }
 
 SignalMonitor::~SignalMonitor() {
-	metricCalculatorThread.quit();
-	metricCalculatorThread.wait();
-
+	if(this->form == nullptr){
+		return;
+	}
+	//no new frames are replayed while the signal chain is taken down.
+	//the pool finishes all queued tasks before the objects they use are deleted. frames that are still queued are released while their pools exist
+	this->replaySource->stopReplay();
+	delete this->taskPool;
+	this->taskPool = nullptr;
+	FrameIngest* ingests[] = {this->ingestRaw, this->ingestProcessed, this->ingestReplay};
+	for(FrameIngest* ingest : ingests){
+		ingest->setTaskPool(nullptr);
+	}
+	PipelineStage* stages[] = {this->metricStageRaw, this->metricStageProcessed, this->metricStageReplay, this->convertStage, this->renderStage};
+	for(PipelineStage* stage : stages){
+		stage->setTaskPool(nullptr);
+		stage->clear();
+	}
 	delete this->form;
-
-	this->releaseFrameBuffers(this->frameBuffersProcessed);
-	this->releaseFrameBuffers(this->frameBuffersRaw);
 }
 
 QWidget* SignalMonitor::getWidget() {
+	this->createMonitor();
 	return this->form;
 }
 
 void SignalMonitor::activateExtension() {
 	//this method is called by OCTproZ as soon as user activates the extension. If the extension controls hardware components, they can be prepared, activated, initialized or started here.
+	this->createMonitor();
+	this->taskPool->start();
+	this->statusTimer.start();
+	this->metricDisplayTimer.start();
+	this->renderStage->setPollingInterval(DISPLAY_POLLING_INTERVAL_MS);
 	this->active = true;
 }
 
 void SignalMonitor::deactivateExtension() {
 	//this method is called by OCTproZ as soon as user deactivates the extension. If the extension controls hardware components, they can be deactivated, resetted or stopped here.
 	this->active = false;
+	if(this->form != nullptr){
+		//the workers finish the frames that are already queued and exit, they are started again on the next activation
+		this->replaySource->stopReplay();
+		this->statusTimer.stop();
+		this->taskPool->stop();
+		this->metricDisplayTimer.stop();
+		this->displayMetricSamples();
+		this->renderStage->setPollingInterval(0);
+		this->reportSessionSummary();
+	}
 }
 
 void SignalMonitor::settingsLoaded(QVariantMap settings) {
 	//this method is called by OCTproZ and provides a QVariantMap with stored settings/parameters.
+	//if the gui does not exist yet, the settings are applied when it is created
+	this->settingsMap = settings;
+	if(this->form == nullptr){
+		return;
+	}
 	this->form->setSettings(settings); //update gui with stored settings
+	this->applyParameters(this->form->getParameters());
+}
+
+void SignalMonitor::createMonitor() {
+	if(this->form != nullptr){
+		return;
+	}
+	this->taskPool = new TaskPool();
+	this->form = new SignalMonitorForm();
+	this->bitConverter = new BitDepthConverter(this);
+	this->metricStageRaw = new PipelineStage(tr("Raw metric"), STAGE_INPUT_QUEUE, 2, OVERFLOW_DROP_OLDEST, this);
+	this->metricStageProcessed = new PipelineStage(tr("Processed metric"), STAGE_INPUT_QUEUE, 2, OVERFLOW_DROP_OLDEST, this);
+	this->metricStageReplay = new PipelineStage(tr("Replay metric"), STAGE_INPUT_QUEUE, 2, OVERFLOW_DROP_OLDEST, this);
+	this->convertStage = new PipelineStage(tr("Conversion"), STAGE_INPUT_LATEST_FRAME, 1, OVERFLOW_DROP_OLDEST, this);
+	this->renderStage = new PipelineStage(tr("Display"), STAGE_INPUT_LATEST_FRAME, 1, OVERFLOW_DROP_OLDEST, this);
+	this->flightRecorder = new FlightRecorder(this);
+	this->replaySource = new ReplaySource(this);
+
+	this->form->setLatencyMonitor(&this->latencyMonitor);
+	this->setupGuiConnections();
+	this->setupDisplayPipeline();
+	this->setupFlightRecorder();
+	this->setupIngest(this->ingestRaw);
+	this->setupIngest(this->ingestProcessed);
+	this->setupIngest(this->ingestReplay);
+	this->metricCalculatorRaw = this->setupMetricCalculator(this->ingestRaw, this->metricStageRaw);
+	this->metricCalculatorProcessed = this->setupMetricCalculator(this->ingestProcessed, this->metricStageProcessed);
+	this->metricCalculatorReplay = this->setupMetricCalculator(this->ingestReplay, this->metricStageReplay);
+	this->setupMetricDisplay();
+	this->setupReplay();
+	this->setupStatusUpdates();
+	this->form->setSettings(this->settingsMap);
+	this->applyParameters(this->form->getParameters());
 }
 
 void SignalMonitor::setupGuiConnections() {
 	connect(this->form, &SignalMonitorForm::info, this, &SignalMonitor::info);
 	connect(this->form, &SignalMonitorForm::error, this, &SignalMonitor::error);
-	connect(this, &SignalMonitor::maxBuffers, this->form, &SignalMonitorForm::setMaximumBufferNr);
-	connect(this, &SignalMonitor::maxFrames, this->form, &SignalMonitorForm::setMaximumFrameNr);
 
 	//store settings
 	connect(this->form, &SignalMonitorForm::paramsChanged, this, &SignalMonitor::storeParameters);
 
 	//image display connections
 	ImageDisplay* imageDisplay = this->form->getImageDisplay();
-	connect(this, &SignalMonitor::newFrame, imageDisplay, &ImageDisplay::receiveFrame);
 	connect(imageDisplay, &ImageDisplay::roiChanged, this, [this](const QRect& rect) {
 		QString rectString = QString("ROI: %1, %2, %3, %4").arg(rect.x()).arg(rect.y()).arg(rect.width()).arg(rect.height());
 		emit this->info(rectString);
 	});
 
-	//data acquisition settings inputs from the GUI
-	connect(this->form, &SignalMonitorForm::nthBufferChanged, this, [this](int nthBuffer) {
-		this->nthBuffer = nthBuffer;
-	});
-	connect(this->form, &SignalMonitorForm::frameNrChanged, this, [this](int frameNr) {
-		this->frameNr = frameNr;
+	//settings that are used in the signal chain are published as one configuration snapshot
+	connect(this->form, &SignalMonitorForm::bufferSourceChanged, this, &SignalMonitor::publishConfiguration);
+	connect(this->form, &SignalMonitorForm::bufferSourceChanged, this, [this]() {
+		FrameIngest* ingests[] = {this->ingestRaw, this->ingestProcessed, this->ingestReplay};
+		for(FrameIngest* ingest : ingests){
+			ingest->resendDimensions();
+		}
 	});
-	connect(this->form, &SignalMonitorForm::bufferNrChanged, this, [this](int bufferNr) {
-		this->bufferNr = bufferNr;
+	connect(this->form, &SignalMonitorForm::imageMetricChanged, this, &SignalMonitor::publishConfiguration);
+	connect(this->form, &SignalMonitorForm::frameNrChanged, this, &SignalMonitor::publishConfiguration);
+	connect(this->form, &SignalMonitorForm::bufferNrChanged, this, &SignalMonitor::publishConfiguration);
+	connect(this->form, &SignalMonitorForm::roiChanged, this, &SignalMonitor::publishConfiguration);
+
+	//worker thread affinity and priority
+	connect(this->form, &SignalMonitorForm::workerSettingsChanged, this, &SignalMonitor::applyWorkerSettings);
+
+	//queue depth and overflow policy of the metric stages
+	connect(this->form, &SignalMonitorForm::pipelineSettingsChanged, this, &SignalMonitor::applyPipelineSettings);
+
+	//recording of every calculated metric to a binary file
+	connect(this->form, &SignalMonitorForm::startMetricRecording, this, [this](QString fileName) {
+		if(this->metricRecorder.open(fileName)){
+			emit info(this->name + ": " + tr("Recording metrics to ") + fileName);
+		}else{
+			this->form->setMetricRecordingActive(false);
+			emit error(this->name + ": " + tr("Could not open metric recording file ") + fileName);
+		}
 	});
-	connect(this->form, &SignalMonitorForm::bufferSourceChanged, this, [this](BUFFER_SOURCE source) {
-		this->bufferSource = source;
+	connect(this->form, &SignalMonitorForm::stopMetricRecording, this, [this]() {
+		quint64 recordCount = this->metricRecorder.getRecordCount();
+		QString fileName = this->metricRecorder.getFileName();
+		quint64 droppedRecords = this->metricRecorder.getDroppedRecords();
+		this->metricRecorder.close();
+		emit info(this->name + ": " + tr("%1 metric records saved to ").arg(recordCount) + fileName);
+		if(droppedRecords > 0){
+			emit error(this->name + ": " + tr("%1 metric records were dropped because the recording file was not enlarged in time.").arg(droppedRecords));
+		}
 	});
 }
 
-void SignalMonitor::setupMetricCalculator() {
-	this->metricCalculator = new ImageMetricCalculator();
-	this->metricCalculator->moveToThread(&metricCalculatorThread);
+void SignalMonitor::setupIngest(FrameIngest* ingest) {
+	ingest->setLatencyMonitor(&this->latencyMonitor);
+	ingest->setConfigurationStore(&this->configuration);
+	ingest->setTaskPool(this->taskPool);
+	connect(ingest, &FrameIngest::error, this, [this](QString message) {
+		emit this->error(this->name + ":  " + message);
+	});
+	connect(ingest, &FrameIngest::maxBuffers, this->form, &SignalMonitorForm::setMaximumBufferNr);
+	connect(ingest, &FrameIngest::maxFrames, this->form, &SignalMonitorForm::setMaximumFrameNr);
+	connect(this->form, &SignalMonitorForm::updateRateChanged, ingest, &FrameIngest::setTargetRate);
+
+	//only frames of one source are shown in the image display. if both sources are monitored, the processed frames are shown.
+	//frames are pushed in the thread of the ingest, so the conversion stage takes its reference before the ingest releases the frame
 	ImageDisplay* imageDisplay = this->form->getImageDisplay();
-	connect(this, &SignalMonitor::newFrame, this->metricCalculator, &ImageMetricCalculator::calculateMetric);
-	connect(imageDisplay, &ImageDisplay::roiChanged, this->metricCalculator, &ImageMetricCalculator::setRoi);
-	connect(this->metricCalculator, &ImageMetricCalculator::metricCalculated, this->form, &SignalMonitorForm::displayCurrentMetricValue);
-	connect(this->form, &SignalMonitorForm::imageMetricChanged, this->metricCalculator, &ImageMetricCalculator::setMetric);
-	connect(this->metricCalculator, &ImageMetricCalculator::info, this, &SignalMonitor::info);
-	connect(this->metricCalculator, &ImageMetricCalculator::error, this, &SignalMonitor::error);
-	connect(&metricCalculatorThread, &QThread::finished, this->metricCalculator, &QObject::deleteLater);
-	metricCalculatorThread.start();
-}
-
-void SignalMonitor::initializeFrameBuffers() {
-	this->frameBuffersRaw.resize(NUMBER_OF_BUFFERS);
-	this->frameBuffersProcessed.resize(NUMBER_OF_BUFFERS);
-	for(int i = 0; i < NUMBER_OF_BUFFERS; i++){
-		this->frameBuffersRaw[i] = nullptr;
-		this->frameBuffersProcessed[i] = nullptr;
+	PipelineStage* convertStage = this->convertStage;
+	connect(ingest, &FrameIngest::newFrame, convertStage, [this, ingest, imageDisplay, convertStage](FrameDescriptor frame) {
+		if(ingest == this->getDisplayedIngest() && imageDisplay->isShown()){
+			convertStage->push(frame);
+		}
+	}, Qt::DirectConnection);
+}
+
+ImageMetricCalculator* SignalMonitor::setupMetricCalculator(FrameIngest* ingest, PipelineStage* metricStage) {
+	ImageMetricCalculator* metricCalculator = new ImageMetricCalculator(this);
+	metricCalculator->setLatencyMonitor(&this->latencyMonitor);
+	metricCalculator->setTaskPool(this->taskPool);
+	metricCalculator->setMetricRecorder(&this->metricRecorder);
+
+	//the metric of a frame is calculated in the task pool. frames wait in the bounded queue of the metric stage, a full queue is handled by its overflow policy
+	metricStage->setTaskPool(this->taskPool);
+	//the flight recorder keeps a copy of the roi before the metric is calculated, so the frame that fires a trigger is part of the dump.
+	//it only records the frames of one source (see prepareFlightRecorder()), frames of the other sources return right away
+	FlightRecorder* flightRecorder = this->flightRecorder;
+	metricStage->setProcessor([metricCalculator, flightRecorder](const FrameDescriptor& frame) {
+		flightRecorder->capture(frame);
+		metricCalculator->calculateMetric(frame);
+		return true;
+	});
+	connect(ingest, &FrameIngest::newFrame, metricStage, [metricStage](FrameDescriptor frame) {
+		metricStage->push(frame);
+	}, Qt::DirectConnection);
+	ingest->setDownstreamStage(metricStage);
+	connect(metricCalculator, &ImageMetricCalculator::metricCalculated, this, [this](qreal value, FrameDescriptor frame, qint64 calculationTimestamp) {
+		Q_UNUSED(calculationTimestamp)
+		this->checkFlightRecorderTrigger(value, frame);
+	}, Qt::DirectConnection);
+	connect(metricCalculator, &ImageMetricCalculator::info, this, &SignalMonitor::info);
+	connect(metricCalculator, &ImageMetricCalculator::error, this, &SignalMonitor::error);
+
+	//cost reports are handled directly in the worker thread to keep them independent of the gui event loop
+	connect(metricCalculator, &ImageMetricCalculator::calculationFinished, ingest, [ingest](qint64 nanoseconds) {
+		ingest->frameProcessed(nanoseconds);
+	}, Qt::DirectConnection);
+	return metricCalculator;
+}
+
+void SignalMonitor::setupMetricDisplay() {
+	//metric values are handed to the gui through a bounded queue that is drained by a timer. a queued connection would allocate an event
+	//with copies of the arguments in the worker thread for every value, and a stalled gui would let the event queue grow without limit.
+	//values that do not fit into the queue are dropped. they show up as gaps of the plot sequence checkers and are counted per source,
+	//so these expected gaps are not reported as sequence errors
+	ImageMetricCalculator* metricCalculators[] = {this->metricCalculatorRaw, this->metricCalculatorProcessed, this->metricCalculatorReplay};
+	for(ImageMetricCalculator* metricCalculator : metricCalculators){
+		connect(metricCalculator, &ImageMetricCalculator::metricCalculated, this, [this](qreal value, FrameDescriptor frame, qint64 calculationTimestamp) {
+			MetricSample sample = {value, frame, calculationTimestamp};
+			MetricSample droppedSample;
+			bool hasDropped = false;
+			if(!this->metricSamples.push(sample, &droppedSample, &hasDropped)){
+				this->droppedMetricSamples[sourceIndex(sample.frame.source)].fetchAndAddRelaxed(1);
+			}
+			if(hasDropped){
+				this->droppedMetricSamples[sourceIndex(droppedSample.frame.source)].fetchAndAddRelaxed(1);
+			}
+		}, Qt::DirectConnection);
 	}
+	connect(&this->metricDisplayTimer, &QTimer::timeout, this, &SignalMonitor::displayMetricSamples);
+	this->metricDisplayTimer.setInterval(METRIC_DISPLAY_INTERVAL_MS);
 }
 
-void SignalMonitor::releaseFrameBuffers(QVector<void *> buffers) {
-	for (int i = 0; i < buffers.size(); i++) {
-		if (buffers[i] != nullptr) {
-			free(buffers[i]);
-			buffers[i] = nullptr;
+void SignalMonitor::displayMetricSamples() {
+	//all values that arrived since the last timeout are added to the plot, the plot is redrawn once
+	MetricSample sample;
+	while(this->metricSamples.pop(&sample)){
+		switch(sample.frame.source){
+			case RAW: this->form->displayRawMetricValue(sample.value, sample.frame, sample.calculationTimestamp); break;
+			case REPLAY: this->form->displayReplayMetricValue(sample.value, sample.frame, sample.calculationTimestamp); break;
+			default: this->form->displayProcessedMetricValue(sample.value, sample.frame, sample.calculationTimestamp);
 		}
 	}
+	this->form->updateMetricDisplay();
 }
 
-void SignalMonitor::storeParameters() {
-	//update settingsMap, so parameters can be reloaded into gui at next start of application
-	this->form->getSettings(&this->settingsMap);
-	emit storeSettings(this->name, this->settingsMap);
+void SignalMonitor::setupDisplayPipeline() {
+	//frames of the displayed source are converted to 8 bit in the task pool and rendered in the gui thread (render stage has no task pool,
+	//while the extension is active it is polled by a timer, see PipelineStage::setPollingInterval()).
+	//the display only needs the newest frame, both stages take their input from a latest frame mailbox, so a slow gui delays the display by at most one frame
+	ImageDisplay* imageDisplay = this->form->getImageDisplay();
+	BitDepthConverter* bitConverter = this->bitConverter;
+	PipelineStage* renderStage = this->renderStage;
+	bitConverter->setLatencyMonitor(&this->latencyMonitor);
+	bitConverter->setTaskPool(this->taskPool);
+	connect(bitConverter, &BitDepthConverter::info, this, &SignalMonitor::info);
+	connect(bitConverter, &BitDepthConverter::error, this, &SignalMonitor::error);
+
+	this->convertStage->setTaskPool(this->taskPool);
+	this->convertStage->setProcessor([bitConverter](const FrameDescriptor& frame) {
+		return bitConverter->convertDataTo8bit(frame);
+	});
+	connect(bitConverter, &BitDepthConverter::converted8bitData, renderStage, [renderStage](FrameDescriptor frame) {
+		renderStage->push(frame);
+	}, Qt::DirectConnection);
+	renderStage->setProcessor([imageDisplay](const FrameDescriptor& frame) {
+		imageDisplay->displayFrame(frame);
+		return true;
+	});
+
+	//window, level, gamma and logarithmic mapping of the display, the converter rebuilds its lookup table with the next frame
+	connect(this->form, &SignalMonitorForm::displaySettingsChanged, this, &SignalMonitor::applyDisplaySettings);
 }
 
-void SignalMonitor::rawDataReceived(void* buffer, unsigned bitDepth, unsigned int samplesPerLine, unsigned int linesPerFrame, unsigned int framesPerBuffer, unsigned int buffersPerVolume, unsigned int currentBufferNr) {
-	if(this->bufferSource == RAW && this->active){
-		if(!this->isCalculating && this->rawGrabbingAllowed){
+void SignalMonitor::setupFlightRecorder() {
+	//the flight recorder is triggered by the hotkey of the form or by a metric that crosses the threshold (see checkFlightRecorderTrigger())
+	connect(this->form, &SignalMonitorForm::flightRecorderSettingsChanged, this, &SignalMonitor::applyFlightRecorderSettings);
+	connect(this->form, &SignalMonitorForm::bufferSourceChanged, this, &SignalMonitor::prepareFlightRecorder);
+	connect(this->form, &SignalMonitorForm::roiChanged, this, &SignalMonitor::prepareFlightRecorder);
+	connect(this->form, &SignalMonitorForm::dumpFlightRecorder, this, [this]() {
+		if(!this->flightRecorder->trigger(tr("hotkey"))){
+			emit info(this->name + ": " + tr("Flight recorder is off, empty or still saving the previous dump."));
+		}
+	});
+	connect(this->flightRecorder, &FlightRecorder::dumped, this, [this](QString fileName, int numberOfFrames, QString reason) {
+		emit info(this->name + ": " + tr("Flight record (%1) with %2 frames saved to ").arg(reason).arg(numberOfFrames) + fileName);
+	});
+	connect(this->flightRecorder, &FlightRecorder::error, this, [this](QString message) {
+		emit error(this->name + ": " + message);
+	});
+}
 
-			//check if this is the nthBuffer
-			this->bufferCounter++;
-			if(this->bufferCounter < this->nthBuffer){
-				return;
-			}
-			this->bufferCounter = 0;
+void SignalMonitor::checkFlightRecorderTrigger(qreal value, const FrameDescriptor& frame) {
+	//called in the worker thread that calculated the metric. only a change from "condition not met" to "condition met" fires a trigger,
+	//a metric that stays above (or below) the threshold does not produce a new dump for every frame
+	MonitorConfiguration config = this->configuration.getSnapshot();
+	int index = sourceIndex(frame.source);
+	bool conditionMet = false;
+	if(config.flightRecorderTrigger == TRIGGER_ABOVE){
+		conditionMet = value > config.flightRecorderThreshold;
+	}else if(config.flightRecorderTrigger == TRIGGER_BELOW){
+		conditionMet = value < config.flightRecorderThreshold;
+	}
+	int wasMet = this->flightRecorderConditionMet[index].fetchAndStoreOrdered(conditionMet ? 1 : 0);
+	if(conditionMet && !wasMet){
+		QString sourceName = frame.source == RAW ? tr("raw") : (frame.source == REPLAY ? tr("replay") : tr("processed"));
+		this->flightRecorder->trigger(tr("%1 metric %2 crossed threshold %3").arg(sourceName).arg(value).arg(config.flightRecorderThreshold));
+	}
+}
 
-			this->isCalculating = true;
+void SignalMonitor::setupReplay() {
+	//replayed buffers take the same path as live data, the replay thread acts as acquisition thread of the replay ingest
+	FrameIngest* ingestReplay = this->ingestReplay;
+	this->replaySource->setSink([this, ingestReplay](void* buffer, unsigned int bitDepth, unsigned int samplesPerLine, unsigned int linesPerFrame, unsigned int framesPerBuffer, unsigned int buffersPerVolume, unsigned int currentBufferNr) {
+		ingestReplay->receiveBuffer(buffer, bitDepth, samplesPerLine, linesPerFrame, framesPerBuffer, buffersPerVolume, currentBufferNr, this->active);
+	});
+	connect(this->form, &SignalMonitorForm::startReplay, this, &SignalMonitor::startReplay);
+	connect(this->form, &SignalMonitorForm::stopReplay, this, [this]() {
+		this->replaySource->stopReplay();
+	});
+	connect(this->form, &SignalMonitorForm::replaySettingsChanged, this, &SignalMonitor::applyReplaySettings);
+	connect(this->replaySource, &ReplaySource::replayFinished, this, [this](int numberOfBuffers, qint64 nanoseconds, bool stopped) {
+		double seconds = nanoseconds/1000000000.0;
+		double buffersPerSecond = seconds > 0.0 ? numberOfBuffers/seconds : 0.0;
+		QString state = stopped ? tr("stopped") : tr("finished");
+		emit info(this->name + ": " + tr("Replay %1: %2 buffers in %3 s (%4 buffers/s)").arg(state).arg(numberOfBuffers).arg(seconds, 0, 'f', 2).arg(buffersPerSecond, 0, 'f', 1));
+	}, Qt::QueuedConnection);
+}
 
-			//calculate size of single frame
-			size_t bytesPerSample = static_cast<size_t>(ceil(static_cast<double>(bitDepth)/8.0));
-			size_t bytesPerFrame = samplesPerLine*linesPerFrame*bytesPerSample;
+void SignalMonitor::startReplay(QString fileName) {
+	this->replaySource->stopReplay();
+	ReplayRawFormat rawFormat;
+	if(!ReplayRawFormat::fromString(this->form->getParameters().replayRawFormat, &rawFormat) && !fileName.endsWith(".sfr", Qt::CaseInsensitive)){
+		emit error(this->name + ": " + tr("Invalid raw recording format."));
+		return;
+	}
+	if(!this->replaySource->open(fileName, rawFormat)){
+		emit error(this->name + ": " + tr("Could not open replay file ") + fileName + tr(" or the file does not contain a complete buffer."));
+		return;
+	}
+	if(!this->active){
+		emit info(this->name + ": " + tr("The extension is not active, replayed buffers are discarded."));
+	}
+	this->applyReplaySettings();
+	this->form->selectBufferSource(REPLAY);
+	this->replaySource->start();
+	emit info(this->name + ": " + tr("Replaying %1 buffers of ").arg(this->replaySource->getNumberOfBuffers()) + fileName);
+}
 
-			//check if number of frames per buffer has changed and emit maxFrames to update gui
-			if(this->framesPerBuffer != framesPerBuffer){
-				emit maxFrames(framesPerBuffer-1);
-				this->framesPerBuffer = framesPerBuffer;
-			}
-			//check if number of buffers per volume has changed and emit maxBuffers to update gui
-			if(this->buffersPerVolume != buffersPerVolume){
-				emit maxBuffers(buffersPerVolume-1);
-				this->buffersPerVolume = buffersPerVolume;
-			}
+void SignalMonitor::setupStatusUpdates() {
+	//periodically show the rate at which frames are actually analyzed and the buffer statistics. the timer only runs while the extension is active
+	connect(&this->statusTimer, &QTimer::timeout, this, &SignalMonitor::updateStatus);
+	this->statusTimer.setInterval(STATUS_UPDATE_INTERVAL_MS);
+}
 
-			//check if buffer size changed and allocate buffer memory
-			if(this->frameBuffersRaw[0] == nullptr || this->bytesPerFrameRaw != bytesPerFrame){
-				if(bitDepth == 0 || samplesPerLine == 0 || linesPerFrame == 0 || framesPerBuffer == 0){
-					emit error(this->name + ":  " + tr("Invalid data dimensions!"));
-					return;
-				}
-				//(re)create copy buffers
-				if(this->frameBuffersRaw[0] != nullptr){
-					this->releaseFrameBuffers(this->frameBuffersRaw);
-				}
-				for (int i = 0; i < this->frameBuffersRaw.size(); i++) {
-					this->frameBuffersRaw[i] = static_cast<void*>(malloc(bytesPerFrame));
-				}
-				this->bytesPerFrameRaw = bytesPerFrame;
-			}
+void SignalMonitor::updateStatus() {
+	IngestCounters countersRaw = this->ingestRaw->getCounters();
+	IngestCounters countersProcessed = this->ingestProcessed->getCounters();
+	this->form->displayEffectiveRates(this->ingestRaw->getRateController()->getEffectiveRate(), this->ingestProcessed->getRateController()->getEffectiveRate(), this->ingestReplay->getRateController()->getEffectiveRate());
+	this->form->displayIngestStatistics(countersRaw, countersProcessed);
+	this->form->displayLatencies();
+	this->form->displayPipelineStatistics({this->metricStageRaw, this->metricStageProcessed, this->metricStageReplay, this->convertStage, this->renderStage}, STATUS_UPDATE_INTERVAL_MS/1000.0);
+
+	//the recording file is enlarged here, outside of the worker threads. the recorder stops by itself if the file can not grow any more
+	this->metricRecorder.maintain();
+	if(this->metricRecorder.isOpen() && !this->metricRecorder.isRecording()){
+		quint64 recordCount = this->metricRecorder.getRecordCount();
+		this->metricRecorder.close();
+		this->form->setMetricRecordingActive(false);
+		emit error(this->name + ": " + tr("Metric recording stopped because the recording file could not be enlarged. %1 records were saved.").arg(recordCount));
+	}
 
-			//copy single frame of received data and emit it for further processing
-			this->copyBufferId = (this->copyBufferId+1)%NUMBER_OF_BUFFERS;
-			char* frameInBuffer = static_cast<char*>(buffer);
-			if(this->frameNr>static_cast<int>(framesPerBuffer-1)){this->frameNr = static_cast<int>(framesPerBuffer-1);}
-			if(this->bufferNr>static_cast<int>(buffersPerVolume-1)){this->bufferNr = static_cast<int>(buffersPerVolume-1);}
-			if(this->bufferNr == -1 || this->bufferNr == static_cast<int>(currentBufferNr)){
-				memcpy(this->frameBuffersRaw[this->copyBufferId], &(frameInBuffer[bytesPerFrame*this->frameNr]), bytesPerFrame);
-				emit newFrame(this->frameBuffersRaw[this->copyBufferId], bitDepth, samplesPerLine, linesPerFrame);
-			}
+	//a changed bit depth of the recorded frames resizes the slots of the flight recorder, copy buffers of an old frame size are freed
+	this->flightRecorder->maintain();
+	FrameIngest* ingests[] = {this->ingestRaw, this->ingestProcessed, this->ingestReplay};
+	for(FrameIngest* ingest : ingests){
+		ingest->releaseUnusedFrameBuffers();
+	}
+
+	//in automatic mode the worker cores follow the cores the acquisition thread is seen on
+	this->updateAcquisitionCores();
+	this->applyWorkerSettings();
+	int threadSettingsFailures = this->taskPool->getThreadSettingsFailures();
+	if(threadSettingsFailures > this->reportedThreadSettingsFailures){
+		this->reportedThreadSettingsFailures = threadSettingsFailures;
+		emit error(this->name + ": " + tr("Could not apply worker thread settings. Lowering the nice level again requires elevated privileges."));
+	}
 
-			this->isCalculating = false;
+	//lost buffers are summarized in a rate limited info message instead of one message per lost buffer
+	this->statusUpdateCounter++;
+	if(this->statusUpdateCounter >= LOST_BUFFER_REPORT_INTERVAL_MS/STATUS_UPDATE_INTERVAL_MS){
+		this->statusUpdateCounter = 0;
+		this->reportLostBuffers(tr("raw"), countersRaw, &this->reportedCountersRaw);
+		this->reportLostBuffers(tr("processed"), countersProcessed, &this->reportedCountersProcessed);
+		quint64 droppedRaw = this->metricStageRaw->getCounters().queue.dropped;
+		quint64 droppedProcessed = this->metricStageProcessed->getCounters().queue.dropped;
+		this->reportSequenceErrors(tr("raw metric calculation"), this->metricCalculatorRaw->getSequenceCounters(), droppedRaw);
+		this->reportSequenceErrors(tr("processed metric calculation"), this->metricCalculatorProcessed->getSequenceCounters(), droppedProcessed);
+		this->reportSequenceErrors(tr("raw plot"), this->form->getPlotSequenceCounters(RAW), droppedRaw + this->droppedMetricSamples[sourceIndex(RAW)].loadAcquire());
+		this->reportSequenceErrors(tr("processed plot"), this->form->getPlotSequenceCounters(PROCESSED), droppedProcessed + this->droppedMetricSamples[sourceIndex(PROCESSED)].loadAcquire());
+		quint64 droppedReplay = this->metricStageReplay->getCounters().queue.dropped;
+		this->reportSequenceErrors(tr("replay metric calculation"), this->metricCalculatorReplay->getSequenceCounters(), droppedReplay);
+		this->reportSequenceErrors(tr("replay plot"), this->form->getPlotSequenceCounters(REPLAY), droppedReplay + this->droppedMetricSamples[sourceIndex(REPLAY)].loadAcquire());
+	}
+}
+
+void SignalMonitor::reportSessionSummary() {
+	//summary of buffer counters and latencies since the start, so a measurement can be judged from the log alone
+	QString summary = tr("Session summary");
+	FrameIngest* ingests[] = {this->ingestRaw, this->ingestProcessed, this->ingestReplay};
+	QString sourceNames[] = {tr("raw"), tr("processed"), tr("replay")};
+	for(int i = 0; i < 3; i++){
+		IngestCounters counters = ingests[i]->getCounters();
+		if(counters.received() == 0){
+			continue;
 		}
-		else{
-			this->lostBuffersRaw++;
-			emit info(this->name + ": " + tr("Raw buffer lost. Total lost raw buffers: ") + QString::number(lostBuffersRaw));
-			if(this->lostBuffersRaw>= INT_MAX){
-				this->lostBuffersRaw = 0;
-				emit info(this->name + ": " + tr("Lost raw buffer counter overflow. Counter set to zero."));
-			}
+		summary += "\n" + tr("%1: %2 buffers received, %3 used, %4 skipped, %5 lost").arg(sourceNames[i]).arg(counters.received())
+			.arg(counters.accepted).arg(counters.skipped).arg(counters.dropped[DROP_BUSY]);
+	}
+	for(int i = 0; i < NUMBER_OF_LATENCY_STAGES; i++){
+		const LatencyHistogram& histogram = this->latencyMonitor.getHistogram(static_cast<LATENCY_STAGE>(i));
+		if(histogram.getCount() == 0){
+			continue;
 		}
+		summary += "\n" + tr("%1 latency p50 / p99 / max: %2 / %3 / %4 ms").arg(LatencyMonitor::stageName(static_cast<LATENCY_STAGE>(i)))
+			.arg(histogram.getPercentile(50)/1.0e6, 0, 'f', 3)
+			.arg(histogram.getPercentile(99)/1.0e6, 0, 'f', 3)
+			.arg(histogram.getMaximum()/1.0e6, 0, 'f', 3);
 	}
+	emit info(this->name + ": " + summary);
 }
 
-void SignalMonitor::processedDataReceived(void* buffer, unsigned int bitDepth, unsigned int samplesPerLine, unsigned int linesPerFrame, unsigned int framesPerBuffer, unsigned int buffersPerVolume, unsigned int currentBufferNr) {
-	if(this->bufferSource == PROCESSED && this->active){
-		if(!this->isCalculating && this->processedGrabbingAllowed){
-			//check if current buffer is selected. If it is not selected discard it and do nothing (just return).
-			if(this->bufferNr>static_cast<int>(buffersPerVolume-1)){this->bufferNr = static_cast<int>(buffersPerVolume-1);}
-			if(!(this->bufferNr == -1 || this->bufferNr == static_cast<int>(currentBufferNr))){
-				return;
-			}
-
-			//check if this is the nthBuffer
-			this->bufferCounter++;
-			if(this->bufferCounter < this->nthBuffer){
-				return;
-			}
-			this->bufferCounter = 0;
+void SignalMonitor::reportLostBuffers(QString sourceName, const IngestCounters& current, IngestCounters* reported) {
+	quint64 lostSinceLastReport = current.dropped[DROP_BUSY] - reported->dropped[DROP_BUSY];
+	if(lostSinceLastReport > 0){
+		emit info(this->name + ": " + QString::number(lostSinceLastReport) + " " + sourceName + " " + tr("buffers lost in the last %1 s. Total lost buffers: ").arg(LOST_BUFFER_REPORT_INTERVAL_MS/1000) + QString::number(current.dropped[DROP_BUSY]));
+	}
+	*reported = current;
+}
 
-			this->isCalculating = true;
+void SignalMonitor::reportSequenceErrors(QString consumerName, const SequenceCounters& current, quint64 droppedFrames) {
+	//every frame that is emitted by an ingest must arrive at its consumers exactly once and in order.
+	//frames that were dropped by a full metric queue (and for the plots, metric values dropped on their way to the gui) leave expected gaps,
+	//only missing frames beyond these drops are errors
+	SequenceCounters reported = this->reportedSequenceCounters.value(consumerName, SequenceCounters());
+	quint64 unexplainedMissingFrames = current.missingFrames > droppedFrames ? current.missingFrames - droppedFrames : 0;
+	quint64 reportedUnexplainedMissingFrames = this->reportedUnexplainedMissingFrames.value(consumerName, 0);
+	quint64 missingSinceLastReport = unexplainedMissingFrames > reportedUnexplainedMissingFrames ? unexplainedMissingFrames - reportedUnexplainedMissingFrames : 0;
+	quint64 duplicatesSinceLastReport = current.duplicates - reported.duplicates;
+	quint64 outOfOrderSinceLastReport = current.outOfOrder - reported.outOfOrder;
+	if(missingSinceLastReport + duplicatesSinceLastReport + outOfOrderSinceLastReport > 0){
+		emit info(this->name + ": " + tr("Frame sequence errors at %1: %2 frames missing, %3 duplicates, %4 out of order.").arg(consumerName)
+			.arg(missingSinceLastReport)
+			.arg(duplicatesSinceLastReport)
+			.arg(outOfOrderSinceLastReport));
+	}
+	this->reportedSequenceCounters.insert(consumerName, current);
+	this->reportedUnexplainedMissingFrames.insert(consumerName, qMax(unexplainedMissingFrames, reportedUnexplainedMissingFrames));
+}
 
-			//calculate size of single frame
-			size_t bytesPerSample = static_cast<size_t>(ceil(static_cast<double>(bitDepth)/8.0));
-			size_t bytesPerFrame = samplesPerLine*linesPerFrame*bytesPerSample;
+FrameIngest* SignalMonitor::getDisplayedIngest() {
+	switch(this->configuration.getSnapshot().bufferSource){
+		case RAW: return this->ingestRaw;
+		case REPLAY: return this->ingestReplay;
+		default: return this->ingestProcessed;
+	}
+}
 
-			//check if number of frames per buffer has changed and emit maxFrames to update gui
-			if(this->framesPerBuffer != framesPerBuffer){
-				emit maxFrames(framesPerBuffer-1);
-				this->framesPerBuffer = framesPerBuffer;
-			}
-			//check if number of buffers per volume has changed and emit maxBuffers to update gui
-			if(this->buffersPerVolume != buffersPerVolume){
-				emit maxBuffers(buffersPerVolume-1);
-				this->buffersPerVolume = buffersPerVolume;
-			}
+void SignalMonitor::applyParameters(const SignalMonitorParameters& parameters) {
+	FrameIngest* ingests[] = {this->ingestRaw, this->ingestProcessed, this->ingestReplay};
+	for(FrameIngest* ingest : ingests){
+		ingest->setTargetRate(parameters.updateRate);
+	}
+	this->publishConfiguration();
+	this->applyWorkerSettings();
+	this->applyPipelineSettings();
+	this->applyFlightRecorderSettings();
+	this->applyReplaySettings();
+	this->applyDisplaySettings();
+}
 
-			//check if buffer size changed and allocate buffer memory
-			if(this->frameBuffersProcessed[0] == nullptr || this->bytesPerFrameProcessed != bytesPerFrame){
-				if(bitDepth == 0 || samplesPerLine == 0 || linesPerFrame == 0 || framesPerBuffer == 0){
-					emit error(this->name + ":  " + tr("Invalid data dimensions!"));
-					return;
-				}
-				//(re)create copy buffers
-				if(this->frameBuffersProcessed[0] != nullptr){
-					this->releaseFrameBuffers(this->frameBuffersProcessed);
-				}
-				for (int i = 0; i < this->frameBuffersProcessed.size(); i++) {
-					this->frameBuffersProcessed[i] = static_cast<void*>(malloc(bytesPerFrame));
-				}
-				this->bytesPerFrameProcessed = bytesPerFrame;
-			}
+void SignalMonitor::updateAcquisitionCores() {
+	//sliding window over the last status updates, the oldest update is replaced by the cores seen since the previous one
+	this->acquisitionCoreHistory[this->acquisitionCoreHistoryIndex] = this->ingestRaw->takeAcquisitionCores() | this->ingestProcessed->takeAcquisitionCores();
+	this->acquisitionCoreHistoryIndex = (this->acquisitionCoreHistoryIndex+1) % ACQUISITION_CORE_HISTORY_SIZE;
+}
 
-			//copy single frame of received data and emit it for further processing
-			this->copyBufferId = (this->copyBufferId+1)%NUMBER_OF_BUFFERS;
-			char* frameInBuffer = static_cast<char*>(buffer);
-			if(this->frameNr>static_cast<int>(framesPerBuffer-1)){this->frameNr = static_cast<int>(framesPerBuffer-1);}
-			memcpy(this->frameBuffersProcessed[this->copyBufferId], &(frameInBuffer[bytesPerFrame*this->frameNr]), bytesPerFrame);
-			emit newFrame(this->frameBuffersProcessed[this->copyBufferId], bitDepth, samplesPerLine, linesPerFrame);
+quint64 SignalMonitor::getRecentAcquisitionCores() const {
+	quint64 acquisitionCores = 0;
+	for(quint64 cores : this->acquisitionCoreHistory){
+		acquisitionCores |= cores;
+	}
+	return acquisitionCores;
+}
 
-			this->isCalculating = false;
-		}
-		else{
-			this->lostBuffersProcessed++;
-			emit info(this->name + ": " + tr("Processed buffer lost. Total lost buffers: ") + QString::number(lostBuffersProcessed));
-			if(this->lostBuffersProcessed>= INT_MAX){
-				this->lostBuffersProcessed = 0;
-				emit info(this->name + ": " + tr("Lost processed buffer counter overflow. Counter set to zero."));
-			}
+void SignalMonitor::applyWorkerSettings() {
+	SignalMonitorParameters parameters = this->form->getParameters();
+	quint64 acquisitionCores = this->getRecentAcquisitionCores();
+	bool ok = false;
+	quint64 coreMask = parseCoreList(parameters.workerCores, &ok) & allCoresMask();
+	if(!ok || coreMask == 0){
+		//automatic selection: all cores except the ones of the acquisition thread. if no core is left, all cores are used
+		coreMask = allCoresMask() & ~acquisitionCores;
+		if(coreMask == 0){
+			coreMask = allCoresMask();
 		}
 	}
+	if(coreMask == this->appliedWorkerCoreMask && parameters.workerNiceLevel == this->appliedWorkerNiceLevel){
+		return;
+	}
+	this->appliedWorkerCoreMask = coreMask;
+	this->appliedWorkerNiceLevel = parameters.workerNiceLevel;
+	this->taskPool->setThreadSettings(coreMask, parameters.workerNiceLevel);
+	this->form->displayWorkerCores(coreMaskToString(coreMask), coreMaskToString(acquisitionCores));
+}
+
+void SignalMonitor::applyPipelineSettings() {
+	SignalMonitorParameters parameters = this->form->getParameters();
+	int queueDepth = qMax(1, parameters.queueDepth);
+	OVERFLOW_POLICY policy = parameters.overflowPolicy == OVERFLOW_DROP_NEWEST ? OVERFLOW_DROP_NEWEST : OVERFLOW_DROP_OLDEST;
+	PipelineStage* metricStages[] = {this->metricStageRaw, this->metricStageProcessed, this->metricStageReplay};
+	for(PipelineStage* stage : metricStages){
+		stage->setPolicy(policy);
+		stage->setCapacity(queueDepth);
+	}
+
+	//a frame slot can be held by every queue and by every stage that is processing a frame, one more slot is needed for the next copy
+	int convertCapacity = this->convertStage->getCapacity();
+	int renderCapacity = this->renderStage->getCapacity();
+	int numberOfSlots = (queueDepth+1) + (convertCapacity+1) + (renderCapacity+1) + 1;
+	FrameIngest* ingests[] = {this->ingestRaw, this->ingestProcessed, this->ingestReplay};
+	for(FrameIngest* ingest : ingests){
+		ingest->setNumberOfSlots(numberOfSlots);
+		ingest->setStreamingCopyEnabled(parameters.streamingCopy);
+	}
+	this->bitConverter->setNumberOfSlots((renderCapacity+1) + 1);
+}
+
+void SignalMonitor::applyFlightRecorderSettings() {
+	SignalMonitorParameters parameters = this->form->getParameters();
+	this->prepareFlightRecorder();
+	this->flightRecorder->setFolder(parameters.flightRecorderFolder);
+	this->publishConfiguration();
+}
+
+void SignalMonitor::prepareFlightRecorder() {
+	//the rings of the flight recorder are allocated here in the gui thread, not by the workers that capture the frames.
+	//one source is recorded: the selected one, raw if raw and processed data are monitored
+	SignalMonitorParameters parameters = this->form->getParameters();
+	BUFFER_SOURCE source = parameters.bufferSource == RAW_AND_PROCESSED ? RAW : parameters.bufferSource;
+	size_t samplesPerFrame = static_cast<size_t>(qMax(0, parameters.roi.width()))*static_cast<size_t>(qMax(0, parameters.roi.height()));
+	this->flightRecorder->setRecording(source, parameters.flightRecorderFrames, samplesPerFrame);
+}
+
+void SignalMonitor::applyReplaySettings() {
+	this->replaySource->setSpeed(this->form->getParameters().replayMaximumSpeed ? REPLAY_MAXIMUM_SPEED : REPLAY_REAL_TIME);
+}
+
+void SignalMonitor::applyDisplaySettings() {
+	SignalMonitorParameters parameters = this->form->getParameters();
+	DisplayMapping mapping;
+	mapping.level = parameters.displayLevel;
+	mapping.window = parameters.displayWindow;
+	mapping.gamma = parameters.displayGamma;
+	mapping.logarithmic = parameters.displayLogarithmic;
+	this->bitConverter->setDisplayMapping(mapping);
+}
+
+void SignalMonitor::storeParameters() {
+	//update settingsMap, so parameters can be reloaded into gui at next start of application
+	this->form->getSettings(&this->settingsMap);
+	emit storeSettings(this->name, this->settingsMap);
+}
+
+void SignalMonitor::publishConfiguration() {
+	SignalMonitorParameters parameters = this->form->getParameters();
+	MonitorConfiguration config;
+	config.version = 0; //assigned by the store
+	config.bufferSource = parameters.bufferSource;
+	config.imageMetric = parameters.imageMetric;
+	config.roi = parameters.roi;
+	config.frameNr = parameters.frameNr;
+	config.bufferNr = parameters.bufferNr;
+	config.flightRecorderTrigger = parameters.flightRecorderTrigger;
+	config.flightRecorderThreshold = parameters.flightRecorderThreshold;
+	this->configuration.publish(config);
+}
+
+void SignalMonitor::rawDataReceived(void* buffer, unsigned bitDepth, unsigned int samplesPerLine, unsigned int linesPerFrame, unsigned int framesPerBuffer, unsigned int buffersPerVolume, unsigned int currentBufferNr) {
+	this->ingestRaw->receiveBuffer(buffer, bitDepth, samplesPerLine, linesPerFrame, framesPerBuffer, buffersPerVolume, currentBufferNr, this->active && this->rawGrabbingAllowed);
+}
+
+void SignalMonitor::processedDataReceived(void* buffer, unsigned int bitDepth, unsigned int samplesPerLine, unsigned int linesPerFrame, unsigned int framesPerBuffer, unsigned int buffersPerVolume, unsigned int currentBufferNr) {
+	this->ingestProcessed->receiveBuffer(buffer, bitDepth, samplesPerLine, linesPerFrame, framesPerBuffer, buffersPerVolume, currentBufferNr, this->active && this->processedGrabbingAllowed);
 }
@@ -3,20 +3,36 @@
 
 
 #include <QCoreApplication>
-#include <QThread>
+#include <QTimer>
+#include <QMap>
 #include "octproz_devkit.h"
 #include "signalmonitorform.h"
 #include "imagemetriccalculator.h"
+#include "frameingest.h"
+#include "configurationstore.h"
+#include "taskpool.h"
+#include "pipelinestage.h"
+#include "bitdepthconverter.h"
+#include "metricrecorder.h"
+#include "flightrecorder.h"
+#include "replaysource.h"
+#include "boundedqueue.h"
 
-#define NUMBER_OF_BUFFERS 2
+#define METRIC_DISPLAY_QUEUE_CAPACITY 1024
+#define ACQUISITION_CORE_HISTORY_SIZE 4 //status updates (2 s) over which the cores of the acquisition thread are collected, older cores are forgotten
 
+//metric value on its way from the worker that calculated it to the gui
+struct MetricSample {
+	qreal value;
+	FrameDescriptor frame;
+	qint64 calculationTimestamp;
+};
 
 class SignalMonitor : public Extension
 {
 	Q_OBJECT
 	Q_PLUGIN_METADATA(IID Extension_iid)
 	Q_INTERFACES(Extension Plugin)
-	QThread metricCalculatorThread;
 
 public:
 	SignalMonitor();
@@ -28,40 +44,76 @@ public:
 	virtual void settingsLoaded(QVariantMap settings) override;
 
 private:
+	TaskPool* taskPool;
 	SignalMonitorForm* form;
-	ImageMetricCalculator* metricCalculator;
-	BUFFER_SOURCE bufferSource;
-	int frameNr;
-	int bufferNr;
-	int nthBuffer;
-	int bufferCounter;
+	FrameIngest* ingestRaw;
+	FrameIngest* ingestProcessed;
+	FrameIngest* ingestReplay;
+	ImageMetricCalculator* metricCalculatorRaw;
+	ImageMetricCalculator* metricCalculatorProcessed;
+	ImageMetricCalculator* metricCalculatorReplay;
+	BitDepthConverter* bitConverter;
+	PipelineStage* metricStageRaw;
+	PipelineStage* metricStageProcessed;
+	PipelineStage* metricStageReplay;
+	PipelineStage* convertStage;
+	PipelineStage* renderStage;
+	FlightRecorder* flightRecorder;
+	ReplaySource* replaySource;
 	bool active;
-	bool isCalculating;
+	QTimer statusTimer;
+	LatencyMonitor latencyMonitor;
+	ConfigurationStore configuration;
+	MetricRecorder metricRecorder;
+	BoundedQueue<MetricSample> metricSamples;
+	QTimer metricDisplayTimer;
 
-	QVector<void*> frameBuffersRaw;
-	QVector<void*> frameBuffersProcessed;
-	int copyBufferId;
-	size_t bytesPerFrameRaw;
-	size_t bytesPerFrameProcessed;
-	int lostBuffersRaw;
-	int lostBuffersProcessed;
-	unsigned int framesPerBuffer;
-	unsigned int buffersPerVolume;
+	IngestCounters reportedCountersRaw;
+	IngestCounters reportedCountersProcessed;
+	QMap<QString, SequenceCounters> reportedSequenceCounters;
+	QMap<QString, quint64> reportedUnexplainedMissingFrames;
+	int statusUpdateCounter;
+	quint64 acquisitionCoreHistory[ACQUISITION_CORE_HISTORY_SIZE]; //cores the acquisition thread was seen on, one entry per status update
+	int acquisitionCoreHistoryIndex;
+	quint64 appliedWorkerCoreMask;
+	int appliedWorkerNiceLevel;
+	int reportedThreadSettingsFailures;
+	QAtomicInteger<int> flightRecorderConditionMet[3]; //per source (raw, processed, replay), a trigger is only fired when the condition starts to be met
+	QAtomicInteger<quint64> droppedMetricSamples[3]; //per source, metric values that did not fit into metricSamples
 
+	static int sourceIndex(BUFFER_SOURCE source) {return source == RAW ? 0 : (source == REPLAY ? 2 : 1);}
+	void createMonitor();
 	void setupGuiConnections();
-	void setupMetricCalculator();
-	void initializeFrameBuffers();
-	void releaseFrameBuffers(QVector<void*> buffers);
+	void setupIngest(FrameIngest* ingest);
+	ImageMetricCalculator* setupMetricCalculator(FrameIngest* ingest, PipelineStage* metricStage);
+	void setupMetricDisplay();
+	void displayMetricSamples();
+	void setupDisplayPipeline();
+	void setupFlightRecorder();
+	void setupReplay();
+	void startReplay(QString fileName);
+	void checkFlightRecorderTrigger(qreal value, const FrameDescriptor& frame);
+	void setupStatusUpdates();
+	void updateStatus();
+	void reportSessionSummary();
+	void reportLostBuffers(QString sourceName, const IngestCounters& current, IngestCounters* reported);
+	void reportSequenceErrors(QString consumerName, const SequenceCounters& current, quint64 droppedFrames);
+	FrameIngest* getDisplayedIngest();
+	void applyParameters(const SignalMonitorParameters& parameters);
+	void updateAcquisitionCores();
+	quint64 getRecentAcquisitionCores() const;
+	void applyWorkerSettings();
+	void applyPipelineSettings();
+	void applyFlightRecorderSettings();
+	void prepareFlightRecorder();
+	void applyReplaySettings();
+	void applyDisplaySettings();
 
 public slots:
 	void storeParameters();
+	void publishConfiguration();
 	virtual void rawDataReceived(void* buffer, unsigned int bitDepth, unsigned int samplesPerLine, unsigned int linesPerFrame, unsigned int framesPerBuffer, unsigned int buffersPerVolume, unsigned int currentBufferNr) override;
 	virtual void processedDataReceived(void* buffer, unsigned int bitDepth, unsigned int samplesPerLine, unsigned int linesPerFrame, unsigned int framesPerBuffer, unsigned int buffersPerVolume, unsigned int currentBufferNr) override;
-
-signals:
-	void newFrame(void* frame, unsigned int bitDepth, unsigned int samplesPerLine, unsigned int linesPerFrame);
-	void maxFrames(int max);
-	void maxBuffers(int max);
 };
 
 #endif //SIGNALMONITOREXTENSION_H
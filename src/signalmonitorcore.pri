@@ -0,0 +1,37 @@
+#gui free part of the signal monitor: metric calculation, bit depth conversion and the infrastructure they use.
+#included by the extension and by tools/signalmonitorcore, which builds it as static library for the headless tools
+
+SOURCES += \
+	$$PWD/bitdepthconverter.cpp \
+	$$PWD/displaylookuptable.cpp \
+	$$PWD/conversionkernels.cpp \
+	$$PWD/imagemetriccalculator.cpp \
+	$$PWD/referencemetric.cpp \
+	$$PWD/framearena.cpp \
+	$$PWD/framepool.cpp \
+	$$PWD/streamingcopy.cpp \
+	$$PWD/latencymonitor.cpp \
+	$$PWD/taskpool.cpp \
+	$$PWD/threadtuning.cpp \
+	$$PWD/tracer.cpp \
+	$$PWD/metricrecorder.cpp
+
+HEADERS += \
+	$$PWD/signalmonitorparameters.h \
+	$$PWD/bitdepthconverter.h \
+	$$PWD/displaylookuptable.h \
+	$$PWD/conversionkernels.h \
+	$$PWD/imagemetriccalculator.h \
+	$$PWD/referencemetric.h \
+	$$PWD/uint128.h \
+	$$PWD/framedescriptor.h \
+	$$PWD/framearena.h \
+	$$PWD/framepool.h \
+	$$PWD/streamingcopy.h \
+	$$PWD/latencymonitor.h \
+	$$PWD/taskpool.h \
+	$$PWD/threadtuning.h \
+	$$PWD/tracer.h \
+	$$PWD/metricrecorder.h
+
+INCLUDEPATH += $$PWD
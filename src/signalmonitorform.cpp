@@ -1,6 +1,16 @@
 #include "signalmonitorform.h"
 #include "ui_signalmonitorform.h"
 #include <QPropertyAnimation>
+#include <QFileDialog>
+#include <QMenu>
+#include <QInputDialog>
+#include <QSignalBlocker>
+#include <QDir>
+#include "tracer.h"
+#include "threadtuning.h"
+#include "boundedqueue.h"
+#include "flightrecorder.h"
+#include "replaysource.h"
 
 SignalMonitorForm::SignalMonitorForm(QWidget *parent) :
 	QWidget(parent),
@@ -21,8 +31,9 @@ SignalMonitorForm::SignalMonitorForm(QWidget *parent) :
 		emit paramsChanged();
 	});
 	
-	//init settings area
+	//init settings area and tool menu
 	connect(ui->toolButton_settings, &QToolButton::clicked, this, &SignalMonitorForm::toggleSettingsArea);
+	this->setupToolMenu();
 	this->ui->widget_settings->setVisible(false);
 	this->adjustSize();
 
@@ -44,18 +55,19 @@ SignalMonitorForm::SignalMonitorForm(QWidget *parent) :
 	});
 	
 	//ComboBox Image input
-	QStringList srcOptions = { "Raw", "Processed"};
+	QStringList srcOptions = { "Raw", "Processed", "Raw and processed", "Replay"};
 	this->ui->comboBox_imageSource->addItems(srcOptions);
 	connect(this->ui->comboBox_imageSource, QOverload<int>::of(&QComboBox::currentIndexChanged), [this](int index) {
 		this->parameters.bufferSource = static_cast<BUFFER_SOURCE>(index);
+		this->updatePlotCurves();
 		emit bufferSourceChanged(this->parameters.bufferSource);
 		emit paramsChanged();
 	});
 
-	//SpinBox nthBuffer
-	connect(this->ui->spinBox_nthBuffer, QOverload<int>::of(&QSpinBox::valueChanged), [this](int nthBuffer) {
-		this->parameters.nthBufferToUse = nthBuffer;
-		emit nthBufferChanged(nthBuffer); 
+	//SpinBox update rate
+	connect(this->ui->doubleSpinBox_updateRate, QOverload<double>::of(&QDoubleSpinBox::valueChanged), [this](double updateRate) {
+		this->parameters.updateRate = updateRate;
+		emit updateRateChanged(updateRate);
 		emit paramsChanged();
 	});
 
@@ -79,6 +91,84 @@ SignalMonitorForm::SignalMonitorForm(QWidget *parent) :
 	});
 	this->setMaximumFrameNr(512);
 
+	//worker thread settings
+	connect(this->ui->lineEdit_workerCores, &QLineEdit::editingFinished, this, [this]() {
+		QString workerCores = this->ui->lineEdit_workerCores->text().trimmed();
+		if(workerCores == this->parameters.workerCores){
+			return;
+		}
+		bool ok = false;
+		parseCoreList(workerCores, &ok);
+		if(!ok){
+			emit error(tr("Invalid worker core list. Use a list like 0-3,6 or leave it empty for automatic selection."));
+		}
+		this->parameters.workerCores = workerCores;
+		emit workerSettingsChanged();
+		emit paramsChanged();
+	});
+	connect(this->ui->spinBox_workerNiceLevel, QOverload<int>::of(&QSpinBox::valueChanged), this, [this](int niceLevel) {
+		this->parameters.workerNiceLevel = niceLevel;
+		emit workerSettingsChanged();
+		emit paramsChanged();
+	});
+
+	//queue settings of the metric stages
+	connect(this->ui->spinBox_queueDepth, QOverload<int>::of(&QSpinBox::valueChanged), this, [this](int queueDepth) {
+		this->parameters.queueDepth = queueDepth;
+		emit pipelineSettingsChanged();
+		emit paramsChanged();
+	});
+	QStringList overflowOptions = {"Drop oldest frame", "Drop newest frame"};
+	this->ui->comboBox_overflowPolicy->addItems(overflowOptions);
+	connect(this->ui->comboBox_overflowPolicy, QOverload<int>::of(&QComboBox::currentIndexChanged), this, [this](int index) {
+		this->parameters.overflowPolicy = index;
+		emit pipelineSettingsChanged();
+		emit paramsChanged();
+	});
+
+	//flight recorder
+	connect(this->ui->spinBox_flightRecorderFrames, QOverload<int>::of(&QSpinBox::valueChanged), this, [this](int numberOfFrames) {
+		this->parameters.flightRecorderFrames = numberOfFrames;
+		emit flightRecorderSettingsChanged();
+		emit paramsChanged();
+	});
+	QStringList triggerOptions = {"Manual (F9)", "Metric above", "Metric below"};
+	this->ui->comboBox_flightRecorderTrigger->addItems(triggerOptions);
+	connect(this->ui->comboBox_flightRecorderTrigger, QOverload<int>::of(&QComboBox::currentIndexChanged), this, [this](int index) {
+		this->parameters.flightRecorderTrigger = static_cast<FLIGHTRECORDER_TRIGGER>(index);
+		this->ui->doubleSpinBox_flightRecorderThreshold->setEnabled(index != TRIGGER_OFF);
+		emit flightRecorderSettingsChanged();
+		emit paramsChanged();
+	});
+	connect(this->ui->doubleSpinBox_flightRecorderThreshold, QOverload<double>::of(&QDoubleSpinBox::valueChanged), this, [this](double threshold) {
+		this->parameters.flightRecorderThreshold = threshold;
+		emit flightRecorderSettingsChanged();
+		emit paramsChanged();
+	});
+
+	//mapping of the samples to the 8 bit image display
+	connect(this->ui->doubleSpinBox_displayLevel, QOverload<double>::of(&QDoubleSpinBox::valueChanged), this, [this](double level) {
+		this->parameters.displayLevel = level;
+		emit displaySettingsChanged();
+		emit paramsChanged();
+	});
+	connect(this->ui->doubleSpinBox_displayWindow, QOverload<double>::of(&QDoubleSpinBox::valueChanged), this, [this](double window) {
+		this->parameters.displayWindow = window;
+		this->ui->doubleSpinBox_displayLevel->setEnabled(window > 0);
+		emit displaySettingsChanged();
+		emit paramsChanged();
+	});
+	connect(this->ui->doubleSpinBox_displayGamma, QOverload<double>::of(&QDoubleSpinBox::valueChanged), this, [this](double gamma) {
+		this->parameters.displayGamma = gamma;
+		emit displaySettingsChanged();
+		emit paramsChanged();
+	});
+	connect(this->ui->checkBox_displayLogarithmic, &QCheckBox::toggled, this, [this](bool logarithmic) {
+		this->parameters.displayLogarithmic = logarithmic;
+		emit displaySettingsChanged();
+		emit paramsChanged();
+	});
+
 	//window size and position changes are intercepted by event filter
 	this->installEventFilter(this);
 
@@ -87,9 +177,33 @@ SignalMonitorForm::SignalMonitorForm(QWidget *parent) :
 	this->parameters.bufferSource = PROCESSED;
 	this->parameters.frameNr = 0;
 	this->parameters.imageMetric = AVERAGE;
-	this->parameters.nthBufferToUse = 10;
+	this->parameters.updateRate = 10.0;
 	this->parameters.roi = QRect(50,50, 400, 800);
 	this->parameters.visibleSamples = 256;
+	this->parameters.workerCores = "";
+	this->parameters.workerNiceLevel = THREADTUNING_DEFAULT_NICE_LEVEL;
+	this->parameters.queueDepth = 2;
+	this->parameters.overflowPolicy = OVERFLOW_DROP_OLDEST;
+	this->parameters.streamingCopy = false;
+	this->parameters.flightRecorderFrames = FLIGHTRECORDER_DEFAULT_NUMBER_OF_FRAMES;
+	this->parameters.flightRecorderTrigger = TRIGGER_OFF;
+	this->parameters.flightRecorderThreshold = 0.0;
+	this->parameters.flightRecorderFolder = QDir::tempPath();
+	this->parameters.replayRawFormat = "16, 1024, 512, 256, 1, 10";
+	this->parameters.replayMaximumSpeed = false;
+	this->parameters.displayLevel = 0.0;
+	this->parameters.displayWindow = 0.0;
+	this->parameters.displayGamma = 1.0;
+	this->parameters.displayLogarithmic = false;
+	this->ui->doubleSpinBox_flightRecorderThreshold->setEnabled(false);
+	this->ui->doubleSpinBox_displayLevel->setEnabled(false);
+	this->lastRawMetricValue = 0;
+	this->rawMetricValueAvailable = false;
+	this->metricDisplayPending = false;
+	this->pendingReferenceValue = false;
+	this->pendingMetricValue = 0;
+	this->latencyMonitor = nullptr;
+	this->updatePlotCurves();
 }
 
 SignalMonitorForm::~SignalMonitorForm() {
@@ -103,13 +217,32 @@ void SignalMonitorForm::setSettings(QVariantMap settings) {
 		this->parameters.bufferSource = static_cast<BUFFER_SOURCE>(settings.value(SIGNALMONITOR_SOURCE).toInt());
 		this->parameters.imageMetric = static_cast<IMAGE_METRIC>(settings.value(SIGNALMONITOR_METRIC).toInt());
 		this->parameters.frameNr = settings.value(SIGNALMONITOR_FRAME).toInt();
-		this->parameters.nthBufferToUse = settings.value(SIGNALMONITOR_NTHBUFFER).toInt();
+		this->parameters.updateRate = settings.value(SIGNALMONITOR_UPDATE_RATE, this->parameters.updateRate).toDouble();
 		int roiX = settings.value(SIGNALMONITOR_ROI_X).toInt();
 		int roiY = settings.value(SIGNALMONITOR_ROI_Y).toInt();
 		int roiWidth = settings.value(SIGNALMONITOR_ROI_WIDTH).toInt();
 		int roiHeight = settings.value(SIGNALMONITOR_ROI_HEIGHT).toInt();
 		this->parameters.roi = QRect(roiX, roiY, roiWidth, roiHeight);
 		this->parameters.windowState = settings.value(SIGNALMONITOR_WINDOW_STATE).toByteArray();
+		this->parameters.workerCores = settings.value(SIGNALMONITOR_WORKER_CORES, this->parameters.workerCores).toString();
+		this->parameters.workerNiceLevel = settings.value(SIGNALMONITOR_WORKER_NICE_LEVEL, this->parameters.workerNiceLevel).toInt();
+		this->parameters.queueDepth = settings.value(SIGNALMONITOR_QUEUE_DEPTH, this->parameters.queueDepth).toInt();
+		this->parameters.overflowPolicy = settings.value(SIGNALMONITOR_OVERFLOW_POLICY, this->parameters.overflowPolicy).toInt();
+		this->parameters.streamingCopy = settings.value(SIGNALMONITOR_STREAMING_COPY, this->parameters.streamingCopy).toBool();
+		this->parameters.flightRecorderFrames = settings.value(SIGNALMONITOR_FLIGHT_RECORDER_FRAMES, this->parameters.flightRecorderFrames).toInt();
+		this->parameters.flightRecorderTrigger = static_cast<FLIGHTRECORDER_TRIGGER>(settings.value(SIGNALMONITOR_FLIGHT_RECORDER_TRIGGER, static_cast<int>(this->parameters.flightRecorderTrigger)).toInt());
+		this->parameters.flightRecorderThreshold = settings.value(SIGNALMONITOR_FLIGHT_RECORDER_THRESHOLD, this->parameters.flightRecorderThreshold).toDouble();
+		this->parameters.flightRecorderFolder = settings.value(SIGNALMONITOR_FLIGHT_RECORDER_FOLDER, this->parameters.flightRecorderFolder).toString();
+		this->parameters.replayRawFormat = settings.value(SIGNALMONITOR_REPLAY_RAW_FORMAT, this->parameters.replayRawFormat).toString();
+		this->parameters.replayMaximumSpeed = settings.value(SIGNALMONITOR_REPLAY_MAXIMUM_SPEED, this->parameters.replayMaximumSpeed).toBool();
+		this->parameters.displayLevel = settings.value(SIGNALMONITOR_DISPLAY_LEVEL, this->parameters.displayLevel).toDouble();
+		this->parameters.displayWindow = settings.value(SIGNALMONITOR_DISPLAY_WINDOW, this->parameters.displayWindow).toDouble();
+		this->parameters.displayGamma = settings.value(SIGNALMONITOR_DISPLAY_GAMMA, this->parameters.displayGamma).toDouble();
+		this->parameters.displayLogarithmic = settings.value(SIGNALMONITOR_DISPLAY_LOGARITHMIC, this->parameters.displayLogarithmic).toBool();
+		//a replay is not running after a restart, the monitor falls back to live data
+		if(this->parameters.bufferSource == REPLAY){
+			this->parameters.bufferSource = PROCESSED;
+		}
 	}
 
 	//update gui elements
@@ -118,8 +251,21 @@ void SignalMonitorForm::setSettings(QVariantMap settings) {
 	this->ui->comboBox_imageSource->setCurrentIndex(static_cast<int>(this->parameters.bufferSource));
 	this->ui->comboBox_imageMetric->setCurrentIndex(static_cast<int>(this->parameters.imageMetric));
 	this->ui->horizontalSlider_frame->setValue(this->parameters.frameNr);
-	this->ui->spinBox_nthBuffer->setValue(this->parameters.nthBufferToUse);
+	this->ui->doubleSpinBox_updateRate->setValue(this->parameters.updateRate);
 	this->ui->widget_imageDisplay->setRoi(this->parameters.roi);
+	this->ui->lineEdit_workerCores->setText(this->parameters.workerCores);
+	this->ui->spinBox_workerNiceLevel->setValue(this->parameters.workerNiceLevel);
+	this->ui->spinBox_queueDepth->setValue(this->parameters.queueDepth);
+	this->ui->comboBox_overflowPolicy->setCurrentIndex(this->parameters.overflowPolicy);
+	this->ui->spinBox_flightRecorderFrames->setValue(this->parameters.flightRecorderFrames);
+	this->ui->doubleSpinBox_flightRecorderThreshold->setValue(this->parameters.flightRecorderThreshold);
+	this->ui->comboBox_flightRecorderTrigger->setCurrentIndex(static_cast<int>(this->parameters.flightRecorderTrigger));
+	this->setReplayMaximumSpeedChecked(this->parameters.replayMaximumSpeed);
+	this->setStreamingCopyChecked(this->parameters.streamingCopy);
+	this->ui->doubleSpinBox_displayLevel->setValue(this->parameters.displayLevel);
+	this->ui->doubleSpinBox_displayWindow->setValue(this->parameters.displayWindow);
+	this->ui->doubleSpinBox_displayGamma->setValue(this->parameters.displayGamma);
+	this->ui->checkBox_displayLogarithmic->setChecked(this->parameters.displayLogarithmic);
 	this->restoreGeometry(this->parameters.windowState);
 }
 
@@ -132,12 +278,27 @@ void SignalMonitorForm::getSettings(QVariantMap* settings) {
 	settings->insert(SIGNALMONITOR_SOURCE, static_cast<int>(this->parameters.bufferSource));
 	settings->insert(SIGNALMONITOR_METRIC, static_cast<int>(this->parameters.imageMetric));
 	settings->insert(SIGNALMONITOR_FRAME, this->parameters.frameNr);
-	settings->insert(SIGNALMONITOR_NTHBUFFER, this->parameters.nthBufferToUse);
+	settings->insert(SIGNALMONITOR_UPDATE_RATE, this->parameters.updateRate);
 	settings->insert(SIGNALMONITOR_ROI_X, this->parameters.roi.x());
 	settings->insert(SIGNALMONITOR_ROI_Y, this->parameters.roi.y());
 	settings->insert(SIGNALMONITOR_ROI_WIDTH, this->parameters.roi.width());
 	settings->insert(SIGNALMONITOR_ROI_HEIGHT, this->parameters.roi.height());
 	settings->insert(SIGNALMONITOR_WINDOW_STATE, this->parameters.windowState);
+	settings->insert(SIGNALMONITOR_WORKER_CORES, this->parameters.workerCores);
+	settings->insert(SIGNALMONITOR_WORKER_NICE_LEVEL, this->parameters.workerNiceLevel);
+	settings->insert(SIGNALMONITOR_QUEUE_DEPTH, this->parameters.queueDepth);
+	settings->insert(SIGNALMONITOR_OVERFLOW_POLICY, this->parameters.overflowPolicy);
+	settings->insert(SIGNALMONITOR_STREAMING_COPY, this->parameters.streamingCopy);
+	settings->insert(SIGNALMONITOR_FLIGHT_RECORDER_FRAMES, this->parameters.flightRecorderFrames);
+	settings->insert(SIGNALMONITOR_FLIGHT_RECORDER_TRIGGER, static_cast<int>(this->parameters.flightRecorderTrigger));
+	settings->insert(SIGNALMONITOR_FLIGHT_RECORDER_THRESHOLD, this->parameters.flightRecorderThreshold);
+	settings->insert(SIGNALMONITOR_FLIGHT_RECORDER_FOLDER, this->parameters.flightRecorderFolder);
+	settings->insert(SIGNALMONITOR_REPLAY_RAW_FORMAT, this->parameters.replayRawFormat);
+	settings->insert(SIGNALMONITOR_REPLAY_MAXIMUM_SPEED, this->parameters.replayMaximumSpeed);
+	settings->insert(SIGNALMONITOR_DISPLAY_LEVEL, this->parameters.displayLevel);
+	settings->insert(SIGNALMONITOR_DISPLAY_WINDOW, this->parameters.displayWindow);
+	settings->insert(SIGNALMONITOR_DISPLAY_GAMMA, this->parameters.displayGamma);
+	settings->insert(SIGNALMONITOR_DISPLAY_LOGARITHMIC, this->parameters.displayLogarithmic);
 }
 
 bool SignalMonitorForm::eventFilter(QObject* watched, QEvent* event) {
@@ -158,7 +319,7 @@ void SignalMonitorForm::toggleSettingsArea() {
 	const int animationDuration = 300; //in milliseconds
 	const int deltaHeight = settingsArea->minimumHeight();
 	const int minHeightWhenHidden = 220;
-	const int minHeightWhenShown = minHeightWhenHidden + 330;
+	const int minHeightWhenShown = minHeightWhenHidden + 590;
 
 	//prepare window height change animation
 	QPropertyAnimation* windowHeightAnimation = new QPropertyAnimation(this, "geometry");
@@ -214,7 +375,353 @@ void SignalMonitorForm::setMaximumBufferNr(int maximum) {
 	this->ui->spinBox_buffer->setMaximum(maximum);
 }
 
-void SignalMonitorForm::displayCurrentMetricValue(qreal value) {
-	this->ui->textEdit_currentValue->setText(QString::number(value));
-	this->getScrollingPlot()->addDataToCurve(value);
+void SignalMonitorForm::displayRawMetricValue(qreal value, FrameDescriptor frame, qint64 calculationTimestamp) {
+	this->plotSequenceCheckerRaw.check(frame);
+	if(!this->isCurrentMetric(frame)){
+		return;
+	}
+	this->lastRawMetricValue = value;
+	this->rawMetricValueAvailable = true;
+	if(this->parameters.bufferSource == RAW){
+		this->appendMetricValue(value, frame, false);
+		this->recordPlotLatency(frame.acquisitionTimestamp, calculationTimestamp);
+	}
+}
+
+void SignalMonitorForm::displayProcessedMetricValue(qreal value, FrameDescriptor frame, qint64 calculationTimestamp) {
+	this->plotSequenceCheckerProcessed.check(frame);
+	if(!this->isCurrentMetric(frame)){
+		return;
+	}
+	if(this->parameters.bufferSource == PROCESSED){
+		this->appendMetricValue(value, frame, false);
+		this->recordPlotLatency(frame.acquisitionTimestamp, calculationTimestamp);
+	}
+	//if both sources are monitored, the processed value is plotted together with the most recent raw value
+	else if(this->parameters.bufferSource == RAW_AND_PROCESSED && this->rawMetricValueAvailable){
+		this->appendMetricValue(value, frame, true);
+		this->recordPlotLatency(frame.acquisitionTimestamp, calculationTimestamp);
+	}
+}
+
+SequenceCounters SignalMonitorForm::getPlotSequenceCounters(BUFFER_SOURCE source) const {
+	switch(source){
+		case RAW: return this->plotSequenceCheckerRaw.getCounters();
+		case REPLAY: return this->plotSequenceCheckerReplay.getCounters();
+		default: return this->plotSequenceCheckerProcessed.getCounters();
+	}
+}
+
+void SignalMonitorForm::displayReplayMetricValue(qreal value, FrameDescriptor frame, qint64 calculationTimestamp) {
+	this->plotSequenceCheckerReplay.check(frame);
+	if(!this->isCurrentMetric(frame)){
+		return;
+	}
+	if(this->parameters.bufferSource == REPLAY){
+		this->appendMetricValue(value, frame, false);
+		this->recordPlotLatency(frame.acquisitionTimestamp, calculationTimestamp);
+	}
+}
+
+void SignalMonitorForm::appendMetricValue(qreal value, const FrameDescriptor& frame, bool withReferenceValue) {
+	//values are only added to the plot here, text, tooltip and plot are redrawn once per batch by updateMetricDisplay()
+	if(withReferenceValue){
+		this->scrollingPlot->appendDataToCurves(value, this->lastRawMetricValue);
+	}else{
+		this->scrollingPlot->appendDataToCurve(value);
+	}
+	this->pendingMetricValue = value;
+	this->pendingMetricFrame = frame;
+	this->pendingReferenceValue = withReferenceValue;
+	this->metricDisplayPending = true;
+}
+
+void SignalMonitorForm::updateMetricDisplay() {
+	if(!this->metricDisplayPending){
+		return;
+	}
+	this->metricDisplayPending = false;
+	this->showConfiguration(this->pendingMetricFrame);
+	if(this->pendingReferenceValue){
+		this->ui->textEdit_currentValue->setText(tr("P: ") + QString::number(this->pendingMetricValue) + "  " + tr("R: ") + QString::number(this->lastRawMetricValue));
+		TRACE_SCOPE("plot");
+		this->scrollingPlot->updateCurves();
+	}else{
+		this->ui->textEdit_currentValue->setText(QString::number(this->pendingMetricValue));
+		TRACE_SCOPE("plot");
+		this->scrollingPlot->updateCurve();
+	}
+}
+
+void SignalMonitorForm::selectBufferSource(BUFFER_SOURCE source) {
+	this->ui->comboBox_imageSource->setCurrentIndex(static_cast<int>(source));
+}
+
+bool SignalMonitorForm::isCurrentMetric(const FrameDescriptor& frame) {
+	//values that were calculated with a different metric are still in flight after the metric was changed. they are not plotted
+	return frame.imageMetric == this->parameters.imageMetric;
+}
+
+void SignalMonitorForm::showConfiguration(const FrameDescriptor& frame) {
+	//every plotted value can be traced back to the configuration and roi that produced it
+	const QRect& roi = frame.roi;
+	this->ui->textEdit_currentValue->setToolTip(tr("Frame %1, configuration %2\nROI: %3, %4, %5, %6")
+		.arg(frame.sequenceNumber).arg(frame.configurationVersion)
+		.arg(roi.x()).arg(roi.y()).arg(roi.width()).arg(roi.height()));
+}
+
+void SignalMonitorForm::setLatencyMonitor(LatencyMonitor* latencyMonitor) {
+	this->latencyMonitor = latencyMonitor;
+	this->imageDisplay->setLatencyMonitor(latencyMonitor);
+}
+
+void SignalMonitorForm::recordPlotLatency(qint64 acquisitionTimestamp, qint64 calculationTimestamp) {
+	if(this->latencyMonitor == nullptr){
+		return;
+	}
+	qint64 plotTimestamp = LatencyMonitor::now();
+	this->latencyMonitor->record(STAGE_PLOT, calculationTimestamp, plotTimestamp);
+	this->latencyMonitor->record(STAGE_END_TO_END, acquisitionTimestamp, plotTimestamp);
+}
+
+void SignalMonitorForm::displayLatencies() {
+	if(this->latencyMonitor == nullptr){
+		return;
+	}
+	const LatencyHistogram& endToEnd = this->latencyMonitor->getHistogram(STAGE_END_TO_END);
+	this->ui->label_latency->setText(QString::number(endToEnd.getPercentile(50)/1.0e6, 'f', 2) + " / " + QString::number(endToEnd.getPercentile(99)/1.0e6, 'f', 2) + " ms");
+
+	//all stages are listed in the tool tip
+	QString toolTip = tr("Stage: p50 / p99 / max in ms");
+	for(int i = 0; i < NUMBER_OF_LATENCY_STAGES; i++){
+		const LatencyHistogram& histogram = this->latencyMonitor->getHistogram(static_cast<LATENCY_STAGE>(i));
+		toolTip += "\n" + LatencyMonitor::stageName(static_cast<LATENCY_STAGE>(i)) + ": "
+			+ QString::number(histogram.getPercentile(50)/1.0e6, 'f', 2) + " / "
+			+ QString::number(histogram.getPercentile(99)/1.0e6, 'f', 2) + " / "
+			+ QString::number(histogram.getMaximum()/1.0e6, 'f', 2);
+	}
+	this->ui->label_latency->setToolTip(toolTip);
+}
+
+void SignalMonitorForm::exportLatencyHistograms() {
+	if(this->latencyMonitor == nullptr){
+		return;
+	}
+	QString fileName = QFileDialog::getSaveFileName(this, tr("Export latency histograms"), QDir::currentPath(), tr("CSV (*.csv)"));
+	if(fileName == ""){
+		emit error(tr("Export of latency histograms canceled."));
+		return;
+	}
+	if(this->latencyMonitor->saveToFile(fileName)){
+		emit info(tr("Latency histograms saved to ") + fileName);
+	}else{
+		emit error(tr("Could not save latency histograms to disk."));
+	}
+}
+
+void SignalMonitorForm::saveTrace() {
+	bool ok = false;
+	int seconds = QInputDialog::getInt(this, tr("Save trace"), tr("Save the last n seconds:"), 10, 1, 3600, 1, &ok);
+	if(!ok){
+		return;
+	}
+	QString fileName = QFileDialog::getSaveFileName(this, tr("Save trace"), QDir::currentPath(), tr("Trace event JSON (*.json)"));
+	if(fileName == ""){
+		emit error(tr("Save trace canceled."));
+		return;
+	}
+	if(!Tracer::isEnabled()){
+		emit info(tr("Trace recording is disabled. Enable \"Record trace\" to record new events."));
+	}
+	if(Tracer::saveToFile(fileName, static_cast<qint64>(seconds)*1000000000LL)){
+		emit info(tr("Trace saved to ") + fileName);
+	}else{
+		emit error(tr("Could not save trace to disk."));
+	}
+}
+
+void SignalMonitorForm::toggleMetricRecording(bool checked) {
+	if(!checked){
+		emit stopMetricRecording();
+		return;
+	}
+	QString fileName = QFileDialog::getSaveFileName(this, tr("Record metrics"), QDir::currentPath(), tr("Signal monitor recording (*.smr)"));
+	if(fileName == ""){
+		this->setMetricRecordingActive(false);
+		emit error(tr("Metric recording canceled."));
+		return;
+	}
+	emit startMetricRecording(fileName);
+}
+
+void SignalMonitorForm::setMetricRecordingActive(bool active) {
+	//only updates the check mark, no recording is started or stopped
+	QSignalBlocker blocker(this->recordMetricsAction);
+	this->recordMetricsAction->setChecked(active);
+}
+
+void SignalMonitorForm::selectFlightRecorderFolder() {
+	QString folder = QFileDialog::getExistingDirectory(this, tr("Flight recorder folder"), this->parameters.flightRecorderFolder);
+	if(folder == ""){
+		return;
+	}
+	this->parameters.flightRecorderFolder = folder;
+	emit flightRecorderSettingsChanged();
+	emit paramsChanged();
+}
+
+void SignalMonitorForm::openReplayFile() {
+	QString fileName = QFileDialog::getOpenFileName(this, tr("Replay recording"), QDir::currentPath(), tr("Flight records (*.sfr);;OCTproZ raw recordings (*)"));
+	if(fileName == ""){
+		return;
+	}
+
+	//raw recordings have no header, their dimensions are asked for. flight records describe every frame themselves
+	if(!fileName.endsWith(".sfr", Qt::CaseInsensitive)){
+		bool ok = false;
+		QString format = QInputDialog::getText(this, tr("Raw recording format"),
+			tr("Bit depth, samples per line, lines per frame, frames per buffer, buffers per volume, buffers per second:"),
+			QLineEdit::Normal, this->parameters.replayRawFormat, &ok);
+		if(!ok){
+			return;
+		}
+		ReplayRawFormat rawFormat;
+		if(!ReplayRawFormat::fromString(format, &rawFormat)){
+			emit error(tr("Invalid raw recording format: ") + format);
+			return;
+		}
+		this->parameters.replayRawFormat = rawFormat.toString();
+		emit paramsChanged();
+	}
+	emit startReplay(fileName);
+}
+
+void SignalMonitorForm::setReplayMaximumSpeedChecked(bool checked) {
+	QSignalBlocker blocker(this->replayMaximumSpeedAction);
+	this->replayMaximumSpeedAction->setChecked(checked);
+}
+
+void SignalMonitorForm::setStreamingCopyChecked(bool checked) {
+	QSignalBlocker blocker(this->streamingCopyAction);
+	this->streamingCopyAction->setChecked(checked);
+}
+
+void SignalMonitorForm::setupToolMenu() {
+	QMenu* menu = new QMenu(this);
+	QAction* exportLatencyAction = menu->addAction(tr("Export latency histograms..."));
+	connect(exportLatencyAction, &QAction::triggered, this, &SignalMonitorForm::exportLatencyHistograms);
+	QAction* resetLatencyAction = menu->addAction(tr("Reset latency histograms"));
+	connect(resetLatencyAction, &QAction::triggered, this, [this]() {
+		if(this->latencyMonitor != nullptr){
+			this->latencyMonitor->reset();
+			this->displayLatencies();
+		}
+	});
+	menu->addSeparator();
+	QAction* recordTraceAction = menu->addAction(tr("Record trace"));
+	recordTraceAction->setCheckable(true);
+	recordTraceAction->setChecked(Tracer::isEnabled());
+	connect(recordTraceAction, &QAction::toggled, this, [](bool checked) {
+		Tracer::setEnabled(checked);
+	});
+	QAction* saveTraceAction = menu->addAction(tr("Save trace..."));
+	connect(saveTraceAction, &QAction::triggered, this, &SignalMonitorForm::saveTrace);
+	menu->addSeparator();
+	this->recordMetricsAction = menu->addAction(tr("Record metrics to file..."));
+	this->recordMetricsAction->setCheckable(true);
+	connect(this->recordMetricsAction, &QAction::toggled, this, &SignalMonitorForm::toggleMetricRecording);
+	menu->addSeparator();
+	QAction* dumpFlightRecorderAction = menu->addAction(tr("Save flight recorder"));
+	dumpFlightRecorderAction->setShortcut(QKeySequence(Qt::Key_F9));
+	dumpFlightRecorderAction->setShortcutContext(Qt::WindowShortcut);
+	this->addAction(dumpFlightRecorderAction); //the shortcut also works while the menu is closed
+	connect(dumpFlightRecorderAction, &QAction::triggered, this, &SignalMonitorForm::dumpFlightRecorder);
+	QAction* flightRecorderFolderAction = menu->addAction(tr("Flight recorder folder..."));
+	connect(flightRecorderFolderAction, &QAction::triggered, this, &SignalMonitorForm::selectFlightRecorderFolder);
+	menu->addSeparator();
+	QAction* replayAction = menu->addAction(tr("Replay recording..."));
+	connect(replayAction, &QAction::triggered, this, &SignalMonitorForm::openReplayFile);
+	QAction* stopReplayAction = menu->addAction(tr("Stop replay"));
+	connect(stopReplayAction, &QAction::triggered, this, &SignalMonitorForm::stopReplay);
+	this->replayMaximumSpeedAction = menu->addAction(tr("Replay at maximum speed"));
+	this->replayMaximumSpeedAction->setCheckable(true);
+	connect(this->replayMaximumSpeedAction, &QAction::toggled, this, [this](bool checked) {
+		this->parameters.replayMaximumSpeed = checked;
+		emit replaySettingsChanged();
+		emit paramsChanged();
+	});
+	menu->addSeparator();
+	this->streamingCopyAction = menu->addAction(tr("Streaming frame copy (experimental)"));
+	this->streamingCopyAction->setCheckable(true);
+	this->streamingCopyAction->setToolTip(tr("Copy large frames in the acquisition thread with non-temporal stores that bypass its caches. Slower than a normal copy on most systems, only enable it if a benchmark on this workstation shows a gain."));
+	connect(this->streamingCopyAction, &QAction::toggled, this, [this](bool checked) {
+		this->parameters.streamingCopy = checked;
+		emit pipelineSettingsChanged();
+		emit paramsChanged();
+	});
+	this->ui->toolButton_menu->setMenu(menu);
+	this->ui->toolButton_menu->setPopupMode(QToolButton::InstantPopup);
+}
+
+void SignalMonitorForm::displayEffectiveRates(double rawRateInHz, double processedRateInHz, double replayRateInHz) {
+	switch(this->parameters.bufferSource){
+		case RAW: this->ui->label_effectiveRate->setText(QString::number(rawRateInHz, 'f', 1) + " Hz"); break;
+		case PROCESSED: this->ui->label_effectiveRate->setText(QString::number(processedRateInHz, 'f', 1) + " Hz"); break;
+		case REPLAY: this->ui->label_effectiveRate->setText(QString::number(replayRateInHz, 'f', 1) + " Hz"); break;
+		default: this->ui->label_effectiveRate->setText(tr("P: ") + QString::number(processedRateInHz, 'f', 1) + " Hz  " + tr("R: ") + QString::number(rawRateInHz, 'f', 1) + " Hz");
+	}
+}
+
+void SignalMonitorForm::updatePlotCurves() {
+	//curve shows the processed data (or the only monitored source), reference curve shows the raw data if both sources are monitored
+	bool bothSources = this->parameters.bufferSource == RAW_AND_PROCESSED;
+	this->rawMetricValueAvailable = false;
+	switch(this->parameters.bufferSource){
+		case RAW: this->scrollingPlot->setCurveName(tr("Raw")); break;
+		case REPLAY: this->scrollingPlot->setCurveName(tr("Replay")); break;
+		default: this->scrollingPlot->setCurveName(tr("Processed"));
+	}
+	this->scrollingPlot->setReferenceCurveName(tr("Raw"));
+	this->scrollingPlot->setLegendVisible(bothSources);
+	this->scrollingPlot->clearPlot();
+}
+
+void SignalMonitorForm::displayWorkerCores(QString workerCores, QString acquisitionCores) {
+	this->ui->lineEdit_workerCores->setToolTip(tr("Cores the worker threads may run on, e.g. 2-7. Leave empty to use all cores except the ones of the acquisition thread.")
+		+ "\n" + tr("Worker cores in use: %1").arg(workerCores)
+		+ "\n" + tr("Acquisition thread seen on: %1").arg(acquisitionCores.isEmpty() ? tr("-") : acquisitionCores));
+}
+
+void SignalMonitorForm::displayIngestStatistics(const IngestCounters& raw, const IngestCounters& processed) {
+	const IngestCounters* counters[] = {&raw, &processed};
+	QLabel* labels[] = {this->ui->label_statisticsRaw, this->ui->label_statisticsProcessed};
+	for(int i = 0; i < 2; i++){
+		labels[i]->setText(tr("%1 received, %2 used, %3 lost").arg(counters[i]->received()).arg(counters[i]->accepted).arg(counters[i]->dropped[DROP_BUSY]));
+		labels[i]->setToolTip(tr("Skipped (update rate): %1\nLost (busy): %2\nWrong buffer: %3\nDisabled: %4")
+			.arg(counters[i]->skipped)
+			.arg(counters[i]->dropped[DROP_BUSY])
+			.arg(counters[i]->dropped[DROP_WRONG_BUFFER])
+			.arg(counters[i]->dropped[DROP_DISABLED]));
+	}
+}
+
+void SignalMonitorForm::displayPipelineStatistics(QList<PipelineStage*> stages, double intervalInSeconds) {
+	//the label shows how full every queue is, throughput and drops are listed in the tool tip
+	QStringList depths;
+	QString toolTip = tr("Stage: frames/s, dropped, max. queued, busy");
+	for(PipelineStage* stage : stages){
+		StageCounters counters = stage->getCounters();
+		StageCounters reported = this->reportedStageCounters.value(stage->getName(), counters);
+		double throughput = intervalInSeconds > 0 ? (counters.processed - reported.processed)/intervalInSeconds : 0.0;
+		double busy = intervalInSeconds > 0 ? (counters.busyNanoseconds - reported.busyNanoseconds)/(intervalInSeconds*1.0e9) : 0.0;
+		depths.append(QString("%1/%2").arg(counters.queue.depth).arg(counters.queue.capacity));
+		toolTip += "\n" + stage->getName() + ": "
+			+ QString::number(throughput, 'f', 1) + ", "
+			+ QString::number(counters.queue.dropped) + ", "
+			+ QString::number(counters.queue.maximumDepth) + ", "
+			+ QString::number(qMin(1.0, busy)*100.0, 'f', 0) + " %";
+		this->reportedStageCounters.insert(stage->getName(), counters);
+	}
+	this->ui->label_pipeline->setText(depths.join("  "));
+	this->ui->label_pipeline->setToolTip(toolTip);
 }
@@ -3,9 +3,15 @@
 
 #include <QWidget>
 #include <QRect>
+#include <QMap>
+#include <QAction>
 #include "signalmonitorparameters.h"
 #include "scrollingplot.h"
 #include "imagedisplay.h"
+#include "ingeststatistics.h"
+#include "latencymonitor.h"
+#include "framedescriptor.h"
+#include "pipelinestage.h"
 
 namespace Ui {
 class SignalMonitorForm;
@@ -24,6 +30,9 @@ public:
 
 	ScrollingPlot* getScrollingPlot(){return this->scrollingPlot;}
 	ImageDisplay* getImageDisplay(){return this->imageDisplay;}
+	SignalMonitorParameters getParameters(){return this->parameters;}
+	void setLatencyMonitor(LatencyMonitor* latencyMonitor);
+	SequenceCounters getPlotSequenceCounters(BUFFER_SOURCE source) const;
 
 	Ui::SignalMonitorForm* ui;
 
@@ -34,21 +43,69 @@ public slots:
 	void toggleSettingsArea();
 	void setMaximumFrameNr(int maximum);
 	void setMaximumBufferNr(int maximum);
-	void displayCurrentMetricValue(qreal value);
+	void displayRawMetricValue(qreal value, FrameDescriptor frame, qint64 calculationTimestamp);
+	void displayProcessedMetricValue(qreal value, FrameDescriptor frame, qint64 calculationTimestamp);
+	void displayReplayMetricValue(qreal value, FrameDescriptor frame, qint64 calculationTimestamp);
+	void updateMetricDisplay();
+	void selectBufferSource(BUFFER_SOURCE source);
+	void displayLatencies();
+	void exportLatencyHistograms();
+	void saveTrace();
+	void toggleMetricRecording(bool checked);
+	void setMetricRecordingActive(bool active);
+	void selectFlightRecorderFolder();
+	void openReplayFile();
+	void setReplayMaximumSpeedChecked(bool checked);
+	void setStreamingCopyChecked(bool checked);
+	void displayEffectiveRates(double rawRateInHz, double processedRateInHz, double replayRateInHz);
+	void displayIngestStatistics(const IngestCounters& raw, const IngestCounters& processed);
+	void displayWorkerCores(QString workerCores, QString acquisitionCores);
+	void displayPipelineStatistics(QList<PipelineStage*> stages, double intervalInSeconds);
 
 private:
 	ScrollingPlot* scrollingPlot;
 	ImageDisplay* imageDisplay;
 	QSize lastSize;
 	SignalMonitorParameters parameters;
+	qreal lastRawMetricValue;
+	bool rawMetricValueAvailable;
+	bool metricDisplayPending;
+	bool pendingReferenceValue;
+	qreal pendingMetricValue;
+	FrameDescriptor pendingMetricFrame;
+	LatencyMonitor* latencyMonitor;
+	SequenceChecker plotSequenceCheckerRaw;
+	SequenceChecker plotSequenceCheckerProcessed;
+	SequenceChecker plotSequenceCheckerReplay;
+	QMap<QString, StageCounters> reportedStageCounters;
+	QAction* recordMetricsAction;
+	QAction* replayMaximumSpeedAction;
+	QAction* streamingCopyAction;
+
+	void updatePlotCurves();
+	void appendMetricValue(qreal value, const FrameDescriptor& frame, bool withReferenceValue);
+	void recordPlotLatency(qint64 acquisitionTimestamp, qint64 calculationTimestamp);
+	bool isCurrentMetric(const FrameDescriptor& frame);
+	void showConfiguration(const FrameDescriptor& frame);
+	void setupToolMenu();
 
 signals:
 	void paramsChanged();
 	void frameNrChanged(int);
 	void bufferNrChanged(int);
 	void imageMetricChanged(int);
-	void nthBufferChanged(int);
+	void updateRateChanged(double);
 	void bufferSourceChanged(BUFFER_SOURCE);
+	void workerSettingsChanged();
+	void pipelineSettingsChanged();
+	void startMetricRecording(QString fileName);
+	void stopMetricRecording();
+	void flightRecorderSettingsChanged();
+	void dumpFlightRecorder();
+	void startReplay(QString fileName);
+	void stopReplay();
+	void replaySettingsChanged();
+	void displaySettingsChanged();
 	void roiChanged(QRect);
 	void info(QString);
 	void error(QString);
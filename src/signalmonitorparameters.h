@@ -11,16 +11,33 @@
 #define SIGNALMONITOR_METRIC "metric"
 #define SIGNALMONITOR_FRAME "frame_number"
 #define SIGNALMONITOR_BUFFER "buffer_number"
-#define SIGNALMONITOR_NTHBUFFER "nth_buffer_to_use"
+#define SIGNALMONITOR_UPDATE_RATE "update_rate_hz"
 #define SIGNALMONITOR_ROI_X "roi_x"
 #define SIGNALMONITOR_ROI_Y "roi_y"
 #define SIGNALMONITOR_ROI_WIDTH "roi_width"
 #define SIGNALMONITOR_ROI_HEIGHT "roi_height"
 #define SIGNALMONITOR_WINDOW_STATE "window_state"
+#define SIGNALMONITOR_WORKER_CORES "worker_cores"
+#define SIGNALMONITOR_WORKER_NICE_LEVEL "worker_nice_level"
+#define SIGNALMONITOR_QUEUE_DEPTH "queue_depth"
+#define SIGNALMONITOR_OVERFLOW_POLICY "overflow_policy"
+#define SIGNALMONITOR_STREAMING_COPY "streaming_copy"
+#define SIGNALMONITOR_FLIGHT_RECORDER_FRAMES "flight_recorder_frames"
+#define SIGNALMONITOR_FLIGHT_RECORDER_TRIGGER "flight_recorder_trigger"
+#define SIGNALMONITOR_FLIGHT_RECORDER_THRESHOLD "flight_recorder_threshold"
+#define SIGNALMONITOR_FLIGHT_RECORDER_FOLDER "flight_recorder_folder"
+#define SIGNALMONITOR_REPLAY_RAW_FORMAT "replay_raw_format"
+#define SIGNALMONITOR_REPLAY_MAXIMUM_SPEED "replay_maximum_speed"
+#define SIGNALMONITOR_DISPLAY_LEVEL "display_level"
+#define SIGNALMONITOR_DISPLAY_WINDOW "display_window"
+#define SIGNALMONITOR_DISPLAY_GAMMA "display_gamma"
+#define SIGNALMONITOR_DISPLAY_LOGARITHMIC "display_logarithmic"
 
 enum BUFFER_SOURCE{
 	RAW,
-	PROCESSED
+	PROCESSED,
+	RAW_AND_PROCESSED,
+	REPLAY //recorded file, see replaysource.h
 };
 
 enum IMAGE_METRIC{
@@ -30,15 +47,36 @@ enum IMAGE_METRIC{
 	COEFFVAR
 };
 
+enum FLIGHTRECORDER_TRIGGER{
+	TRIGGER_OFF,
+	TRIGGER_ABOVE, //metric rises above the threshold
+	TRIGGER_BELOW //metric falls below the threshold
+};
+
 struct SignalMonitorParameters {
 	BUFFER_SOURCE bufferSource;
 	IMAGE_METRIC imageMetric;
 	QRect roi;
 	int frameNr;
 	int bufferNr;
-	int nthBufferToUse;
+	double updateRate;
 	int visibleSamples;
 	QByteArray windowState;
+	QString workerCores;
+	int workerNiceLevel;
+	int queueDepth;
+	int overflowPolicy; //OVERFLOW_POLICY of boundedqueue.h
+	bool streamingCopy; //copy frames with non-temporal stores, off by default (see streamingcopy.h)
+	int flightRecorderFrames;
+	FLIGHTRECORDER_TRIGGER flightRecorderTrigger;
+	double flightRecorderThreshold;
+	QString flightRecorderFolder;
+	QString replayRawFormat; //see ReplayRawFormat::fromString()
+	bool replayMaximumSpeed;
+	double displayLevel;
+	double displayWindow; //0: full range of the bit depth
+	double displayGamma;
+	bool displayLogarithmic;
 };
 Q_DECLARE_METATYPE(SignalMonitorParameters)
 
@@ -0,0 +1,63 @@
+#include "streamingcopy.h"
+#include <string.h>
+#include <stdint.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define STREAMINGCOPY_SSE2
+#include <emmintrin.h>
+#endif
+
+#define STREAMINGCOPY_BLOCK_BYTES 64
+#define STREAMINGCOPY_PREFETCH_DISTANCE 512
+
+
+bool streamingCopyAvailable() {
+#ifdef STREAMINGCOPY_SSE2
+	return true;
+#else
+	return false;
+#endif
+}
+
+void streamingCopy(void* destination, const void* source, size_t bytes) {
+#ifdef STREAMINGCOPY_SSE2
+	if(bytes < STREAMINGCOPY_THRESHOLD_BYTES){
+		memcpy(destination, source, bytes);
+		return;
+	}
+
+	char* dst = static_cast<char*>(destination);
+	const char* src = static_cast<const char*>(source);
+
+	//copy head with memcpy until destination is 16 byte aligned, non-temporal stores need aligned addresses
+	size_t head = (16 - (reinterpret_cast<uintptr_t>(dst) & 15)) & 15;
+	memcpy(dst, src, head);
+	dst += head;
+	src += head;
+	bytes -= head;
+
+	//stream 64 byte blocks (one cache line) past the caches. the source is prefetched with the non-temporal hint to keep it out of the higher cache levels as well
+	size_t blocks = bytes/STREAMINGCOPY_BLOCK_BYTES;
+	for(size_t i = 0; i < blocks; i++){
+		_mm_prefetch(src + STREAMINGCOPY_PREFETCH_DISTANCE, _MM_HINT_NTA);
+		__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+		__m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 16));
+		__m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 32));
+		__m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 48));
+		_mm_stream_si128(reinterpret_cast<__m128i*>(dst), a);
+		_mm_stream_si128(reinterpret_cast<__m128i*>(dst + 16), b);
+		_mm_stream_si128(reinterpret_cast<__m128i*>(dst + 32), c);
+		_mm_stream_si128(reinterpret_cast<__m128i*>(dst + 48), d);
+		src += STREAMINGCOPY_BLOCK_BYTES;
+		dst += STREAMINGCOPY_BLOCK_BYTES;
+	}
+
+	//make streamed data visible to other threads before the frame is handed over
+	_mm_sfence();
+
+	//copy remaining tail
+	memcpy(dst, src, bytes - blocks*STREAMINGCOPY_BLOCK_BYTES);
+#else
+	memcpy(destination, source, bytes);
+#endif
+}
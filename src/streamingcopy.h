@@ -0,0 +1,17 @@
+#ifndef STREAMINGCOPY_H
+#define STREAMINGCOPY_H
+
+#include <stddef.h>
+
+//frames smaller than this are copied with memcpy, they fit into the caches anyway
+#define STREAMINGCOPY_THRESHOLD_BYTES (256*1024)
+
+//copies a block of memory with non-temporal stores that bypass the caches of the calling core, so copying
+//a frame in OCTproZ's acquisition or processing thread does not evict the working set of that thread.
+//falls back to memcpy for small blocks and on platforms without SSE2.
+//FrameIngest only uses it if enabled in the settings: on the systems measured so far it is slower than memcpy
+//(see the host/ cases of signalmonitor-bench) without a measurable gain for the working set of the host thread.
+void streamingCopy(void* destination, const void* source, size_t bytes);
+bool streamingCopyAvailable();
+
+#endif //STREAMINGCOPY_H
@@ -0,0 +1,283 @@
+#include "taskpool.h"
+#include "threadtuning.h"
+
+namespace {
+	thread_local const TaskPool* currentPool = nullptr;
+	thread_local int currentWorkerIndex = -1;
+}
+
+
+TaskPoolWorker::TaskPoolWorker(TaskPool* pool, int index)
+	: QThread(),
+	pool(pool),
+	index(index)
+{
+	this->setObjectName(QString("Signal Monitor worker %1").arg(index));
+}
+
+void TaskPoolWorker::run() {
+	this->pool->workerLoop(this->index);
+}
+
+
+TaskPool::TaskPool(int numberOfThreads)
+	: numberOfThreads(numberOfThreads),
+	pendingTasks(0),
+	nextQueue(0),
+	stopping(false),
+	threadCoreMask(0),
+	threadNiceLevel(0),
+	threadSettingsVersion(0),
+	threadSettingsFailures(0)
+{
+	if(this->numberOfThreads <= 0){
+		this->numberOfThreads = qMax(1, QThread::idealThreadCount());
+	}
+	for(int i = 0; i < this->numberOfThreads; i++){
+		this->queues.append(new WorkQueue());
+	}
+}
+
+TaskPool::~TaskPool() {
+	//tasks that are still queued are finished before the queues are deleted, without workers they run in the calling thread
+	this->stop();
+	while(this->tryRunTask(-1)){
+	}
+	qDeleteAll(this->queues);
+	qDeleteAll(this->contexts);
+}
+
+void TaskPool::start() {
+	if(!this->workers.isEmpty()){
+		return;
+	}
+	for(int i = 0; i < this->numberOfThreads; i++){
+		TaskPoolWorker* worker = new TaskPoolWorker(this, i);
+		this->workers.append(worker);
+		worker->start();
+	}
+}
+
+void TaskPool::stop() {
+	//the workers finish all queued tasks before they exit
+	if(this->workers.isEmpty()){
+		return;
+	}
+	this->sleepMutex.lock();
+	this->stopping = true;
+	this->wakeUp.wakeAll();
+	this->sleepMutex.unlock();
+	for(TaskPoolWorker* worker : this->workers){
+		worker->wait();
+		delete worker;
+	}
+	this->workers.clear();
+	this->sleepMutex.lock();
+	this->stopping = false;
+	this->sleepMutex.unlock();
+}
+
+void TaskPool::submit(Task task) {
+	//tasks submitted by a worker stay in its own queue, tasks from other threads are distributed round robin
+	int queueIndex = this->getCurrentWorkerIndex();
+	if(queueIndex < 0){
+		queueIndex = static_cast<int>(static_cast<unsigned int>(this->nextQueue.fetchAndAddRelaxed(1)) % static_cast<unsigned int>(this->queues.size()));
+	}
+	WorkQueue* queue = this->queues.at(queueIndex);
+	queue->mutex.lock();
+	int capacity = queue->tasks.size();
+	if(queue->count == capacity){
+		QVector<Task> tasks(capacity*2);
+		for(int i = 0; i < queue->count; i++){
+			tasks[i] = std::move(queue->tasks[(queue->head + i) % capacity]);
+		}
+		queue->tasks.swap(tasks);
+		queue->head = 0;
+		capacity *= 2;
+	}
+	queue->tasks[(queue->head + queue->count) % capacity] = std::move(task);
+	queue->count++;
+	queue->mutex.unlock();
+
+	this->sleepMutex.lock();
+	this->pendingTasks.ref();
+	this->wakeUp.wakeOne();
+	this->sleepMutex.unlock();
+}
+
+int TaskPool::getNumberOfChunks(int begin, int end, int minimumRangePerTask) const {
+	int count = end - begin;
+	if(count <= 0){
+		return 0;
+	}
+	int maximumChunks = count/qMax(1, minimumRangePerTask);
+	return qBound(1, maximumChunks, this->numberOfThreads*TASKPOOL_CHUNKS_PER_THREAD);
+}
+
+void TaskPool::runParallelFor(int begin, int end, int minimumRangePerTask, const std::function<void(int, int, int)>& body) {
+	int chunks = this->getNumberOfChunks(begin, end, minimumRangePerTask);
+	if(chunks <= 1){
+		if(chunks == 1){
+			body(0, begin, end);
+		}
+		return;
+	}
+
+	//helper tasks are submitted for all chunks but one, the calling thread claims chunks as well. chunks that are already
+	//running in other threads are waited for: after a few yields the caller sleeps until the last chunk wakes it up.
+	//a task only captures the pool and the context, so it fits into std::function without an allocation
+	ParallelForContext* context = this->acquireContext();
+	context->body = &body;
+	context->nextChunk.storeRelease(0);
+	context->remainingChunks.storeRelease(chunks);
+	context->references.storeRelease(chunks);
+	context->begin = begin;
+	context->count = end - begin;
+	context->chunks = chunks;
+	for(int i = 1; i < chunks; i++){
+		this->submit([this, context]() {
+			this->runChunks(context);
+			this->releaseContext(context);
+		});
+	}
+	this->runChunks(context);
+
+	for(int i = 0; i < TASKPOOL_PARALLELFOR_SPINS && context->remainingChunks.loadAcquire() > 0; i++){
+		QThread::yieldCurrentThread();
+	}
+	context->mutex.lock();
+	while(context->remainingChunks.loadAcquire() > 0){
+		context->finished.wait(&context->mutex);
+	}
+	context->mutex.unlock();
+	this->releaseContext(context);
+}
+
+void TaskPool::runChunks(ParallelForContext* context) {
+	forever{
+		int chunk = context->nextChunk.fetchAndAddOrdered(1);
+		if(chunk >= context->chunks){
+			return;
+		}
+		int chunkBegin = context->begin + static_cast<int>(static_cast<qint64>(context->count)*chunk/context->chunks);
+		int chunkEnd = context->begin + static_cast<int>(static_cast<qint64>(context->count)*(chunk+1)/context->chunks);
+		(*context->body)(chunk, chunkBegin, chunkEnd);
+		if(context->remainingChunks.fetchAndAddOrdered(-1) == 1){
+			//the caller checks remainingChunks with the mutex held before it sleeps, so this wake up can not get lost
+			context->mutex.lock();
+			context->finished.wakeAll();
+			context->mutex.unlock();
+		}
+	}
+}
+
+TaskPool::ParallelForContext* TaskPool::acquireContext() {
+	QMutexLocker locker(&this->contextMutex);
+	if(this->freeContexts.isEmpty()){
+		ParallelForContext* context = new ParallelForContext();
+		this->contexts.append(context);
+		return context;
+	}
+	ParallelForContext* context = this->freeContexts.last();
+	this->freeContexts.removeLast();
+	return context;
+}
+
+void TaskPool::releaseContext(ParallelForContext* context) {
+	//the capacity of freeContexts is only exceeded when a new context was created, so appending does not allocate in steady state
+	if(!context->references.deref()){
+		QMutexLocker locker(&this->contextMutex);
+		this->freeContexts.append(context);
+	}
+}
+
+void TaskPool::setThreadSettings(quint64 coreMask, int niceLevel) {
+	this->sleepMutex.lock();
+	this->threadCoreMask.storeRelease(coreMask);
+	this->threadNiceLevel.storeRelease(niceLevel);
+	this->threadSettingsVersion.ref();
+	this->wakeUp.wakeAll();
+	this->sleepMutex.unlock();
+}
+
+void TaskPool::applyThreadSettings(int* appliedVersion) {
+	int version = this->threadSettingsVersion.loadAcquire();
+	if(version == *appliedVersion){
+		return;
+	}
+	*appliedVersion = version;
+	quint64 coreMask = this->threadCoreMask.loadAcquire();
+	bool applied = setCurrentThreadNiceLevel(this->threadNiceLevel.loadAcquire());
+	if(coreMask != 0){
+		applied = setCurrentThreadAffinity(coreMask) && applied;
+	}
+	if(!applied){
+		this->threadSettingsFailures.ref();
+	}
+}
+
+void TaskPool::workerLoop(int index) {
+	currentPool = this;
+	currentWorkerIndex = index;
+	int appliedSettingsVersion = 0;
+	forever{
+		this->applyThreadSettings(&appliedSettingsVersion);
+		if(this->tryRunTask(index)){
+			continue;
+		}
+		QMutexLocker locker(&this->sleepMutex);
+		if(this->pendingTasks.loadAcquire() > 0){
+			continue;
+		}
+		if(this->stopping){
+			break;
+		}
+		if(this->threadSettingsVersion.loadAcquire() != appliedSettingsVersion){
+			continue;
+		}
+		this->wakeUp.wait(&this->sleepMutex);
+	}
+	currentPool = nullptr;
+	currentWorkerIndex = -1;
+}
+
+bool TaskPool::tryRunTask(int ownQueue) {
+	//the newest task of the own queue is taken first (its data is probably still in the cache), then the oldest task of the other queues
+	Task task;
+	bool found = ownQueue >= 0 && this->takeTask(ownQueue, true, &task);
+	int numberOfQueues = this->queues.size();
+	int start = ownQueue >= 0 ? ownQueue+1 : 0;
+	for(int i = 0; !found && i < numberOfQueues; i++){
+		int queueIndex = (start+i)%numberOfQueues;
+		if(queueIndex != ownQueue){
+			found = this->takeTask(queueIndex, false, &task);
+		}
+	}
+	if(!found){
+		return false;
+	}
+	this->pendingTasks.deref();
+	task();
+	return true;
+}
+
+bool TaskPool::takeTask(int queueIndex, bool newest, Task* task) {
+	WorkQueue* queue = this->queues.at(queueIndex);
+	QMutexLocker locker(&queue->mutex);
+	if(queue->count == 0){
+		return false;
+	}
+	int capacity = queue->tasks.size();
+	int index = newest ? (queue->head + queue->count - 1) % capacity : queue->head;
+	*task = std::move(queue->tasks[index]);
+	queue->tasks[index] = nullptr;
+	if(!newest){
+		queue->head = (queue->head + 1) % capacity;
+	}
+	queue->count--;
+	return true;
+}
+
+int TaskPool::getCurrentWorkerIndex() const {
+	return currentPool == this ? currentWorkerIndex : -1;
+}
@@ -0,0 +1,112 @@
+#ifndef TASKPOOL_H
+#define TASKPOOL_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QVector>
+#include <QAtomicInteger>
+#include <functional>
+
+#define TASKPOOL_CHUNKS_PER_THREAD 4
+#define TASKPOOL_INITIAL_QUEUE_CAPACITY 64 //tasks per worker queue, a full queue doubles its capacity
+#define TASKPOOL_PARALLELFOR_SPINS 16 //yields of a parallelFor() caller before it sleeps until the last chunk is done
+
+class TaskPool;
+
+class TaskPoolWorker : public QThread
+{
+public:
+	TaskPoolWorker(TaskPool* pool, int index);
+
+protected:
+	void run() override;
+
+private:
+	TaskPool* pool;
+	int index;
+};
+
+//shared pool of worker threads for all stages of the signal chain. every worker owns a task queue, idle workers steal
+//tasks from the other queues. parallelFor() splits a range into chunks and the calling thread helps to process them,
+//so it can also be called from a task that is already running in the pool. the caller only processes chunks of its own
+//parallelFor(), never unrelated tasks, and sleeps while the last chunks are processed by other workers.
+//the worker threads only exist between start() and stop(), tasks that are submitted while the pool is stopped wait for the next start().
+//in steady state submit() and parallelFor() do not allocate: the queues are rings that only grow if they are full, the
+//contexts of parallelFor() are reused and its tasks are small enough for the internal buffer of std::function
+class TaskPool
+{
+public:
+	typedef std::function<void()> Task;
+
+	explicit TaskPool(int numberOfThreads = 0);
+	~TaskPool();
+
+	void start();
+	void stop();
+	bool isRunning() const {return !this->workers.isEmpty();}
+	void submit(Task task);
+	template <typename Body> void parallelFor(int begin, int end, int minimumRangePerTask, const Body& body) {
+		//the body is only referenced, so it is never copied into a std::function that allocates for large lambda captures
+		this->runParallelFor(begin, end, minimumRangePerTask, std::cref(body));
+	}
+	int getNumberOfChunks(int begin, int end, int minimumRangePerTask) const;
+	int getThreadCount() const {return this->numberOfThreads;}
+
+	//core affinity and nice level of the workers. every worker applies new settings to itself before it runs the next task
+	void setThreadSettings(quint64 coreMask, int niceLevel);
+	int getThreadSettingsFailures() const {return this->threadSettingsFailures.loadAcquire();}
+
+private:
+	friend class TaskPoolWorker;
+
+	struct WorkQueue {
+		QMutex mutex;
+		QVector<Task> tasks; //ring
+		int head;
+		int count;
+		WorkQueue() : tasks(TASKPOOL_INITIAL_QUEUE_CAPACITY), head(0), count(0) {}
+	};
+
+	//chunks are claimed with nextChunk by the caller and by helper tasks. a helper task that runs after all chunks were claimed
+	//does nothing, the context is reference counted because such a task may still be queued when parallelFor() returns
+	struct ParallelForContext {
+		const std::function<void(int, int, int)>* body;
+		QAtomicInteger<int> nextChunk;
+		QAtomicInteger<int> remainingChunks;
+		QAtomicInteger<int> references;
+		int begin;
+		int count;
+		int chunks;
+		QMutex mutex;
+		QWaitCondition finished;
+	};
+
+	int numberOfThreads;
+	QVector<WorkQueue*> queues;
+	QVector<TaskPoolWorker*> workers;
+	QMutex sleepMutex;
+	QWaitCondition wakeUp;
+	QAtomicInteger<int> pendingTasks;
+	QAtomicInteger<int> nextQueue;
+	bool stopping;
+	QAtomicInteger<quint64> threadCoreMask;
+	QAtomicInteger<int> threadNiceLevel;
+	QAtomicInteger<int> threadSettingsVersion;
+	QAtomicInteger<int> threadSettingsFailures;
+	QMutex contextMutex;
+	QVector<ParallelForContext*> contexts;
+	QVector<ParallelForContext*> freeContexts;
+
+	void runParallelFor(int begin, int end, int minimumRangePerTask, const std::function<void(int chunk, int begin, int end)>& body);
+	void runChunks(ParallelForContext* context);
+	ParallelForContext* acquireContext();
+	void releaseContext(ParallelForContext* context);
+	void workerLoop(int index);
+	void applyThreadSettings(int* appliedVersion);
+	bool tryRunTask(int ownQueue);
+	bool takeTask(int queueIndex, bool newest, Task* task);
+	int getCurrentWorkerIndex() const;
+};
+
+#endif //TASKPOOL_H
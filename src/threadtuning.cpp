@@ -0,0 +1,122 @@
+#include "threadtuning.h"
+#include <QStringList>
+#include <QThread>
+
+#if defined(Q_OS_LINUX)
+#include <sched.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <sys/resource.h>
+#elif defined(Q_OS_WIN)
+#include <windows.h>
+#endif
+
+
+int currentCpuCore() {
+#if defined(Q_OS_LINUX)
+	return sched_getcpu();
+#elif defined(Q_OS_WIN)
+	return static_cast<int>(GetCurrentProcessorNumber());
+#else
+	return -1;
+#endif
+}
+
+int numberOfCpuCores() {
+	return qBound(1, QThread::idealThreadCount(), THREADTUNING_MAX_CORES);
+}
+
+quint64 allCoresMask() {
+	int cores = numberOfCpuCores();
+	return cores >= THREADTUNING_MAX_CORES ? ~Q_UINT64_C(0) : (Q_UINT64_C(1) << cores) - 1;
+}
+
+bool setCurrentThreadAffinity(quint64 coreMask) {
+	coreMask &= allCoresMask();
+	if(coreMask == 0){
+		return false;
+	}
+#if defined(Q_OS_LINUX)
+	cpu_set_t cpuSet;
+	CPU_ZERO(&cpuSet);
+	for(int core = 0; core < THREADTUNING_MAX_CORES; core++){
+		if(coreMask & (Q_UINT64_C(1) << core)){
+			CPU_SET(core, &cpuSet);
+		}
+	}
+	return sched_setaffinity(0, sizeof(cpuSet), &cpuSet) == 0;
+#elif defined(Q_OS_WIN)
+	return SetThreadAffinityMask(GetCurrentThread(), static_cast<DWORD_PTR>(coreMask)) != 0;
+#else
+	return false;
+#endif
+}
+
+bool setCurrentThreadNiceLevel(int niceLevel) {
+	niceLevel = qBound(0, niceLevel, 19);
+#if defined(Q_OS_LINUX)
+	//on linux the nice level of a single thread is set through its thread id. lowering it again needs CAP_SYS_NICE
+	pid_t threadId = static_cast<pid_t>(syscall(SYS_gettid));
+	return setpriority(PRIO_PROCESS, static_cast<id_t>(threadId), niceLevel) == 0;
+#elif defined(Q_OS_WIN)
+	int priority = THREAD_PRIORITY_NORMAL;
+	if(niceLevel >= 15){
+		priority = THREAD_PRIORITY_LOWEST;
+	}else if(niceLevel >= 5){
+		priority = THREAD_PRIORITY_BELOW_NORMAL;
+	}
+	return SetThreadPriority(GetCurrentThread(), priority) != 0;
+#else
+	return false;
+#endif
+}
+
+quint64 parseCoreList(QString coreList, bool* ok) {
+	quint64 coreMask = 0;
+	bool valid = true;
+#if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0)
+	QStringList parts = coreList.split(',', Qt::SkipEmptyParts);
+#else
+	QStringList parts = coreList.split(',', QString::SkipEmptyParts);
+#endif
+	for(QString part : parts){
+		part = part.trimmed();
+		QStringList range = part.split('-');
+		bool firstOk = false;
+		bool lastOk = false;
+		int first = range.at(0).trimmed().toInt(&firstOk);
+		int last = range.size() == 2 ? range.at(1).trimmed().toInt(&lastOk) : first;
+		if(range.size() == 1){
+			lastOk = firstOk;
+		}
+		if(!firstOk || !lastOk || range.size() > 2 || first < 0 || last < first || last >= THREADTUNING_MAX_CORES){
+			valid = false;
+			continue;
+		}
+		for(int core = first; core <= last; core++){
+			coreMask |= Q_UINT64_C(1) << core;
+		}
+	}
+	if(ok != nullptr){
+		*ok = valid;
+	}
+	return coreMask;
+}
+
+QString coreMaskToString(quint64 coreMask) {
+	QStringList ranges;
+	int core = 0;
+	while(core < THREADTUNING_MAX_CORES){
+		if(!(coreMask & (Q_UINT64_C(1) << core))){
+			core++;
+			continue;
+		}
+		int first = core;
+		while(core+1 < THREADTUNING_MAX_CORES && (coreMask & (Q_UINT64_C(1) << (core+1)))){
+			core++;
+		}
+		ranges.append(first == core ? QString::number(first) : QString::number(first) + "-" + QString::number(core));
+		core++;
+	}
+	return ranges.join(",");
+}
@@ -0,0 +1,22 @@
+#ifndef THREADTUNING_H
+#define THREADTUNING_H
+
+#include <QtGlobal>
+#include <QString>
+
+#define THREADTUNING_MAX_CORES 64
+#define THREADTUNING_DEFAULT_NICE_LEVEL 10
+
+//platform specific helpers to keep the monitor's worker threads away from the acquisition thread of OCTproZ.
+//core masks have one bit per logical core, bit 0 is core 0. all functions act on the calling thread.
+int currentCpuCore();
+int numberOfCpuCores();
+quint64 allCoresMask();
+bool setCurrentThreadAffinity(quint64 coreMask);
+bool setCurrentThreadNiceLevel(int niceLevel);
+
+//core lists are written like "0-3,6". an empty list means automatic selection
+quint64 parseCoreList(QString coreList, bool* ok);
+QString coreMaskToString(quint64 coreMask);
+
+#endif //THREADTUNING_H
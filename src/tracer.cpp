@@ -0,0 +1,169 @@
+#include "tracer.h"
+#include "latencymonitor.h"
+#include <QMutex>
+#include <QMutexLocker>
+#include <QVector>
+#include <QThread>
+#include <QCoreApplication>
+#include <QFile>
+#include <QTextStream>
+
+namespace {
+	struct ThreadTraceBuffer {
+		int threadId;
+		QString threadName;
+		QAtomicInteger<int> inUse;
+		QAtomicInteger<quint64> writeIndex;
+		TraceEvent events[TRACER_EVENTS_PER_THREAD];
+	};
+
+	//gives the buffer of a thread back to the registry when the thread exits
+	struct ThreadTraceBufferOwner {
+		ThreadTraceBuffer* buffer = nullptr;
+		~ThreadTraceBufferOwner() {
+			if(this->buffer != nullptr){
+				this->buffer->inUse.storeRelease(0);
+			}
+		}
+	};
+
+	QMutex registryMutex;
+	QVector<ThreadTraceBuffer*> registry;
+	int lastThreadId = 0;
+	thread_local ThreadTraceBufferOwner threadBuffer;
+
+	ThreadTraceBuffer* getThreadBuffer() {
+		//the buffer of a thread is assigned the first time the thread records an event. the registry is only locked at this point.
+		//buffers of threads that have exited are reused, so restarting the worker threads does not grow the memory of the tracer.
+		//the events of the exited thread are discarded when its buffer is reused
+		if(threadBuffer.buffer == nullptr){
+			QThread* thread = QThread::currentThread();
+			QString threadName = thread->objectName();
+			if(QCoreApplication::instance() != nullptr && thread == QCoreApplication::instance()->thread()){
+				threadName = QString("GUI");
+			}
+			QMutexLocker locker(&registryMutex);
+			ThreadTraceBuffer* buffer = nullptr;
+			for(ThreadTraceBuffer* unusedBuffer : registry){
+				if(unusedBuffer->inUse.testAndSetOrdered(0, 1)){
+					buffer = unusedBuffer;
+					break;
+				}
+			}
+			if(buffer == nullptr){
+				buffer = new ThreadTraceBuffer();
+				buffer->inUse.storeRelease(1);
+				registry.append(buffer);
+			}
+			buffer->writeIndex.storeRelease(0);
+			lastThreadId++;
+			buffer->threadId = lastThreadId;
+			buffer->threadName = threadName.isEmpty() ? QString("Thread %1").arg(buffer->threadId) : threadName;
+			threadBuffer.buffer = buffer;
+		}
+		return threadBuffer.buffer;
+	}
+
+	QString escapeJson(QString text) {
+		return text.replace("\\", "\\\\").replace("\"", "\\\"");
+	}
+}
+
+QAtomicInteger<int> Tracer::enabled(0);
+
+
+void Tracer::setEnabled(bool enabled) {
+	Tracer::enabled.storeRelease(enabled ? 1 : 0);
+}
+
+bool Tracer::isEnabled() {
+	return Tracer::enabled.loadAcquire() != 0;
+}
+
+void Tracer::recordComplete(const char* name, qint64 startTimestamp, qint64 endTimestamp) {
+	TraceEvent event = {name, startTimestamp, endTimestamp - startTimestamp, 0, 'X'};
+	record(event);
+}
+
+void Tracer::recordFlow(const char* name, quint64 id, char phase) {
+	if(!isEnabled()){
+		return;
+	}
+	TraceEvent event = {name, LatencyMonitor::now(), 0, id, phase};
+	record(event);
+}
+
+void Tracer::record(const TraceEvent& event) {
+	//single producer per buffer: the slot is written first and published by incrementing the write index
+	ThreadTraceBuffer* buffer = getThreadBuffer();
+	quint64 index = buffer->writeIndex.loadAcquire();
+	buffer->events[index & (TRACER_EVENTS_PER_THREAD-1)] = event;
+	buffer->writeIndex.storeRelease(index+1);
+}
+
+bool Tracer::saveToFile(QString fileName, qint64 lastNanoseconds) {
+	qint64 endTimestamp = LatencyMonitor::now();
+	qint64 startTimestamp = endTimestamp - lastNanoseconds;
+
+	QFile file(fileName);
+	if(!file.open(QFile::WriteOnly|QFile::Truncate)){
+		return false;
+	}
+	QTextStream stream(&file);
+	stream << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+
+	QMutexLocker locker(&registryMutex);
+	bool firstEvent = true;
+	for(ThreadTraceBuffer* buffer : registry){
+		stream << (firstEvent ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->threadId
+			<< ",\"args\":{\"name\":\"" << escapeJson(buffer->threadName) << "\"}}";
+		firstEvent = false;
+
+		//copy the events of this thread. events that were overwritten by the writer during the copy are discarded afterwards,
+		//including the slot of the event the writer may be writing right now (it is only published with the next write index)
+		quint64 writeIndex = buffer->writeIndex.loadAcquire();
+		quint64 readIndex = writeIndex > TRACER_EVENTS_PER_THREAD ? writeIndex - TRACER_EVENTS_PER_THREAD : 0;
+		QVector<TraceEvent> events;
+		events.reserve(static_cast<int>(writeIndex - readIndex));
+		for(quint64 i = readIndex; i < writeIndex; i++){
+			events.append(buffer->events[i & (TRACER_EVENTS_PER_THREAD-1)]);
+		}
+		quint64 newWriteIndex = buffer->writeIndex.loadAcquire();
+		int overwritten = newWriteIndex + 1 > readIndex + TRACER_EVENTS_PER_THREAD ? static_cast<int>(qMin(static_cast<quint64>(events.size()), newWriteIndex + 1 - readIndex - TRACER_EVENTS_PER_THREAD)) : 0;
+
+		for(int i = overwritten; i < events.size(); i++){
+			const TraceEvent& event = events.at(i);
+			if(event.timestamp < startTimestamp){
+				continue;
+			}
+			stream << ",\n{\"name\":\"" << event.name << "\",\"cat\":\"signalmonitor\",\"ph\":\"" << event.phase
+				<< "\",\"pid\":1,\"tid\":" << buffer->threadId
+				<< ",\"ts\":" << QString::number((event.timestamp - startTimestamp)/1000.0, 'f', 3);
+			if(event.phase == 'X'){
+				stream << ",\"dur\":" << QString::number(event.duration/1000.0, 'f', 3);
+			}else{
+				stream << ",\"id\":" << event.id;
+				if(event.phase == 'f'){
+					stream << ",\"bp\":\"e\"";
+				}
+			}
+			stream << "}";
+		}
+	}
+	stream << "\n]}\n";
+	file.close();
+	return true;
+}
+
+
+TraceScope::TraceScope(const char* name)
+	: name(name),
+	startTimestamp(Tracer::isEnabled() ? LatencyMonitor::now() : 0)
+{
+}
+
+TraceScope::~TraceScope() {
+	if(this->startTimestamp != 0){
+		Tracer::recordComplete(this->name, this->startTimestamp, LatencyMonitor::now());
+	}
+}
@@ -0,0 +1,54 @@
+#ifndef TRACER_H
+#define TRACER_H
+
+#include <QtGlobal>
+#include <QString>
+#include <QAtomicInteger>
+
+#define TRACER_EVENTS_PER_THREAD 65536 //must be a power of two
+#define TRACER_CONCAT_IMPL(a, b) a##b
+#define TRACER_CONCAT(a, b) TRACER_CONCAT_IMPL(a, b)
+
+//records the duration of the enclosing scope. name must be a string literal
+#define TRACE_SCOPE(name) TraceScope TRACER_CONCAT(traceScope, __LINE__)(name)
+//marks the start and the end of a hand over between threads, e.g. a queued signal. id must be the same for both ends
+#define TRACE_FLOW_BEGIN(name, id) Tracer::recordFlow(name, id, 's')
+#define TRACE_FLOW_END(name, id) Tracer::recordFlow(name, id, 'f')
+
+struct TraceEvent {
+	const char* name;
+	qint64 timestamp;
+	qint64 duration;
+	quint64 id;
+	char phase;
+};
+
+//process wide tracer with one lock free ring buffer per thread. every thread only writes into its own buffer,
+//so recording an event is a few stores and one atomic increment. saveToFile() writes the recorded events as
+//Chrome trace event JSON that can be opened with chrome://tracing or ui.perfetto.dev
+class Tracer
+{
+public:
+	static void setEnabled(bool enabled);
+	static bool isEnabled();
+	static void recordComplete(const char* name, qint64 startTimestamp, qint64 endTimestamp);
+	static void recordFlow(const char* name, quint64 id, char phase);
+	static bool saveToFile(QString fileName, qint64 lastNanoseconds);
+
+private:
+	static QAtomicInteger<int> enabled;
+	static void record(const TraceEvent& event);
+};
+
+class TraceScope
+{
+public:
+	explicit TraceScope(const char* name);
+	~TraceScope();
+
+private:
+	const char* name;
+	qint64 startTimestamp;
+};
+
+#endif //TRACER_H
@@ -0,0 +1,89 @@
+#ifndef TRIPLEBUFFER_H
+#define TRIPLEBUFFER_H
+
+#include <QtGlobal>
+#include <QAtomicInteger>
+#include "boundedqueue.h"
+
+#define TRIPLEBUFFER_INDEX_MASK 3
+#define TRIPLEBUFFER_NEW_ITEM 4
+
+//latest item wins mailbox. the producer always overwrites the pending item and the consumer always takes the newest one,
+//so the consumer is at most one item behind the producer. writer and reader each own one of three slots, the third slot
+//holds the pending item and is exchanged with a single atomic operation. read() must only be called by one consumer at a time.
+template <typename T>
+class TripleBuffer
+{
+public:
+	TripleBuffer()
+		: backIndex(0),
+		frontIndex(1),
+		pending(2),
+		writing(0),
+		enqueued(0),
+		dequeued(0),
+		dropped(0)
+	{
+	}
+
+	//returns false if item itself was dropped because another producer was writing at the same time.
+	//if a pending item was overwritten, it is stored in droppedItem and hasDropped is set
+	bool write(const T& item, T* droppedItem, bool* hasDropped) {
+		*hasDropped = false;
+		if(!this->writing.testAndSetAcquire(0, 1)){
+			this->dropped.fetchAndAddRelaxed(1);
+			return false;
+		}
+		this->slots[this->backIndex] = item;
+		int previous = this->pending.fetchAndStoreOrdered(this->backIndex | TRIPLEBUFFER_NEW_ITEM);
+		this->backIndex = previous & TRIPLEBUFFER_INDEX_MASK;
+		if(previous & TRIPLEBUFFER_NEW_ITEM){
+			//the previous item was never read, its slot is now owned by the producer again
+			*droppedItem = this->slots[this->backIndex];
+			*hasDropped = true;
+			this->dropped.fetchAndAddRelaxed(1);
+		}
+		this->enqueued.fetchAndAddRelaxed(1);
+		this->writing.storeRelease(0);
+		return true;
+	}
+
+	bool read(T* item) {
+		if(!(this->pending.loadAcquire() & TRIPLEBUFFER_NEW_ITEM)){
+			return false;
+		}
+		int previous = this->pending.fetchAndStoreOrdered(this->frontIndex);
+		this->frontIndex = previous & TRIPLEBUFFER_INDEX_MASK;
+		*item = this->slots[this->frontIndex];
+		this->dequeued.fetchAndAddRelaxed(1);
+		return true;
+	}
+
+	bool hasNewItem() const {
+		return (this->pending.loadAcquire() & TRIPLEBUFFER_NEW_ITEM) != 0;
+	}
+
+	//same counters as a BoundedQueue with capacity 1 and OVERFLOW_DROP_OLDEST
+	QueueCounters getCounters() const {
+		QueueCounters counters;
+		counters.enqueued = this->enqueued.loadAcquire();
+		counters.dequeued = this->dequeued.loadAcquire();
+		counters.dropped = this->dropped.loadAcquire();
+		counters.depth = this->hasNewItem() ? 1 : 0;
+		counters.maximumDepth = counters.enqueued > 0 ? 1 : 0;
+		counters.capacity = 1;
+		return counters;
+	}
+
+private:
+	T slots[3];
+	int backIndex; //only used by the producer
+	int frontIndex; //only used by the consumer
+	QAtomicInteger<int> pending; //index of the pending slot, TRIPLEBUFFER_NEW_ITEM is set if it was not read yet
+	QAtomicInteger<int> writing;
+	QAtomicInteger<quint64> enqueued;
+	QAtomicInteger<quint64> dequeued;
+	QAtomicInteger<quint64> dropped;
+};
+
+#endif //TRIPLEBUFFER_H
@@ -0,0 +1,63 @@
+#ifndef UINT128_H
+#define UINT128_H
+
+#include <QtGlobal>
+
+//unsigned 128 bit integer with the few operations the exact integer accumulation of ImageMetricCalculator needs.
+//it is built from two 64 bit halves, so it works with every compiler (msvc has no native 128 bit type). all operations are modulo 2^128
+struct UInt128 {
+	quint64 high;
+	quint64 low;
+
+	static UInt128 fromUInt64(quint64 value) {
+		UInt128 result = {0, value};
+		return result;
+	}
+
+	//full 128 bit product of two 64 bit values
+	static UInt128 multiply(quint64 a, quint64 b) {
+		quint64 aLow = a & 0xFFFFFFFFu;
+		quint64 aHigh = a >> 32;
+		quint64 bLow = b & 0xFFFFFFFFu;
+		quint64 bHigh = b >> 32;
+		quint64 lowLow = aLow*bLow;
+		quint64 lowHigh = aLow*bHigh;
+		quint64 highLow = aHigh*bLow;
+		quint64 highHigh = aHigh*bHigh;
+		quint64 middle = (lowLow >> 32) + (lowHigh & 0xFFFFFFFFu) + (highLow & 0xFFFFFFFFu);
+		UInt128 result;
+		result.low = (middle << 32) | (lowLow & 0xFFFFFFFFu);
+		result.high = highHigh + (lowHigh >> 32) + (highLow >> 32) + (middle >> 32);
+		return result;
+	}
+
+	void add(quint64 value) {
+		this->low += value;
+		this->high += this->low < value ? 1 : 0;
+	}
+
+	void add(const UInt128& value) {
+		this->low += value.low;
+		this->high += value.high + (this->low < value.low ? 1 : 0);
+	}
+
+	UInt128 multipliedBy(quint64 factor) const {
+		UInt128 result = multiply(this->low, factor);
+		result.high += this->high*factor;
+		return result;
+	}
+
+	UInt128 minus(const UInt128& value) const {
+		UInt128 result;
+		result.low = this->low - value.low;
+		result.high = this->high - value.high - (this->low < value.low ? 1 : 0);
+		return result;
+	}
+
+	//rounds to about one ulp, the accumulation itself is exact
+	double toDouble() const {
+		return static_cast<double>(this->high)*18446744073709551616.0 + static_cast<double>(this->low);
+	}
+};
+
+#endif //UINT128_H
@@ -0,0 +1,89 @@
+#include "acquisitionsimulator.h"
+
+
+AcquisitionSimulator::AcquisitionSimulator(Extension* extension, SyntheticFrames* frames, SyntheticFrames* alternativeFrames, const AcquisitionSettings& settings)
+	: QThread(),
+	extension(extension),
+	frames(frames),
+	alternativeFrames(alternativeFrames),
+	settings(settings),
+	stopRequested(0),
+	deliveredBuffers(0),
+	lateBuffers(0),
+	missedBuffers(0),
+	dimensionChanges(0)
+{
+	this->setObjectName("Host simulator acquisition");
+}
+
+AcquisitionCounters AcquisitionSimulator::getCounters() const {
+	AcquisitionCounters counters;
+	counters.deliveredBuffers = this->deliveredBuffers.loadAcquire();
+	counters.lateBuffers = this->lateBuffers.loadAcquire();
+	counters.missedBuffers = this->missedBuffers.loadAcquire();
+	counters.dimensionChanges = this->dimensionChanges.loadAcquire();
+	return counters;
+}
+
+void AcquisitionSimulator::run() {
+	qint64 period = static_cast<qint64>(1000000000.0/qMax(0.001, this->settings.buffersPerSecond));
+	qint64 dimensionChangeInterval = static_cast<qint64>(this->settings.dimensionChangeInterval*1000000000.0);
+	qint64 startTimestamp = LatencyMonitor::now();
+	qint64 nextBufferTimestamp = startTimestamp;
+	quint64 bufferCounter = 0;
+	bool alternative = false;
+
+	while(!this->stopRequested.loadAcquire()){
+		this->waitUntil(nextBufferTimestamp);
+
+		//dimension changes alternate between the two prepared formats
+		if(dimensionChangeInterval > 0 && this->alternativeFrames != nullptr){
+			bool useAlternative = ((nextBufferTimestamp - startTimestamp)/dimensionChangeInterval) % 2 == 1;
+			if(useAlternative != alternative){
+				alternative = useAlternative;
+				this->dimensionChanges.fetchAndAddRelaxed(1);
+			}
+		}
+		SyntheticFrames* source = alternative ? this->alternativeFrames : this->frames;
+		const SyntheticFormat& format = source->getFormat();
+		void* buffer = source->getBuffer(bufferCounter);
+		unsigned int bufferNr = static_cast<unsigned int>(bufferCounter%format.buffersPerVolume);
+
+		qint64 callStart = LatencyMonitor::now();
+		if(callStart - nextBufferTimestamp > period){
+			this->lateBuffers.fetchAndAddRelaxed(1);
+		}
+		if(this->settings.outputs & OUTPUT_RAW){
+			this->extension->rawDataReceived(buffer, format.bitDepth, format.samplesPerLine, format.linesPerFrame, format.framesPerBuffer, format.buffersPerVolume, bufferNr);
+			qint64 callEnd = LatencyMonitor::now();
+			this->rawCallHistogram.record(callEnd - callStart);
+			callStart = callEnd;
+		}
+		if(this->settings.outputs & OUTPUT_PROCESSED){
+			this->extension->processedDataReceived(buffer, format.bitDepth, format.samplesPerLine, format.linesPerFrame, format.framesPerBuffer, format.buffersPerVolume, bufferNr);
+			this->processedCallHistogram.record(LatencyMonitor::now() - callStart);
+		}
+		this->deliveredBuffers.fetchAndAddRelaxed(1);
+		bufferCounter++;
+
+		//a real acquisition does not wait for the host, buffers whose time has already passed are lost
+		nextBufferTimestamp += period;
+		qint64 behind = LatencyMonitor::now() - nextBufferTimestamp;
+		if(behind > period){
+			qint64 missed = behind/period;
+			this->missedBuffers.fetchAndAddRelaxed(static_cast<quint64>(missed));
+			nextBufferTimestamp += missed*period;
+			bufferCounter += static_cast<quint64>(missed);
+		}
+	}
+}
+
+void AcquisitionSimulator::waitUntil(qint64 timestamp) {
+	qint64 remaining = timestamp - LatencyMonitor::now();
+	while(remaining > 0 && !this->stopRequested.loadAcquire()){
+		if(remaining > ACQUISITIONSIMULATOR_SPIN_NANOSECONDS){
+			QThread::usleep(static_cast<unsigned long>((remaining - ACQUISITIONSIMULATOR_SPIN_NANOSECONDS)/1000));
+		}
+		remaining = timestamp - LatencyMonitor::now();
+	}
+}
@@ -0,0 +1,61 @@
+#ifndef ACQUISITIONSIMULATOR_H
+#define ACQUISITIONSIMULATOR_H
+
+#include <QThread>
+#include <QAtomicInteger>
+#include "octproz_devkit.h"
+#include "latencymonitor.h"
+#include "syntheticframes.h"
+
+#define ACQUISITIONSIMULATOR_SPIN_NANOSECONDS 200000 //the last part of a wait is spent spinning to hit the buffer time precisely
+
+enum SIMULATED_OUTPUT {
+	OUTPUT_RAW = 0x1,
+	OUTPUT_PROCESSED = 0x2
+};
+
+struct AcquisitionSettings {
+	double buffersPerSecond;
+	int outputs; //SIMULATED_OUTPUT flags
+	double dimensionChangeInterval; //seconds between switching to the alternative format, 0: never
+};
+
+struct AcquisitionCounters {
+	quint64 deliveredBuffers;
+	quint64 lateBuffers; //delivered later than one buffer period after their time
+	quint64 missedBuffers; //not delivered at all because the thread was still busy with earlier buffers
+	quint64 dimensionChanges;
+};
+
+//simulated acquisition thread of OCTproZ. delivers the synthetic buffers at a fixed rate to the extension and measures
+//how long the extension blocks the thread in rawDataReceived() and processedDataReceived()
+class AcquisitionSimulator : public QThread
+{
+public:
+	AcquisitionSimulator(Extension* extension, SyntheticFrames* frames, SyntheticFrames* alternativeFrames, const AcquisitionSettings& settings);
+
+	void stop() {this->stopRequested.storeRelease(1);}
+	AcquisitionCounters getCounters() const;
+	const LatencyHistogram& getRawCallHistogram() const {return this->rawCallHistogram;}
+	const LatencyHistogram& getProcessedCallHistogram() const {return this->processedCallHistogram;}
+
+protected:
+	void run() override;
+
+private:
+	Extension* extension;
+	SyntheticFrames* frames;
+	SyntheticFrames* alternativeFrames;
+	AcquisitionSettings settings;
+	QAtomicInteger<int> stopRequested;
+	QAtomicInteger<quint64> deliveredBuffers;
+	QAtomicInteger<quint64> lateBuffers;
+	QAtomicInteger<quint64> missedBuffers;
+	QAtomicInteger<quint64> dimensionChanges;
+	LatencyHistogram rawCallHistogram;
+	LatencyHistogram processedCallHistogram;
+
+	void waitUntil(qint64 timestamp);
+};
+
+#endif //ACQUISITIONSIMULATOR_H
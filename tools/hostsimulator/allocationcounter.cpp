@@ -0,0 +1,175 @@
+#include "allocationcounter.h"
+#include <QAtomicInteger>
+#include <QFile>
+
+#if defined(Q_OS_LINUX) && defined(__GLIBC__)
+#define ALLOCATIONCOUNTER_AVAILABLE
+#include <stdlib.h>
+#include <malloc.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* pointer, size_t size);
+void* __libc_memalign(size_t alignment, size_t size);
+void __libc_free(void* pointer);
+}
+
+struct ThreadSlot {
+	QAtomicInteger<qint64> threadId;
+	QAtomicInteger<quint64> allocations;
+	QAtomicInteger<quint64> bytes;
+};
+
+//the last slot is shared by all threads that do not fit into the table
+static ThreadSlot threadSlots[ALLOCATIONCOUNTER_MAXIMUM_THREADS+1];
+static QAtomicInteger<int> usedThreadSlots(0);
+static QAtomicInteger<int> counting(0);
+static thread_local int threadSlot = -1;
+
+static void countAllocation(size_t size) {
+	if(!counting.loadAcquire()){
+		return;
+	}
+	if(threadSlot < 0){
+		int slot = usedThreadSlots.fetchAndAddOrdered(1);
+		if(slot < ALLOCATIONCOUNTER_MAXIMUM_THREADS){
+			threadSlots[slot].threadId.storeRelease(static_cast<qint64>(syscall(SYS_gettid)));
+		}else{
+			slot = ALLOCATIONCOUNTER_MAXIMUM_THREADS;
+		}
+		threadSlot = slot;
+	}
+	threadSlots[threadSlot].allocations.fetchAndAddRelaxed(1);
+	threadSlots[threadSlot].bytes.fetchAndAddRelaxed(size);
+}
+
+static void* countedMemalign(size_t alignment, size_t size) {
+	countAllocation(size);
+	return __libc_memalign(alignment, size);
+}
+
+//the replacements are found by the dynamic linker before the functions of glibc, also for the extension and Qt
+extern "C" {
+
+void* malloc(size_t size) __THROW {
+	countAllocation(size);
+	return __libc_malloc(size);
+}
+
+void* calloc(size_t count, size_t size) __THROW {
+	countAllocation(count*size);
+	return __libc_calloc(count, size);
+}
+
+void* realloc(void* pointer, size_t size) __THROW {
+	countAllocation(size);
+	return __libc_realloc(pointer, size);
+}
+
+void free(void* pointer) __THROW {
+	__libc_free(pointer);
+}
+
+void* memalign(size_t alignment, size_t size) __THROW {
+	return countedMemalign(alignment, size);
+}
+
+void* aligned_alloc(size_t alignment, size_t size) __THROW {
+	return countedMemalign(alignment, size);
+}
+
+int posix_memalign(void** pointer, size_t alignment, size_t size) __THROW {
+	if(alignment % sizeof(void*) != 0 || (alignment & (alignment-1)) != 0){
+		return EINVAL;
+	}
+	void* memory = countedMemalign(alignment, size);
+	if(memory == nullptr && size != 0){
+		return ENOMEM;
+	}
+	*pointer = memory;
+	return 0;
+}
+
+void* valloc(size_t size) __THROW {
+	return countedMemalign(static_cast<size_t>(sysconf(_SC_PAGESIZE)), size);
+}
+
+void* pvalloc(size_t size) __THROW {
+	size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+	return countedMemalign(pageSize, (size + pageSize-1) & ~(pageSize-1));
+}
+
+}
+#endif
+
+
+bool AllocationCounter::isAvailable() {
+#ifdef ALLOCATIONCOUNTER_AVAILABLE
+	return true;
+#else
+	return false;
+#endif
+}
+
+void AllocationCounter::start() {
+#ifdef ALLOCATIONCOUNTER_AVAILABLE
+	for(ThreadSlot& slot : threadSlots){
+		slot.allocations.storeRelease(0);
+		slot.bytes.storeRelease(0);
+	}
+	counting.storeRelease(1);
+#endif
+}
+
+void AllocationCounter::stop() {
+#ifdef ALLOCATIONCOUNTER_AVAILABLE
+	counting.storeRelease(0);
+#endif
+}
+
+QVector<ThreadAllocations> AllocationCounter::getThreadAllocations() {
+	QVector<ThreadAllocations> threads;
+#ifdef ALLOCATIONCOUNTER_AVAILABLE
+	//the list itself is allocated, the counting is paused meanwhile
+	int wasCounting = counting.fetchAndStoreOrdered(0);
+	int numberOfSlots = qMin(usedThreadSlots.loadAcquire(), ALLOCATIONCOUNTER_MAXIMUM_THREADS);
+	for(int i = 0; i <= ALLOCATIONCOUNTER_MAXIMUM_THREADS; i++){
+		if(i >= numberOfSlots && i != ALLOCATIONCOUNTER_MAXIMUM_THREADS){
+			continue;
+		}
+		ThreadAllocations thread;
+		thread.threadId = i < ALLOCATIONCOUNTER_MAXIMUM_THREADS ? threadSlots[i].threadId.loadAcquire() : 0;
+		thread.allocations = threadSlots[i].allocations.loadAcquire();
+		thread.bytes = threadSlots[i].bytes.loadAcquire();
+		if(thread.allocations > 0){
+			threads.append(thread);
+		}
+	}
+	counting.storeRelease(wasCounting);
+#endif
+	return threads;
+}
+
+qint64 AllocationCounter::getMainThreadId() {
+#ifdef ALLOCATIONCOUNTER_AVAILABLE
+	//the thread id of the main thread is the process id
+	return static_cast<qint64>(getpid());
+#else
+	return -1;
+#endif
+}
+
+QString AllocationCounter::getThreadName(qint64 threadId) {
+	if(threadId == 0){
+		return "other threads";
+	}
+	QFile file(QString("/proc/self/task/%1/comm").arg(threadId));
+	if(!file.open(QFile::ReadOnly)){
+		return "exited";
+	}
+	return QString::fromLocal8Bit(file.readAll()).trimmed();
+}
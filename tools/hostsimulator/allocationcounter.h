@@ -0,0 +1,30 @@
+#ifndef ALLOCATIONCOUNTER_H
+#define ALLOCATIONCOUNTER_H
+
+#include <QtGlobal>
+#include <QString>
+#include <QVector>
+
+#define ALLOCATIONCOUNTER_MAXIMUM_THREADS 256
+
+struct ThreadAllocations {
+	qint64 threadId; //0 for threads that did not get a slot of their own
+	quint64 allocations;
+	quint64 bytes;
+};
+
+//counts the heap allocations of every thread of the process. malloc and its relatives are replaced by wrappers that count
+//and forward to the allocator of glibc, operator new uses malloc and is counted as well. only available on linux with glibc.
+//the wrappers must not allocate themselves, so every thread takes a slot of a fixed table the first time it allocates
+class AllocationCounter
+{
+public:
+	static bool isAvailable();
+	static void start(); //resets all counters
+	static void stop();
+	static QVector<ThreadAllocations> getThreadAllocations(); //threads without allocations since start() are not listed
+	static qint64 getMainThreadId();
+	static QString getThreadName(qint64 threadId);
+};
+
+#endif //ALLOCATIONCOUNTER_H
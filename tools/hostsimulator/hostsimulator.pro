@@ -0,0 +1,65 @@
+QT += core gui widgets
+QMAKE_PROJECT_DEPTH = 0
+
+TARGET = hostsimulator
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle
+
+#define path of OCTproZ_DevKit share directory, same as for the extension
+SHAREDIR = $$shell_path($$PWD/../../../../octproz_share_dev)
+
+DEFINES += \
+	QT_DEPRECATED_WARNINGS #emit warnings if depracted Qt features are used
+
+SOURCES += \
+	main.cpp \
+	syntheticframes.cpp \
+	acquisitionsimulator.cpp \
+	allocationcounter.cpp
+
+HEADERS += \
+	syntheticframes.h \
+	acquisitionsimulator.h \
+	allocationcounter.h
+
+INCLUDEPATH += \
+	$$SHAREDIR \
+	../../src
+
+#link the static core library that is built by tools/signalmonitorcore (latency histograms)
+CORE_BUILD_DIR = $$shell_path($$OUT_PWD/../signalmonitorcore)
+win32{
+	CONFIG(debug, debug|release) {
+		CORE_LIBRARY = $$shell_path($$CORE_BUILD_DIR/debug/signalmonitorcore.lib)
+	}
+	CONFIG(release, debug|release) {
+		CORE_LIBRARY = $$shell_path($$CORE_BUILD_DIR/release/signalmonitorcore.lib)
+	}
+}
+unix{
+	CORE_LIBRARY = $$shell_path($$CORE_BUILD_DIR/libsignalmonitorcore.a)
+}
+LIBS += $$CORE_LIBRARY
+PRE_TARGETDEPS += $$CORE_LIBRARY
+
+#the Extension interface is part of the OCTproZ_DevKit
+CONFIG(debug, debug|release) {
+	unix{
+		LIBS += $$shell_path($$SHAREDIR/debug/libOCTproZ_DevKit.a)
+	}
+	win32{
+		LIBS += $$shell_path($$SHAREDIR/debug/OCTproZ_DevKit.lib)
+	}
+}
+CONFIG(release, debug|release) {
+	unix{
+		LIBS += $$shell_path($$SHAREDIR/release/libOCTproZ_DevKit.a)
+	}
+	win32{
+		LIBS += $$shell_path($$SHAREDIR/release/OCTproZ_DevKit.lib)
+	}
+}
+unix{
+	LIBS += -lpthread
+}
@@ -0,0 +1,219 @@
+//host simulator. loads the signal monitor extension like OCTproZ does, delivers synthetic buffers from a simulated
+//acquisition thread at a fixed rate and reports how the extension keeps up. no OCTproZ installation or OCT hardware is needed
+
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QPluginLoader>
+#include <QTextStream>
+#include <QTimer>
+#include <QWidget>
+#include "octproz_devkit.h"
+#include "syntheticframes.h"
+#include "acquisitionsimulator.h"
+#include "allocationcounter.h"
+
+static QString formatHistogram(const LatencyHistogram& histogram) {
+	return QString("mean %1 us, p50 %2 us, p99 %3 us, p99.9 %4 us, max %5 us")
+		.arg(histogram.getMean()/1000.0, 0, 'f', 1)
+		.arg(histogram.getPercentile(50)/1000.0, 0, 'f', 1)
+		.arg(histogram.getPercentile(99)/1000.0, 0, 'f', 1)
+		.arg(histogram.getPercentile(99.9)/1000.0, 0, 'f', 1)
+		.arg(histogram.getMaximum()/1000.0, 0, 'f', 1);
+}
+
+static int reportAllocations(QTextStream& out, bool countingStarted, const QVector<ThreadAllocations>& threadAllocations, quint64 countedBuffers) {
+	//the gui thread is reported but not checked, replot and painting allocate inside Qt and QCustomPlot
+	if(!countingStarted){
+		out << "  heap allocations: not counted, the run was shorter than the warm up\n";
+		return 1;
+	}
+	out << "  heap allocations after the warm up (" << countedBuffers << " buffers):\n";
+	qint64 mainThreadId = AllocationCounter::getMainThreadId();
+	bool failed = false;
+	for(const ThreadAllocations& thread : threadAllocations){
+		bool guiThread = thread.threadId == mainThreadId;
+		failed = failed || !guiThread;
+		out << "    " << AllocationCounter::getThreadName(thread.threadId) << " (" << thread.threadId << (guiThread ? ", gui thread" : "") << "): "
+			<< thread.allocations << " allocations, " << thread.bytes << " bytes, "
+			<< QString::number(countedBuffers > 0 ? static_cast<double>(thread.allocations)/countedBuffers : 0.0, 'f', 2) << " allocations per buffer\n";
+	}
+	if(threadAllocations.isEmpty()){
+		out << "    none\n";
+	}
+	if(failed){
+		out << "  FAILED: the acquisition or worker threads allocated memory after the warm up\n";
+	}
+	return failed ? 1 : 0;
+}
+
+static int parsePatterns(QString text) {
+	int patterns = 0;
+#if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0)
+	QStringList names = text.split(",", Qt::SkipEmptyParts);
+#else
+	QStringList names = text.split(",", QString::SkipEmptyParts);
+#endif
+	for(const QString& name : names){
+		if(name.trimmed() == "speckle"){
+			patterns |= PATTERN_SPECKLE;
+		}else if(name.trimmed() == "saturation"){
+			patterns |= PATTERN_SATURATION;
+		}else if(name.trimmed() == "motion"){
+			patterns |= PATTERN_MOTION;
+		}else if(name.trimmed() != "none"){
+			return -1;
+		}
+	}
+	return patterns;
+}
+
+int main(int argc, char *argv[]) {
+	//without --show the extension window is rendered offscreen, so the simulator also runs on machines without a display
+	bool showWindow = false;
+	for(int i = 1; i < argc; i++){
+		if(QString(argv[i]) == "--show"){
+			showWindow = true;
+		}
+	}
+	if(!showWindow && qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")){
+		qputenv("QT_QPA_PLATFORM", "offscreen");
+	}
+	QApplication app(argc, argv);
+	QApplication::setApplicationName("hostsimulator");
+	QTextStream out(stdout);
+
+	QCommandLineParser parser;
+	parser.setApplicationDescription("Drives the signal monitor extension with synthetic buffers at a configurable rate.");
+	parser.addHelpOption();
+	parser.addPositionalArgument("plugin", "Extension library, e.g. libsignalmonitorextension.so");
+	QCommandLineOption rateOption({"r", "rate"}, "Buffers per second. Default: 100.", "rate", "100");
+	QCommandLineOption durationOption({"d", "duration"}, "Duration in seconds. Default: 10.", "seconds", "10");
+	QCommandLineOption bitDepthOption({"b", "bitdepth"}, "Bit depth. Default: 12.", "bits", "12");
+	QCommandLineOption samplesOption({"s", "samples"}, "Samples per line. Default: 1024.", "samples", "1024");
+	QCommandLineOption linesOption({"l", "lines"}, "Lines per frame. Default: 512.", "lines", "512");
+	QCommandLineOption framesOption({"f", "frames"}, "Frames per buffer. Default: 4.", "frames", "4");
+	QCommandLineOption buffersOption("buffers", "Buffers per volume. Default: 2.", "buffers", "2");
+	QCommandLineOption patternOption({"p", "pattern"}, "Comma separated list of speckle, saturation, motion or none. Default: speckle,motion.", "patterns", "speckle,motion");
+	QCommandLineOption resizeOption("resize-interval", "Seconds between changes of the buffer dimensions (half samples and lines). Default: 0 (no changes).", "seconds", "0");
+	QCommandLineOption outputOption({"o", "output"}, "raw, processed or both. Default: both.", "output", "both");
+	QCommandLineOption seedOption("seed", "Seed of the synthetic speckle. Default: 1.", "seed", "1");
+	QCommandLineOption showOption("show", "Show the extension window on screen.");
+	QCommandLineOption hiddenOption("hidden", "Do not show the extension window at all, the display path is not used then.");
+	QCommandLineOption countAllocationsOption("count-allocations", "Count the heap allocations of every thread after the warm up. Fails if any thread other than the gui thread allocates.");
+	QCommandLineOption warmUpOption("warm-up", "Seconds at the start that are not counted by --count-allocations. Default: 2.", "seconds", "2");
+	parser.addOptions({rateOption, durationOption, bitDepthOption, samplesOption, linesOption, framesOption, buffersOption, patternOption, resizeOption, outputOption, seedOption, showOption, hiddenOption, countAllocationsOption, warmUpOption});
+	parser.process(app);
+	if(parser.positionalArguments().size() != 1){
+		parser.showHelp(1);
+	}
+	bool countAllocations = parser.isSet(countAllocationsOption);
+	if(countAllocations && !AllocationCounter::isAvailable()){
+		out << "Counting allocations is only supported on Linux with glibc.\n";
+		return 1;
+	}
+
+	//synthetic data
+	SyntheticFormat format;
+	format.bitDepth = parser.value(bitDepthOption).toUInt();
+	format.samplesPerLine = parser.value(samplesOption).toUInt();
+	format.linesPerFrame = parser.value(linesOption).toUInt();
+	format.framesPerBuffer = parser.value(framesOption).toUInt();
+	format.buffersPerVolume = parser.value(buffersOption).toUInt();
+	int patterns = parsePatterns(parser.value(patternOption));
+	if(patterns < 0){
+		out << "Invalid pattern: " << parser.value(patternOption) << "\n";
+		return 1;
+	}
+	quint32 seed = parser.value(seedOption).toUInt();
+	SyntheticFrames frames;
+	if(!frames.generate(format, patterns, seed)){
+		out << "Invalid buffer dimensions.\n";
+		return 1;
+	}
+	AcquisitionSettings settings;
+	settings.buffersPerSecond = parser.value(rateOption).toDouble();
+	settings.dimensionChangeInterval = parser.value(resizeOption).toDouble();
+	QString output = parser.value(outputOption);
+	settings.outputs = output == "raw" ? OUTPUT_RAW : (output == "processed" ? OUTPUT_PROCESSED : OUTPUT_RAW|OUTPUT_PROCESSED);
+	SyntheticFrames alternativeFrames;
+	if(settings.dimensionChangeInterval > 0){
+		SyntheticFormat alternativeFormat = format;
+		alternativeFormat.samplesPerLine = qMax(1u, format.samplesPerLine/2);
+		alternativeFormat.linesPerFrame = qMax(1u, format.linesPerFrame/2);
+		alternativeFrames.generate(alternativeFormat, patterns, seed+1);
+	}
+
+	//load the extension like OCTproZ does
+	QPluginLoader loader(parser.positionalArguments().first());
+	Extension* extension = qobject_cast<Extension*>(loader.instance());
+	if(extension == nullptr){
+		out << "Could not load extension: " << loader.errorString() << "\n";
+		return 1;
+	}
+	qint64 startTimestamp = LatencyMonitor::now();
+	//messages of the extension and the progress are flushed right away, the report at the end is flushed when out is destroyed
+	auto printMessage = [&out, startTimestamp](QString prefix, QString message) {
+		out << QString::number((LatencyMonitor::now() - startTimestamp)/1.0e9, 'f', 3) << " s " << prefix << message << "\n";
+		out.flush();
+	};
+	QObject::connect(extension, &Extension::info, [printMessage](QString message) {printMessage("info: ", message);});
+	QObject::connect(extension, &Extension::error, [printMessage](QString message) {printMessage("error: ", message);});
+	extension->settingsLoaded(QVariantMap());
+	QWidget* widget = extension->getWidget();
+	if(!parser.isSet(hiddenOption)){
+		widget->show();
+	}
+	extension->enableRawDataGrabbing(true);
+	extension->enableProcessedDataGrabbing(true);
+	extension->activateExtension();
+
+	AcquisitionSimulator acquisition(extension, &frames, settings.dimensionChangeInterval > 0 ? &alternativeFrames : nullptr, settings);
+	acquisition.start(QThread::TimeCriticalPriority);
+	out << "Simulating " << settings.buffersPerSecond << " buffers/s of " << format.samplesPerLine << " x " << format.linesPerFrame << " x " << format.framesPerBuffer
+		<< " samples (" << format.bitDepth << " bit, " << frames.getBytesPerBuffer()/1048576.0 << " MiB per buffer)\n";
+	out.flush();
+
+	//the first buffers fill pools, queues, caches and per thread buffers, allocations are only counted after the warm up
+	quint64 buffersBeforeCounting = 0;
+	bool countingStarted = false;
+	if(countAllocations){
+		QTimer::singleShot(static_cast<int>(parser.value(warmUpOption).toDouble()*1000.0), &app, [&]() {
+			buffersBeforeCounting = acquisition.getCounters().deliveredBuffers;
+			countingStarted = true;
+			AllocationCounter::start();
+		});
+	}
+
+	double duration = parser.value(durationOption).toDouble();
+	QTimer::singleShot(static_cast<int>(duration*1000.0), &app, [&]() {
+		acquisition.stop();
+		acquisition.wait();
+		//the counters are read before the extension is deactivated, stopping the workers is not part of the steady state
+		AllocationCounter::stop();
+		QVector<ThreadAllocations> threadAllocations = AllocationCounter::getThreadAllocations();
+		extension->deactivateExtension();
+
+		AcquisitionCounters counters = acquisition.getCounters();
+		double seconds = (LatencyMonitor::now() - startTimestamp)/1.0e9;
+		out << "Host simulator report\n";
+		out << "  buffers delivered: " << counters.deliveredBuffers << " (" << QString::number(counters.deliveredBuffers/seconds, 'f', 1) << " buffers/s)\n";
+		out << "  buffers late: " << counters.lateBuffers << ", buffers missed because the acquisition thread was blocked: " << counters.missedBuffers << "\n";
+		out << "  dimension changes: " << counters.dimensionChanges << "\n";
+		if(settings.outputs & OUTPUT_RAW){
+			out << "  rawDataReceived: " << formatHistogram(acquisition.getRawCallHistogram()) << "\n";
+		}
+		if(settings.outputs & OUTPUT_PROCESSED){
+			out << "  processedDataReceived: " << formatHistogram(acquisition.getProcessedCallHistogram()) << "\n";
+		}
+		int exitCode = 0;
+		if(countAllocations){
+			exitCode = reportAllocations(out, countingStarted, threadAllocations, counters.deliveredBuffers - buffersBeforeCounting);
+		}
+		app.exit(exitCode);
+	});
+
+	//the extension deletes its window itself
+	int result = app.exec();
+	loader.unload();
+	return result;
+}
@@ -0,0 +1,70 @@
+#include "syntheticframes.h"
+#include <QtMath>
+
+
+SyntheticFrames::SyntheticFrames()
+	: format({0, 0, 0, 0, 0}),
+	bytesPerSample(0),
+	bytesPerBuffer(0)
+{
+}
+
+bool SyntheticFrames::generate(const SyntheticFormat& format, int patterns, quint32 seed) {
+	if(format.bitDepth == 0 || format.bitDepth > 32 || format.samplesPerLine == 0 || format.linesPerFrame == 0 || format.framesPerBuffer == 0 || format.buffersPerVolume == 0){
+		return false;
+	}
+	this->format = format;
+	this->bytesPerSample = static_cast<size_t>(ceil(static_cast<double>(format.bitDepth)/8.0));
+	this->bytesPerSample = this->bytesPerSample == 3 ? 4 : this->bytesPerSample;
+	this->bytesPerBuffer = static_cast<size_t>(format.samplesPerLine)*format.linesPerFrame*format.framesPerBuffer*this->bytesPerSample;
+
+	std::mt19937 random(seed);
+	this->buffers.resize(SYNTHETICFRAMES_RING_SIZE);
+	for(int i = 0; i < this->buffers.size(); i++){
+		this->buffers[i].resize(static_cast<int>(this->bytesPerBuffer));
+		switch(this->bytesPerSample){
+			case 1: this->fillBuffer(reinterpret_cast<quint8*>(this->buffers[i].data()), i, patterns, random); break;
+			case 2: this->fillBuffer(reinterpret_cast<quint16*>(this->buffers[i].data()), i, patterns, random); break;
+			default: this->fillBuffer(reinterpret_cast<quint32*>(this->buffers[i].data()), i, patterns, random);
+		}
+	}
+	return true;
+}
+
+template<typename T>
+void SyntheticFrames::fillBuffer(T* buffer, int bufferIndex, int patterns, std::mt19937& random) {
+	double maximum = qPow(2.0, this->format.bitDepth) - 1.0;
+	double background = maximum*0.02;
+	double signal = maximum*0.25;
+	std::exponential_distribution<double> speckle(1.0);
+
+	//the motion pattern shifts the surface by up to a tenth of the depth range, one full period takes the whole ring
+	int samplesPerLine = static_cast<int>(this->format.samplesPerLine);
+	int linesPerFrame = static_cast<int>(this->format.linesPerFrame);
+	int surface = samplesPerLine/10;
+	if(patterns & PATTERN_MOTION){
+		surface += static_cast<int>(samplesPerLine/10*qSin(2.0*M_PI*bufferIndex/SYNTHETICFRAMES_RING_SIZE));
+	}
+	int saturatedBegin = linesPerFrame*2/5;
+	int saturatedEnd = linesPerFrame*3/5;
+	double decayLength = qMax(1.0, samplesPerLine/4.0);
+
+	for(unsigned int frame = 0; frame < this->format.framesPerBuffer; frame++){
+		T* frameData = buffer + static_cast<size_t>(frame)*this->format.samplesPerLine*this->format.linesPerFrame;
+		for(int line = 0; line < linesPerFrame; line++){
+			T* lineData = frameData + static_cast<size_t>(line)*samplesPerLine;
+			bool saturated = (patterns & PATTERN_SATURATION) && line >= saturatedBegin && line < saturatedEnd;
+			for(int sample = 0; sample < samplesPerLine; sample++){
+				double depth = sample - surface;
+				double value = background + (depth >= 0 ? signal*qExp(-depth/decayLength) : 0.0);
+				if(patterns & PATTERN_SPECKLE){
+					value *= speckle(random);
+				}
+				if(saturated && depth >= 0 && depth < decayLength){
+					value = maximum;
+				}
+				lineData[sample] = static_cast<T>(qBound(0.0, value, maximum));
+			}
+		}
+	}
+}
@@ -0,0 +1,45 @@
+#ifndef SYNTHETICFRAMES_H
+#define SYNTHETICFRAMES_H
+
+#include <QtGlobal>
+#include <QVector>
+#include <random>
+
+#define SYNTHETICFRAMES_RING_SIZE 8
+
+enum SYNTHETIC_PATTERN {
+	PATTERN_SPECKLE = 0x1, //fully developed speckle on top of an exponentially decaying depth profile
+	PATTERN_SATURATION = 0x2, //a band of lines that is clipped at the maximum sample value
+	PATTERN_MOTION = 0x4 //the depth profile moves axially from buffer to buffer
+};
+
+struct SyntheticFormat {
+	unsigned int bitDepth;
+	unsigned int samplesPerLine;
+	unsigned int linesPerFrame;
+	unsigned int framesPerBuffer;
+	unsigned int buffersPerVolume;
+};
+
+//ring of synthetic acquisition buffers. all buffers are generated in advance, so the generation does not add to the time
+//the simulated acquisition thread spends per buffer
+class SyntheticFrames
+{
+public:
+	SyntheticFrames();
+
+	bool generate(const SyntheticFormat& format, int patterns, quint32 seed);
+	void* getBuffer(quint64 bufferCounter) {return this->buffers[static_cast<int>(bufferCounter%this->buffers.size())].data();}
+	const SyntheticFormat& getFormat() const {return this->format;}
+	size_t getBytesPerBuffer() const {return this->bytesPerBuffer;}
+
+private:
+	SyntheticFormat format;
+	size_t bytesPerSample;
+	size_t bytesPerBuffer;
+	QVector<QVector<char>> buffers;
+
+	template<typename T> void fillBuffer(T* buffer, int bufferIndex, int patterns, std::mt19937& random);
+};
+
+#endif //SYNTHETICFRAMES_H
@@ -0,0 +1,158 @@
+#include "benchmarkrunner.h"
+#include "latencymonitor.h"
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QVariantMap>
+#include <algorithm>
+#include <vector>
+
+
+BenchmarkRunner::BenchmarkRunner(double minimumSeconds, QString filter)
+	: minimumSeconds(qMax(0.001, minimumSeconds)),
+	filter(filter),
+	out(nullptr),
+	listOnly(false)
+{
+}
+
+bool BenchmarkRunner::isSelected(QString name) const {
+	return this->filter.pattern().isEmpty() || this->filter.match(name).hasMatch();
+}
+
+void BenchmarkRunner::run(QString name, double elements, double bytes, const std::function<void()>& body, qint64 maximumIterations) {
+	if(!this->isSelected(name)){
+		return;
+	}
+	if(this->listOnly){
+		if(this->out != nullptr){
+			*this->out << name << "\n";
+		}
+		return;
+	}
+	qint64 minimumNanoseconds = static_cast<qint64>(this->minimumSeconds*1000000000.0);
+
+	//warm up: caches, page faults of freshly allocated buffers, lazy initialization and cpu frequency ramp up are not measured
+	qint64 warmUpEnd = LatencyMonitor::now() + minimumNanoseconds/10;
+	int warmUpIterations = 0;
+	while(warmUpIterations < 2 || (LatencyMonitor::now() < warmUpEnd && warmUpIterations < maximumIterations)){
+		body();
+		warmUpIterations++;
+	}
+
+	std::vector<qint64> durations;
+	durations.reserve(1024);
+	qint64 measurementEnd = LatencyMonitor::now() + minimumNanoseconds;
+	while(static_cast<qint64>(durations.size()) < BENCHMARK_MINIMUM_ITERATIONS || (LatencyMonitor::now() < measurementEnd && static_cast<qint64>(durations.size()) < maximumIterations)){
+		qint64 startTimestamp = LatencyMonitor::now();
+		body();
+		durations.push_back(LatencyMonitor::now() - startTimestamp);
+	}
+	std::sort(durations.begin(), durations.end());
+
+	BenchmarkResult result;
+	result.name = name;
+	result.iterations = static_cast<qint64>(durations.size());
+	size_t middle = durations.size()/2;
+	result.medianNanoseconds = durations.size() % 2 == 0 ? (durations[middle-1]+durations[middle])/2.0 : static_cast<double>(durations[middle]);
+	result.minimumNanoseconds = static_cast<double>(durations.front());
+	result.elements = elements;
+	result.bytes = bytes;
+	this->results.append(result);
+	this->printResult(result);
+}
+
+void BenchmarkRunner::printResult(const BenchmarkResult& result) const {
+	if(this->out == nullptr){
+		return;
+	}
+	QString line = QString("%1 %2 ns %3 ns/element").arg(result.name, -48).arg(result.medianNanoseconds, 14, 'f', 0).arg(result.getNanosecondsPerElement(), 10, 'f', 4);
+	if(result.bytes > 0){
+		line += QString(" %1 GB/s").arg(result.getGigabytesPerSecond(), 8, 'f', 2);
+	}
+	//flushed after every case, so the progress of a long run is visible
+	*this->out << line << "\n";
+	this->out->flush();
+}
+
+bool BenchmarkRunner::writeJson(QString fileName, const QVariantMap& environment) const {
+	QJsonArray cases;
+	for(const BenchmarkResult& result : this->results){
+		QJsonObject object;
+		object["name"] = result.name;
+		object["iterations"] = result.iterations;
+		object["median_ns"] = result.medianNanoseconds;
+		object["minimum_ns"] = result.minimumNanoseconds;
+		object["elements"] = result.elements;
+		object["bytes"] = result.bytes;
+		object["ns_per_element"] = result.getNanosecondsPerElement();
+		object["gb_per_second"] = result.getGigabytesPerSecond();
+		cases.append(object);
+	}
+	QJsonObject root;
+	root["format_version"] = BENCHMARK_FORMAT_VERSION;
+	root["environment"] = QJsonObject::fromVariantMap(environment);
+	root["results"] = cases;
+
+	QFile file(fileName);
+	if(!file.open(QFile::WriteOnly|QFile::Truncate)){
+		return false;
+	}
+	return file.write(QJsonDocument(root).toJson()) > 0;
+}
+
+bool BenchmarkRunner::readJson(QString fileName, QVector<BenchmarkResult>* results, QVariantMap* environment) {
+	QFile file(fileName);
+	if(!file.open(QFile::ReadOnly)){
+		return false;
+	}
+	QJsonDocument document = QJsonDocument::fromJson(file.readAll());
+	QJsonObject root = document.object();
+	if(!document.isObject() || root["format_version"].toInt() != BENCHMARK_FORMAT_VERSION){
+		return false;
+	}
+	*environment = root["environment"].toObject().toVariantMap();
+	results->clear();
+	for(const QJsonValue& value : root["results"].toArray()){
+		QJsonObject object = value.toObject();
+		BenchmarkResult result;
+		result.name = object["name"].toString();
+		result.iterations = static_cast<qint64>(object["iterations"].toDouble());
+		result.medianNanoseconds = object["median_ns"].toDouble();
+		result.minimumNanoseconds = object["minimum_ns"].toDouble();
+		result.elements = object["elements"].toDouble();
+		result.bytes = object["bytes"].toDouble();
+		results->append(result);
+	}
+	return true;
+}
+
+BenchmarkComparison BenchmarkRunner::compare(const QVector<BenchmarkResult>& baseline, double tolerance) const {
+	//a case is slower or faster if its median differs by more than the tolerance (relative) from the median of the baseline
+	BenchmarkComparison comparison = {0, 0, 0, 0};
+	for(const BenchmarkResult& reference : baseline){
+		auto current = std::find_if(this->results.cbegin(), this->results.cend(), [&reference](const BenchmarkResult& result) {return result.name == reference.name;});
+		if(current == this->results.cend()){
+			if(this->isSelected(reference.name)){
+				comparison.missing++;
+			}
+			continue;
+		}
+		comparison.compared++;
+		double ratio = reference.medianNanoseconds > 0 ? current->medianNanoseconds/reference.medianNanoseconds : 1.0;
+		QString verdict = "";
+		if(ratio > 1.0 + tolerance){
+			comparison.slower++;
+			verdict = "SLOWER";
+		}else if(ratio < 1.0 - tolerance){
+			comparison.faster++;
+			verdict = "faster";
+		}
+		if(this->out != nullptr){
+			*this->out << QString("%1 %2 ns -> %3 ns %4x %5").arg(reference.name, -48).arg(reference.medianNanoseconds, 14, 'f', 0)
+				.arg(current->medianNanoseconds, 14, 'f', 0).arg(ratio, 6, 'f', 3).arg(verdict) << "\n";
+		}
+	}
+	return comparison;
+}
@@ -0,0 +1,61 @@
+#ifndef BENCHMARKRUNNER_H
+#define BENCHMARKRUNNER_H
+
+#include <QString>
+#include <QVector>
+#include <QRegularExpression>
+#include <QTextStream>
+#include <QVariantMap>
+#include <functional>
+
+#define BENCHMARK_FORMAT_VERSION 1
+#define BENCHMARK_MINIMUM_ITERATIONS 5
+#define BENCHMARK_MAXIMUM_ITERATIONS 1000000
+
+struct BenchmarkResult {
+	QString name;
+	qint64 iterations;
+	double medianNanoseconds; //per iteration, used for comparisons because it is not affected by single interruptions
+	double minimumNanoseconds;
+	double elements; //pixels or data points processed per iteration
+	double bytes; //bytes read and written per iteration, 0 if not meaningful
+
+	double getNanosecondsPerElement() const {return this->elements > 0 ? this->medianNanoseconds/this->elements : 0.0;}
+	double getGigabytesPerSecond() const {return this->medianNanoseconds > 0 ? this->bytes/this->medianNanoseconds : 0.0;}
+};
+
+struct BenchmarkComparison {
+	int compared;
+	int slower;
+	int faster;
+	int missing; //cases of the baseline that were not run
+};
+
+//runs benchmark cases, every iteration is timed on its own. results can be written to json and compared with a stored baseline.
+//a case is measured until the minimum time has passed, after a short warm up that is not measured
+class BenchmarkRunner
+{
+public:
+	BenchmarkRunner(double minimumSeconds, QString filter);
+
+	bool isSelected(QString name) const;
+	void run(QString name, double elements, double bytes, const std::function<void()>& body, qint64 maximumIterations = BENCHMARK_MAXIMUM_ITERATIONS);
+	const QVector<BenchmarkResult>& getResults() const {return this->results;}
+	void setOutputStream(QTextStream* out) {this->out = out;}
+	void setListOnly(bool listOnly) {this->listOnly = listOnly;} //run() only prints the names of the selected cases
+
+	bool writeJson(QString fileName, const QVariantMap& environment) const;
+	static bool readJson(QString fileName, QVector<BenchmarkResult>* results, QVariantMap* environment);
+	BenchmarkComparison compare(const QVector<BenchmarkResult>& baseline, double tolerance) const;
+
+private:
+	double minimumSeconds;
+	QRegularExpression filter;
+	QVector<BenchmarkResult> results;
+	QTextStream* out;
+	bool listOnly;
+
+	void printResult(const BenchmarkResult& result) const;
+};
+
+#endif //BENCHMARKRUNNER_H
@@ -0,0 +1,340 @@
+//benchmarks of the hot functions of the signal monitor: metric calculation, bit depth conversion, frame copy in the host thread,
+//plot update and frame display.
+//results are reported as ns per pixel (or data point) and GB/s, can be written to json and compared with a stored baseline
+
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QSysInfo>
+#include <QDateTime>
+#include <QVector>
+#include <QTextStream>
+#include <QtMath>
+#include <random>
+#include <string.h>
+#include "benchmarkrunner.h"
+#include "imagemetriccalculator.h"
+#include "bitdepthconverter.h"
+#include "scrollingplot.h"
+#include "imagedisplay.h"
+#include "taskpool.h"
+#include "streamingcopy.h"
+
+#define BENCHMARK_HOST_WORKING_SET_BYTES (1024*1024) //data the simulated host thread processes between two buffers, about the size of an L2 cache
+#define BENCHMARK_HOST_SOURCE_BUFFERS 4 //the host hands over different buffers, like the buffers of an acquisition ring
+
+struct PixelType {
+	QString name;
+	unsigned int bitDepth;
+	unsigned int bytesPerSample;
+};
+
+struct FrameSize {
+	unsigned int samplesPerLine;
+	unsigned int linesPerFrame;
+
+	QString toString() const {return QString("%1x%2").arg(this->samplesPerLine).arg(this->linesPerFrame);}
+	double getPixels() const {return static_cast<double>(this->samplesPerLine)*this->linesPerFrame;}
+};
+
+//synthetic frame with random samples of the full bit depth, the storage is 4 byte aligned for all pixel types
+class BenchmarkFrame
+{
+public:
+	BenchmarkFrame(const PixelType& type, const FrameSize& size, quint32 seed) {
+		size_t bytes = static_cast<size_t>(size.getPixels())*type.bytesPerSample;
+		this->storage.resize(static_cast<int>((bytes+3)/4));
+		std::mt19937 generator(seed);
+		std::uniform_int_distribution<quint32> distribution(0, type.bitDepth >= 32 ? 0xFFFFFFFF : (1u << type.bitDepth)-1);
+		uchar* bytesData = reinterpret_cast<uchar*>(this->storage.data());
+		for(size_t i = 0; i < static_cast<size_t>(size.getPixels()); i++){
+			quint32 value = distribution(generator);
+			switch(type.bytesPerSample){
+				case 1: bytesData[i] = static_cast<uchar>(value); break;
+				case 2: reinterpret_cast<quint16*>(bytesData)[i] = static_cast<quint16>(value); break;
+				default: reinterpret_cast<quint32*>(bytesData)[i] = value;
+			}
+		}
+		this->descriptor.data = bytesData;
+		this->descriptor.pool = nullptr;
+		this->descriptor.slot = -1;
+		this->descriptor.sequenceNumber = 0;
+		this->descriptor.source = REPLAY;
+		this->descriptor.bitDepth = type.bitDepth;
+		this->descriptor.samplesPerLine = size.samplesPerLine;
+		this->descriptor.linesPerFrame = size.linesPerFrame;
+		this->descriptor.bytesPerLine = size.samplesPerLine*type.bytesPerSample;
+		this->descriptor.bufferNr = 0;
+		this->descriptor.frameNr = 0;
+		this->descriptor.configurationVersion = 0;
+		this->descriptor.imageMetric = AVERAGE;
+		this->descriptor.roi = QRect(0, 0, static_cast<int>(size.samplesPerLine), static_cast<int>(size.linesPerFrame));
+		this->descriptor.acquisitionTimestamp = 0;
+		this->descriptor.handoffTimestamp = 0;
+	}
+
+	FrameDescriptor descriptor;
+
+private:
+	QVector<quint32> storage;
+};
+
+static QRect centeredRoi(const FrameSize& size, int percentOfArea) {
+	//width and height are scaled by the same factor, so the roi keeps the aspect ratio of the frame
+	double scale = qSqrt(percentOfArea/100.0);
+	int width = qMax(1, static_cast<int>(size.samplesPerLine*scale));
+	int height = qMax(1, static_cast<int>(size.linesPerFrame*scale));
+	return QRect((static_cast<int>(size.samplesPerLine)-width)/2, (static_cast<int>(size.linesPerFrame)-height)/2, width, height);
+}
+
+static void benchmarkMetric(BenchmarkRunner& runner, TaskPool* pool, const QVector<PixelType>& types, const QVector<FrameSize>& sizes) {
+	ImageMetricCalculator calculator;
+	calculator.setTaskPool(pool);
+	QVector<int> roiPercentages = {100, 25, 1};
+	QVector<QPair<QString, IMAGE_METRIC>> metrics = {{"average", AVERAGE}, {"stddev", STDDEV}};
+	for(const PixelType& type : types){
+		for(const FrameSize& size : sizes){
+			BenchmarkFrame frame(type, size, 1);
+			for(int roiPercentage : roiPercentages){
+				for(const QPair<QString, IMAGE_METRIC>& metric : metrics){
+					FrameDescriptor descriptor = frame.descriptor;
+					descriptor.roi = centeredRoi(size, roiPercentage);
+					descriptor.imageMetric = metric.second;
+					double pixels = static_cast<double>(descriptor.roi.width())*descriptor.roi.height();
+					QString name = QString("metric/%1/%2/roi%3/%4").arg(type.name, size.toString()).arg(roiPercentage).arg(metric.first);
+					qreal value = 0;
+					runner.run(name, pixels, pixels*type.bytesPerSample, [&]() {
+						calculator.calculate(descriptor, &value);
+					});
+				}
+			}
+		}
+	}
+}
+
+static void benchmarkConversion(BenchmarkRunner& runner, TaskPool* pool, const QVector<PixelType>& types, const QVector<FrameSize>& sizes) {
+	//8 bit frames are passed on without conversion, so only the wider pixel types are measured
+	BitDepthConverter converter;
+	converter.setTaskPool(pool);
+	for(const PixelType& type : types){
+		if(type.bitDepth <= 8){
+			continue;
+		}
+		for(const FrameSize& size : sizes){
+			BenchmarkFrame frame(type, size, 2);
+			QString name = QString("convert/%1/%2").arg(type.name, size.toString());
+			runner.run(name, size.getPixels(), size.getPixels()*(type.bytesPerSample+1), [&]() {
+				converter.convertDataTo8bit(frame.descriptor);
+			});
+		}
+	}
+
+	//the full range is converted by the vectorized kernels (see conversionkernels.h), a window uses the lookup table
+	DisplayMapping window = {0.0, 0.0, 1.0, false};
+	for(const PixelType& type : types){
+		if(type.bitDepth <= 8){
+			continue;
+		}
+		window.level = std::ldexp(1.0, static_cast<int>(type.bitDepth) - 1);
+		window.window = std::ldexp(1.0, static_cast<int>(type.bitDepth) - 2);
+		converter.setDisplayMapping(window);
+		for(const FrameSize& size : sizes){
+			BenchmarkFrame frame(type, size, 2);
+			QString name = QString("convert-window/%1/%2").arg(type.name, size.toString());
+			runner.run(name, size.getPixels(), size.getPixels()*(type.bytesPerSample+1), [&]() {
+				converter.convertDataTo8bit(frame.descriptor);
+			});
+		}
+	}
+}
+
+static void benchmarkHostCopy(BenchmarkRunner& runner) {
+	//simulated host thread: it processes its own working set and copies every buffer into a frame slot of the extension,
+	//like FrameIngest does inside rawDataReceived(). copying with memcpy pulls source and destination into the caches of
+	//the host core and evicts the working set, streamingCopy() should not. "host/none" is the working set alone,
+	//"copy/..." the copy alone, the impact on the host is "host/<copy>" minus "copy/<copy>" minus "host/none"
+	QVector<quint32> workingSet(BENCHMARK_HOST_WORKING_SET_BYTES/static_cast<int>(sizeof(quint32)), 1);
+	quint32 checksum = 0;
+	auto processWorkingSet = [&]() {
+		quint32* data = workingSet.data();
+		for(int i = 0; i < workingSet.size(); i++){
+			data[i] = data[i]*1664525u + 1013904223u;
+			checksum += data[i];
+		}
+	};
+	double workingSetBytes = BENCHMARK_HOST_WORKING_SET_BYTES;
+	runner.run("host/none", workingSetBytes, workingSetBytes, processWorkingSet);
+
+	//frame sizes below, at and above the threshold of streamingCopy() (smaller frames are copied with memcpy anyway)
+	QVector<int> frameKilobytes = {128, STREAMINGCOPY_THRESHOLD_BYTES/1024, 1024, 8192, 32768};
+	QVector<QPair<QString, void(*)(void*, const void*, size_t)>> copyFunctions = {
+		{"memcpy", [](void* destination, const void* source, size_t bytes) {memcpy(destination, source, bytes);}},
+		{"streamingCopy", &streamingCopy}
+	};
+	for(int kilobytes : frameKilobytes){
+		size_t frameBytes = static_cast<size_t>(kilobytes)*1024;
+		QString selectionPattern = QString("/%1KiB").arg(kilobytes);
+		if(!runner.isSelected("host/memcpy" + selectionPattern) && !runner.isSelected("host/streamingCopy" + selectionPattern)
+				&& !runner.isSelected("copy/memcpy" + selectionPattern) && !runner.isSelected("copy/streamingCopy" + selectionPattern)){
+			continue;
+		}
+		QVector<char> sources(static_cast<int>(frameBytes*BENCHMARK_HOST_SOURCE_BUFFERS), 1);
+		QVector<char> destinations(static_cast<int>(frameBytes*BENCHMARK_HOST_SOURCE_BUFFERS), 0);
+		for(const QPair<QString, void(*)(void*, const void*, size_t)>& copyFunction : copyFunctions){
+			int buffer = 0;
+			auto copyFrame = [&]() {
+				copyFunction.second(destinations.data() + buffer*frameBytes, sources.constData() + buffer*frameBytes, frameBytes);
+				buffer = (buffer+1) % BENCHMARK_HOST_SOURCE_BUFFERS;
+			};
+			runner.run(QString("copy/%1/%2KiB").arg(copyFunction.first).arg(kilobytes), static_cast<double>(frameBytes), 2.0*frameBytes, copyFrame);
+			runner.run(QString("host/%1/%2KiB").arg(copyFunction.first).arg(kilobytes), workingSetBytes, workingSetBytes + 2.0*frameBytes, [&]() {
+				copyFrame();
+				processWorkingSet();
+			});
+		}
+	}
+	if(checksum == 1){
+		//keeps the compiler from removing the working set loop
+		workingSet[0] = checksum;
+	}
+}
+
+static void benchmarkPlot(BenchmarkRunner& runner) {
+	//the history is inserted directly into the graph in front of the first data point of the plot. the maximum number of data points
+	//is never reached during the measurement, so the plot is not cleared and the history grows by at most the number of iterations
+	QVector<int> historyLengths = {1000, 10000, 100000};
+	for(int history : historyLengths){
+		QString name = QString("plot/addDataToCurve/history%1").arg(history);
+		if(!runner.isSelected(name)){
+			continue;
+		}
+		ScrollingPlot plot;
+		plot.resize(800, 250);
+		plot.show();
+		plot.setMaxNumberOfDataPoints(history*3);
+		plot.setNumberOfVisibleDataPoints(history);
+		std::mt19937 generator(3);
+		std::normal_distribution<double> noise(0.0, 1.0);
+		QVector<double> keys;
+		QVector<double> values;
+		for(int i = -history+1; i <= 0; i++){
+			keys.append(i);
+			values.append(100.0 + 10.0*qSin(i*0.01) + noise(generator));
+		}
+		plot.graph(0)->addData(keys, values, true);
+		int counter = 1;
+		runner.run(name, history, 0, [&]() {
+			plot.addDataToCurve(100.0 + 10.0*qSin(counter*0.01) + noise(generator));
+			counter++;
+		}, history/2);
+	}
+}
+
+static void benchmarkDisplay(BenchmarkRunner& runner, const QVector<FrameSize>& sizes) {
+	//displayFrame() only uploads the frame to a pixmap, the scene is drawn later by the event loop. the repaint cases include drawing
+	ImageDisplay display;
+	display.resize(800, 600);
+	display.show();
+	PixelType type = {"u8", 8, 1};
+	for(const FrameSize& size : sizes){
+		BenchmarkFrame frame(type, size, 4);
+		runner.run(QString("display/%1").arg(size.toString()), size.getPixels(), size.getPixels(), [&]() {
+			display.displayFrame(frame.descriptor);
+		});
+		runner.run(QString("display_repaint/%1").arg(size.toString()), size.getPixels(), size.getPixels(), [&]() {
+			display.displayFrame(frame.descriptor);
+			display.viewport()->repaint();
+		});
+	}
+}
+
+int main(int argc, char *argv[]) {
+	//plot and display are rendered offscreen, so the benchmark also runs on machines without a display
+	if(qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")){
+		qputenv("QT_QPA_PLATFORM", "offscreen");
+	}
+	QApplication app(argc, argv);
+	QApplication::setApplicationName("signalmonitor-bench");
+	QTextStream out(stdout);
+
+	QCommandLineParser parser;
+	parser.setApplicationDescription("Benchmarks the metric calculation, bit depth conversion, plot update and frame display of the signal monitor.");
+	parser.addHelpOption();
+	QCommandLineOption filterOption("filter", "Only run cases whose name matches the regular expression, e.g. ^metric/u16.", "regexp");
+	QCommandLineOption timeOption("time", "Measurement time per case in seconds. Default: 0.3.", "seconds", "0.3");
+	QCommandLineOption threadsOption({"t", "threads"}, "Threads of the task pool for metric calculation and conversion. Default: 1 (no task pool).", "threads", "1");
+	QCommandLineOption outputOption({"o", "output"}, "Write the results to a json file, e.g. to store them as baseline.", "file");
+	QCommandLineOption baselineOption({"b", "baseline"}, "Compare the results with a json file written by --output. The exit code is 2 if a case is slower.", "file");
+	QCommandLineOption toleranceOption("tolerance", "Relative difference of the median that counts as slower or faster. Default: 0.1.", "fraction", "0.1");
+	QCommandLineOption listOption("list", "Only list the names of the cases.");
+	parser.addOptions({filterOption, timeOption, threadsOption, outputOption, baselineOption, toleranceOption, listOption});
+	parser.process(app);
+
+	BenchmarkRunner runner(parser.value(timeOption).toDouble(), parser.value(filterOption));
+	runner.setOutputStream(&out);
+	int threads = qMax(1, parser.value(threadsOption).toInt());
+	TaskPool pool(threads);
+	TaskPool* taskPool = nullptr;
+	if(threads > 1){
+		pool.start();
+		taskPool = &pool;
+	}
+
+	QVector<PixelType> types = {{"u8", 8, 1}, {"u16", 12, 2}, {"u32", 24, 4}};
+	QVector<FrameSize> sizes = {{512, 512}, {2048, 1024}};
+	runner.setListOnly(parser.isSet(listOption));
+
+	benchmarkMetric(runner, taskPool, types, sizes);
+	benchmarkConversion(runner, taskPool, types, sizes);
+	benchmarkHostCopy(runner);
+	benchmarkPlot(runner);
+	benchmarkDisplay(runner, sizes);
+	if(taskPool != nullptr){
+		pool.stop();
+	}
+
+	QVariantMap environment;
+	environment["date"] = QDateTime::currentDateTime().toString(Qt::ISODate);
+	environment["host"] = QSysInfo::machineHostName();
+	environment["cpu_architecture"] = QSysInfo::currentCpuArchitecture();
+	environment["os"] = QSysInfo::prettyProductName();
+	environment["kernel"] = QSysInfo::kernelVersion();
+	environment["qt"] = QString(qVersion());
+	environment["threads"] = threads;
+	environment["conversion_kernel"] = QString(conversionKernelName(bestConversionKernel()));
+#ifdef QT_DEBUG
+	environment["build"] = "debug";
+#else
+	environment["build"] = "release";
+#endif
+
+	if(parser.isSet(listOption)){
+		return 0;
+	}
+	if(parser.isSet(outputOption) && !runner.writeJson(parser.value(outputOption), environment)){
+		out << "Could not write " << parser.value(outputOption) << "\n";
+		return 1;
+	}
+
+	int exitCode = 0;
+	if(parser.isSet(baselineOption)){
+		QVector<BenchmarkResult> baseline;
+		QVariantMap baselineEnvironment;
+		if(!BenchmarkRunner::readJson(parser.value(baselineOption), &baseline, &baselineEnvironment)){
+			out << "Could not read baseline " << parser.value(baselineOption) << "\n";
+			return 1;
+		}
+		//results of different machines, thread counts or build types can not be compared meaningfully
+		for(QString key : {"host", "cpu_architecture", "threads", "build"}){
+			if(baselineEnvironment.value(key) != environment.value(key)){
+				out << "Warning: " << key << " of the baseline (" << baselineEnvironment.value(key).toString() << ") differs from this run (" << environment.value(key).toString() << ")\n";
+			}
+		}
+		out << "\nComparison with " << parser.value(baselineOption) << " (" << baselineEnvironment.value("date").toString() << ")\n";
+		BenchmarkComparison comparison = runner.compare(baseline, parser.value(toleranceOption).toDouble());
+		out << comparison.compared << " cases compared, " << comparison.slower << " slower, " << comparison.faster << " faster, " << comparison.missing << " cases of the baseline not run\n";
+		if(comparison.slower > 0){
+			exitCode = 2;
+		}
+	}
+	return exitCode;
+}
@@ -0,0 +1,57 @@
+QT += core gui widgets printsupport
+QMAKE_PROJECT_DEPTH = 0
+
+TARGET = signalmonitor-bench
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle
+
+DEFINES += \
+	QT_DEPRECATED_WARNINGS #emit warnings if depracted Qt features are used
+
+#plot and display are compiled from the sources of the extension, everything else comes from the core library
+SOURCES += \
+	main.cpp \
+	benchmarkrunner.cpp \
+	../../src/thirdparty/qcustomplot/qcustomplot.cpp \
+	../../src/scrollingplot.cpp \
+	../../src/imagedisplay.cpp \
+	../../src/frameitem.cpp \
+	../../src/overlayitems/anchorpoint.cpp \
+	../../src/overlayitems/overlayitem.cpp \
+	../../src/overlayitems/rectoverlay.cpp
+
+HEADERS += \
+	benchmarkrunner.h \
+	../../src/thirdparty/qcustomplot/qcustomplot.h \
+	../../src/scrollingplot.h \
+	../../src/imagedisplay.h \
+	../../src/frameitem.h \
+	../../src/overlayitems/anchorpoint.h \
+	../../src/overlayitems/overlayitem.h \
+	../../src/overlayitems/rectoverlay.h
+
+INCLUDEPATH += \
+	../../src \
+	../../src/overlayitems \
+	../../src/thirdparty \
+	../../src/thirdparty/qcustomplot
+
+#link the static core library that is built by tools/signalmonitorcore
+CORE_BUILD_DIR = $$shell_path($$OUT_PWD/../signalmonitorcore)
+win32{
+	CONFIG(debug, debug|release) {
+		CORE_LIBRARY = $$shell_path($$CORE_BUILD_DIR/debug/signalmonitorcore.lib)
+	}
+	CONFIG(release, debug|release) {
+		CORE_LIBRARY = $$shell_path($$CORE_BUILD_DIR/release/signalmonitorcore.lib)
+	}
+}
+unix{
+	CORE_LIBRARY = $$shell_path($$CORE_BUILD_DIR/libsignalmonitorcore.a)
+}
+LIBS += $$CORE_LIBRARY
+unix{
+	LIBS += -lpthread
+}
+PRE_TARGETDEPS += $$CORE_LIBRARY
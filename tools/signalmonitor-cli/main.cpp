@@ -0,0 +1,260 @@
+//headless metric engine. calculates the image statistics of every frame of OCTproZ raw recordings and writes them
+//to a csv file or to a binary metric recording (same format as "Record metrics to file..." of the extension, see metricrecorder.h)
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QFile>
+#include <QTextStream>
+#include <QVector>
+#include <QtMath>
+#include "imagemetriccalculator.h"
+#include "metricrecorder.h"
+#include "taskpool.h"
+#include "latencymonitor.h"
+
+#define CLI_FRAMES_PER_TASK_BATCH 32
+
+struct CliOptions {
+	unsigned int bitDepth;
+	unsigned int samplesPerLine;
+	unsigned int linesPerFrame;
+	QRect roi;
+	IMAGE_METRIC metric;
+	int threads;
+	bool binaryOutput;
+	QString outputFileName;
+};
+
+struct FrameResult {
+	bool calculated;
+	qreal value;
+	ImageStatistics stats;
+	MetricRecord record;
+};
+
+static bool parseMetric(QString text, IMAGE_METRIC* metric) {
+	QStringList names = {"sum", "average", "stddev", "coeffvar"};
+	int index = names.indexOf(text.toLower());
+	if(index < 0){
+		return false;
+	}
+	*metric = static_cast<IMAGE_METRIC>(index);
+	return true;
+}
+
+static bool parseRoi(QString text, QRect* roi) {
+	QStringList values = text.split(",");
+	if(values.size() != 4){
+		return false;
+	}
+	bool ok[4];
+	*roi = QRect(values.at(0).toInt(&ok[0]), values.at(1).toInt(&ok[1]), values.at(2).toInt(&ok[2]), values.at(3).toInt(&ok[3]));
+	return ok[0] && ok[1] && ok[2] && ok[3] && roi->width() > 0 && roi->height() > 0;
+}
+
+static void writeCsvHeader(QTextStream& out) {
+	out << "file,frame,pixels,sum,average,min,max,stddev,coeffvar,value\n";
+}
+
+static void writeCsvLine(QTextStream& out, const QString& fileName, qint64 frameNr, const FrameResult& result, bool hasDeviation) {
+	const ImageStatistics& stats = result.stats;
+	out << fileName << "," << frameNr << "," << stats.pixels << ","
+		<< QString::number(stats.sum, 'g', 17) << "," << QString::number(stats.average, 'g', 17) << ","
+		<< QString::number(stats.min, 'g', 17) << "," << QString::number(stats.max, 'g', 17) << ",";
+	//standard deviation and coefficient of variation are only calculated if the metric needs them
+	if(hasDeviation){
+		out << QString::number(stats.stdDeviation, 'g', 17) << "," << QString::number(stats.coeffOfVariation, 'g', 17);
+	}else{
+		out << ",";
+	}
+	out << "," << QString::number(result.value, 'g', 17) << "\n";
+}
+
+static bool processFile(const QString& fileName, const CliOptions& options, TaskPool* pool, QVector<ImageMetricCalculator*>& calculators, QTextStream* csv, MetricRecorder* recorder, quint64* sequenceNumber, QTextStream& err) {
+	QFile file(fileName);
+	if(!file.open(QFile::ReadOnly)){
+		err << "Could not open " << fileName << "\n";
+		return false;
+	}
+	size_t bytesPerSample = static_cast<size_t>(ceil(static_cast<double>(options.bitDepth)/8.0));
+	size_t bytesPerFrame = static_cast<size_t>(options.samplesPerLine)*options.linesPerFrame*bytesPerSample;
+	qint64 numberOfFrames = file.size()/static_cast<qint64>(bytesPerFrame);
+	if(file.size() % static_cast<qint64>(bytesPerFrame) != 0){
+		err << fileName << ": " << file.size() % static_cast<qint64>(bytesPerFrame) << " bytes at the end of the file do not form a complete frame and are ignored\n";
+	}
+	bool hasDeviation = options.metric == STDDEV || options.metric == COEFFVAR;
+
+	//the file is mapped in batches of frames, so the memory use does not depend on the file size.
+	//the frames of a batch are distributed over all cores, every chunk of the pool uses its own calculator
+	int framesPerBatch = qMax(1, pool->getThreadCount()*TASKPOOL_CHUNKS_PER_THREAD*CLI_FRAMES_PER_TASK_BATCH);
+	QVector<FrameResult> results(framesPerBatch);
+	for(qint64 firstFrame = 0; firstFrame < numberOfFrames; firstFrame += framesPerBatch){
+		int framesInBatch = static_cast<int>(qMin(static_cast<qint64>(framesPerBatch), numberOfFrames-firstFrame));
+		qint64 batchSize = static_cast<qint64>(framesInBatch)*static_cast<qint64>(bytesPerFrame);
+		uchar* batch = file.map(firstFrame*static_cast<qint64>(bytesPerFrame), batchSize);
+		if(batch == nullptr){
+			err << "Could not map " << fileName << "\n";
+			return false;
+		}
+		FrameResult* resultData = results.data();
+		quint64 firstSequenceNumber = *sequenceNumber;
+		pool->parallelFor(0, framesInBatch, 1, [&](int chunk, int begin, int end) {
+			ImageMetricCalculator* calculator = calculators.at(chunk);
+			for(int i = begin; i < end; i++){
+				FrameDescriptor frame;
+				frame.data = batch + static_cast<size_t>(i)*bytesPerFrame;
+				frame.pool = nullptr;
+				frame.slot = -1;
+				frame.sequenceNumber = firstSequenceNumber + static_cast<quint64>(i) + 1;
+				frame.source = REPLAY;
+				frame.bitDepth = options.bitDepth;
+				frame.samplesPerLine = options.samplesPerLine;
+				frame.linesPerFrame = options.linesPerFrame;
+				frame.bytesPerLine = static_cast<unsigned int>(options.samplesPerLine*bytesPerSample);
+				frame.bufferNr = 0;
+				frame.frameNr = static_cast<unsigned int>(firstFrame + i);
+				frame.configurationVersion = 0;
+				frame.imageMetric = options.metric;
+				frame.roi = options.roi;
+				frame.acquisitionTimestamp = 0;
+				frame.handoffTimestamp = 0;
+				FrameResult& result = resultData[i];
+				result.calculated = calculator->calculate(frame, &result.value);
+				result.stats = calculator->getStatistics();
+				if(recorder != nullptr){
+					result.record = calculator->createRecord(frame, result.value, LatencyMonitor::now());
+				}
+			}
+		});
+		file.unmap(batch);
+
+		//results are written in frame order
+		for(int i = 0; i < framesInBatch; i++){
+			const FrameResult& result = results.at(i);
+			if(!result.calculated){
+				continue;
+			}
+			if(csv != nullptr){
+				writeCsvLine(*csv, fileName, firstFrame+i, result, hasDeviation);
+			}
+			if(recorder != nullptr && !recorder->append(result.record)){
+				err << "Could not write to " << recorder->getFileName() << "\n";
+				return false;
+			}
+		}
+		*sequenceNumber += static_cast<quint64>(framesInBatch);
+		if(recorder != nullptr){
+			//prepares the next chunk of the recording file, a batch is always smaller than a chunk
+			recorder->maintain();
+		}
+	}
+	return true;
+}
+
+int main(int argc, char *argv[]) {
+	QCoreApplication app(argc, argv);
+	QCoreApplication::setApplicationName("signalmonitor-cli");
+	QTextStream err(stderr);
+
+	QCommandLineParser parser;
+	parser.setApplicationDescription("Calculates the image statistics of every frame of OCTproZ raw recordings.");
+	parser.addHelpOption();
+	parser.addPositionalArgument("files", "Raw recordings (frames without header).", "files...");
+	QCommandLineOption bitDepthOption({"b", "bitdepth"}, "Bit depth of the samples (1 - 32).", "bits");
+	QCommandLineOption samplesOption({"s", "samples"}, "Samples per line.", "samples");
+	QCommandLineOption linesOption({"l", "lines"}, "Lines per frame.", "lines");
+	QCommandLineOption roiOption({"r", "roi"}, "Region of interest x,y,width,height. Default: whole frame.", "roi");
+	QCommandLineOption metricOption({"m", "metric"}, "sum, average, stddev or coeffvar. Default: stddev (all statistics are calculated).", "metric", "stddev");
+	QCommandLineOption threadsOption({"t", "threads"}, "Number of threads. Default: all cores.", "threads");
+	QCommandLineOption formatOption({"f", "format"}, "csv or binary. Default: csv.", "format", "csv");
+	QCommandLineOption outputOption({"o", "output"}, "Output file. Default for csv: standard output.", "file");
+	parser.addOptions({bitDepthOption, samplesOption, linesOption, roiOption, metricOption, threadsOption, formatOption, outputOption});
+	parser.process(app);
+
+	CliOptions options;
+	bool ok[3];
+	options.bitDepth = parser.value(bitDepthOption).toUInt(&ok[0]);
+	options.samplesPerLine = parser.value(samplesOption).toUInt(&ok[1]);
+	options.linesPerFrame = parser.value(linesOption).toUInt(&ok[2]);
+	if(!ok[0] || !ok[1] || !ok[2] || options.bitDepth == 0 || options.bitDepth > 32 || options.samplesPerLine == 0 || options.linesPerFrame == 0){
+		err << "Bit depth (1 - 32), samples per line and lines per frame are required.\n";
+		return 1;
+	}
+	options.roi = QRect(0, 0, static_cast<int>(options.samplesPerLine), static_cast<int>(options.linesPerFrame));
+	if(parser.isSet(roiOption) && !parseRoi(parser.value(roiOption), &options.roi)){
+		err << "Invalid roi: " << parser.value(roiOption) << "\n";
+		return 1;
+	}
+	if(!parseMetric(parser.value(metricOption), &options.metric)){
+		err << "Invalid metric: " << parser.value(metricOption) << "\n";
+		return 1;
+	}
+	options.threads = parser.isSet(threadsOption) ? qMax(1, parser.value(threadsOption).toInt()) : 0;
+	options.binaryOutput = parser.value(formatOption).toLower() == "binary";
+	if(!options.binaryOutput && parser.value(formatOption).toLower() != "csv"){
+		err << "Invalid format: " << parser.value(formatOption) << "\n";
+		return 1;
+	}
+	options.outputFileName = parser.value(outputOption);
+	if(options.binaryOutput && options.outputFileName.isEmpty()){
+		err << "Binary output needs an output file.\n";
+		return 1;
+	}
+	QStringList files = parser.positionalArguments();
+	if(files.isEmpty()){
+		parser.showHelp(1);
+	}
+
+	//output
+	MetricRecorder recorder;
+	QFile csvFile;
+	QTextStream csv;
+	if(options.binaryOutput){
+		if(!recorder.open(options.outputFileName)){
+			err << "Could not open " << options.outputFileName << "\n";
+			return 1;
+		}
+	}else{
+		bool opened = false;
+		if(options.outputFileName.isEmpty()){
+			opened = csvFile.open(stdout, QFile::WriteOnly);
+		}else{
+			csvFile.setFileName(options.outputFileName);
+			opened = csvFile.open(QFile::WriteOnly|QFile::Truncate|QFile::Text);
+		}
+		if(!opened){
+			err << "Could not open " << options.outputFileName << "\n";
+			return 1;
+		}
+		csv.setDevice(&csvFile);
+		writeCsvHeader(csv);
+	}
+
+	//one calculator per chunk of the pool, the calculators do not use the pool themselves, every frame is processed by a single thread
+	TaskPool pool(options.threads);
+	pool.start();
+	QVector<ImageMetricCalculator*> calculators;
+	for(int i = 0; i < pool.getThreadCount()*TASKPOOL_CHUNKS_PER_THREAD; i++){
+		calculators.append(new ImageMetricCalculator());
+	}
+
+	int exitCode = 0;
+	quint64 sequenceNumber = 0;
+	qint64 startTimestamp = LatencyMonitor::now();
+	for(const QString& fileName : files){
+		if(!processFile(fileName, options, &pool, calculators, options.binaryOutput ? nullptr : &csv, options.binaryOutput ? &recorder : nullptr, &sequenceNumber, err)){
+			exitCode = 1;
+		}
+	}
+	double seconds = (LatencyMonitor::now() - startTimestamp)/1000000000.0;
+	err << sequenceNumber << " frames in " << QString::number(seconds, 'f', 2) << " s\n";
+
+	pool.stop();
+	qDeleteAll(calculators);
+	if(options.binaryOutput){
+		recorder.close();
+	}else{
+		csv.flush();
+	}
+	return exitCode;
+}
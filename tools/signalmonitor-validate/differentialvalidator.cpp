@@ -0,0 +1,202 @@
+#include "differentialvalidator.h"
+#include <cmath>
+#include <limits>
+#include <random>
+#include <string.h>
+
+
+DifferentialValidator::DifferentialValidator(TaskPool* taskPool)
+	: validatedCases(0),
+	failedCases(0)
+{
+	this->pooledCalculator.setTaskPool(taskPool);
+	this->converter.setTaskPool(taskPool);
+}
+
+bool DifferentialValidator::validate(const ValidationCase& validationCase) {
+	ReferenceStatistics reference = ReferenceMetric::calculateStatistics(validationCase.getFrame());
+	QStringList messages;
+	bool passed = this->validateMetric("metric serial", &this->serialCalculator, validationCase, reference, &messages);
+	passed = this->validateMetric("metric task pool", &this->pooledCalculator, validationCase, reference, &messages) && passed;
+	for(int kernel = 0; kernel < NUMBER_OF_CONVERSION_KERNELS; kernel++){
+		//the linear mapping of the full range is converted by the vectorized kernels, every kernel the cpu supports is checked
+		if(conversionKernelAvailable(static_cast<CONVERSION_KERNEL>(kernel))){
+			this->converter.setConversionKernel(static_cast<CONVERSION_KERNEL>(kernel));
+			QString path = QString("conversion full range %1").arg(conversionKernelName(static_cast<CONVERSION_KERNEL>(kernel)));
+			passed = this->validateConversion(validationCase, path, DisplayMapping::fullRange(), &messages) && passed;
+		}
+	}
+	this->converter.setConversionKernel(bestConversionKernel());
+	DisplayMapping mapping = randomMapping(validationCase);
+	passed = this->validateConversion(validationCase, "conversion window", mapping, &messages) && passed;
+
+	this->validatedCases++;
+	if(!passed){
+		this->failedCases++;
+		if(this->failures.size() < VALIDATE_MAXIMUM_REPORTED_FAILURES){
+			this->failures.append(validationCase.describe() + "\n    " + messages.join("\n    "));
+		}
+	}
+	return passed;
+}
+
+bool DifferentialValidator::validateMetric(const QString& path, ImageMetricCalculator* calculator, const ValidationCase& validationCase, const ReferenceStatistics& reference, QStringList* messages) {
+	const FrameDescriptor& frame = validationCase.getFrame();
+	qreal value = 0;
+	if(!calculator->calculate(frame, &value)){
+		messages->append(path + ": frame was not calculated");
+		return false;
+	}
+	const ImageStatistics& stats = calculator->getStatistics();
+	bool passed = this->compare(path, "pixels", stats.pixels, reference.pixels, VALIDATE_EXACT_RELATIVE_TOLERANCE, 1, messages);
+	if(reference.pixels == 0){
+		//only the number of pixels is defined for an empty roi
+		return passed;
+	}
+
+	long double fullScale = validationCase.getMaximumValue();
+	passed = this->compare(path, "min", stats.min, reference.min, VALIDATE_EXACT_RELATIVE_TOLERANCE, fullScale, messages) && passed;
+	passed = this->compare(path, "max", stats.max, reference.max, VALIDATE_EXACT_RELATIVE_TOLERANCE, fullScale, messages) && passed;
+	passed = this->compare(path, "sum", stats.sum, reference.sum, VALIDATE_SUM_RELATIVE_TOLERANCE, fullScale*reference.pixels, messages) && passed;
+	passed = this->compare(path, "average", stats.average, reference.average, VALIDATE_SUM_RELATIVE_TOLERANCE, fullScale, messages) && passed;
+	double metricTolerance = VALIDATE_SUM_RELATIVE_TOLERANCE;
+	long double metricScale = frame.imageMetric == SUM ? fullScale*reference.pixels : fullScale;
+	if(frame.imageMetric == STDDEV || frame.imageMetric == COEFFVAR){
+		//standard deviation and coefficient of variation are only calculated for these metrics
+		passed = this->compare(path, "stddev", stats.stdDeviation, reference.stdDeviation, VALIDATE_DEVIATION_RELATIVE_TOLERANCE, fullScale, messages) && passed;
+		passed = this->compare(path, "coeffvar", stats.coeffOfVariation, reference.coeffOfVariation, VALIDATE_DEVIATION_RELATIVE_TOLERANCE, 1, messages) && passed;
+		metricTolerance = VALIDATE_DEVIATION_RELATIVE_TOLERANCE;
+		metricScale = frame.imageMetric == COEFFVAR ? 1 : fullScale;
+	}
+	passed = this->compare(path, "metric value", value, ReferenceMetric::metricValue(reference, frame.imageMetric), metricTolerance, metricScale, messages) && passed;
+	return passed;
+}
+
+bool DifferentialValidator::validateConversion(const ValidationCase& validationCase, const QString& path, const DisplayMapping& mapping, QStringList* messages) {
+	//frames with up to 8 bit are passed on without conversion if the mapping does not change them
+	const FrameDescriptor& frame = validationCase.getFrame();
+	DisplayLookupTable lookupTable;
+	lookupTable.build(mapping, frame.bitDepth);
+	if(lookupTable.isIdentity()){
+		return true;
+	}
+	bool converted = false;
+	int maximumDifference = 0;
+	quint64 differentSamples = 0;
+	QMetaObject::Connection connection = QObject::connect(&this->converter, &BitDepthConverter::converted8bitData, &this->converter, [&](FrameDescriptor convertedFrame) {
+		//the converted frame is only valid during the emit
+		converted = true;
+		const uchar* output = static_cast<const uchar*>(convertedFrame.data);
+		for(unsigned int y = 0; y < frame.linesPerFrame; y++){
+			for(unsigned int x = 0; x < frame.samplesPerLine; x++){
+				//samples with more than 16 bit share a table entry with their neighbours, every value of the mapping between
+				//the first sample of the entry and the sample itself is correct
+				quint32 sample = ReferenceMetric::sampleAt(frame, static_cast<int>(x), static_cast<int>(y));
+				quint32 firstSample = lookupTable.getFirstSampleOfIndex(lookupTable.getIndex(sample));
+				int expected = ReferenceMetric::mapSampleTo8bit(sample, frame.bitDepth, mapping);
+				int expectedFirst = ReferenceMetric::mapSampleTo8bit(firstSample, frame.bitDepth, mapping);
+				int actual = output[static_cast<size_t>(y)*convertedFrame.bytesPerLine + x];
+				int difference = qMax(0, qMax(qMin(expected, expectedFirst) - actual, actual - qMax(expected, expectedFirst)));
+				maximumDifference = qMax(maximumDifference, difference);
+				differentSamples += difference > 0 ? 1 : 0;
+			}
+		}
+	}, Qt::DirectConnection);
+	this->converter.setDisplayMapping(mapping);
+	this->converter.convertDataTo8bit(frame);
+	QObject::disconnect(connection);
+
+	FieldReport& field = this->getField(path + "/samples");
+	quint64 samples = static_cast<quint64>(frame.samplesPerLine)*frame.linesPerFrame;
+	field.compared += samples;
+	field.maximumUlp = qMax(field.maximumUlp, static_cast<quint64>(maximumDifference));
+	if(!converted){
+		field.failed++;
+		messages->append(path + ": frame was not converted");
+		return false;
+	}
+	if(maximumDifference > VALIDATE_CONVERSION_TOLERANCE){
+		field.failed++;
+		messages->append(QString("%1 (level %2, window %3, gamma %4%5): %6 samples differ, maximum difference %7 steps").arg(path)
+			.arg(mapping.level, 0, 'g', 17).arg(mapping.window, 0, 'g', 17).arg(mapping.gamma).arg(mapping.logarithmic ? ", logarithmic" : "")
+			.arg(differentSamples).arg(maximumDifference));
+		return false;
+	}
+	return true;
+}
+
+DisplayMapping DifferentialValidator::randomMapping(const ValidationCase& validationCase) {
+	//window and level anywhere around the range of the bit depth, including windows of a few samples and windows beyond the range
+	std::mt19937_64 generator(validationCase.getSeed() ^ 0x9E3779B97F4A7C15ull);
+	std::uniform_real_distribution<double> unit(0.0, 1.0);
+	double maxValue = validationCase.getMaximumValue();
+	DisplayMapping mapping;
+	mapping.window = unit(generator) < 0.2 ? 0.0 : qMax(1.0, std::ldexp(maxValue, -static_cast<int>(unit(generator)*12.0))*unit(generator)*1.5);
+	mapping.level = (unit(generator)*1.2 - 0.1)*maxValue;
+	mapping.gamma = unit(generator) < 0.3 ? 1.0 : 0.2 + unit(generator)*4.8;
+	mapping.logarithmic = unit(generator) < 0.5;
+	return mapping;
+}
+
+bool DifferentialValidator::compare(const QString& path, const QString& field, double actual, long double expected, double relativeTolerance, long double fullScale, QStringList* messages) {
+	FieldReport& report = this->getField(path + "/" + field);
+	report.compared++;
+	bool bothNan = std::isnan(actual) && std::isnan(static_cast<double>(expected));
+	quint64 ulp = bothNan ? 0 : ulpDistance(actual, static_cast<double>(expected));
+	long double difference = std::fabs(static_cast<long double>(actual) - expected);
+	long double relativeError = bothNan ? 0 : (expected != 0 ? difference/std::fabs(expected) : difference/qMax(static_cast<long double>(1), fullScale));
+	if(std::isnan(static_cast<double>(relativeError))){
+		relativeError = std::numeric_limits<double>::infinity();
+	}
+	report.maximumUlp = qMax(report.maximumUlp, ulp);
+	report.maximumRelativeError = qMax(report.maximumRelativeError, static_cast<double>(relativeError));
+	if(ulp <= VALIDATE_MAXIMUM_ULP || relativeError <= relativeTolerance){
+		return true;
+	}
+	report.failed++;
+	messages->append(QString("%1 %2: %3, reference %4, %5 ulp, relative error %6").arg(path, field)
+		.arg(actual, 0, 'g', 17).arg(static_cast<double>(expected), 0, 'g', 17).arg(ulp).arg(static_cast<double>(relativeError), 0, 'g', 3));
+	return false;
+}
+
+FieldReport& DifferentialValidator::getField(const QString& name) {
+	for(FieldReport& field : this->fields){
+		if(field.name == name){
+			return field;
+		}
+	}
+	this->fields.append({name, 0, 0, 0, 0.0});
+	return this->fields.last();
+}
+
+quint64 DifferentialValidator::ulpDistance(double a, double b) {
+	//distance of the bit patterns, mapped so that the order of the integers is the order of the doubles
+	if(a == b){
+		return 0;
+	}
+	if(std::isnan(a) || std::isnan(b) || std::isinf(a) || std::isinf(b)){
+		return std::numeric_limits<quint64>::max();
+	}
+	qint64 bitsA;
+	qint64 bitsB;
+	memcpy(&bitsA, &a, sizeof(double));
+	memcpy(&bitsB, &b, sizeof(double));
+	if(bitsA < 0){
+		bitsA = std::numeric_limits<qint64>::min() - bitsA;
+	}
+	if(bitsB < 0){
+		bitsB = std::numeric_limits<qint64>::min() - bitsB;
+	}
+	return bitsA > bitsB ? static_cast<quint64>(bitsA) - static_cast<quint64>(bitsB) : static_cast<quint64>(bitsB) - static_cast<quint64>(bitsA);
+}
+
+void DifferentialValidator::printReport(QTextStream& out) const {
+	out << QString("%1 %2 %3 %4 %5").arg("path/field", -36).arg("compared", 12).arg("failed", 8).arg("max ulp", 22).arg("max rel. error", 14) << "\n";
+	for(const FieldReport& field : this->fields){
+		out << QString("%1 %2 %3 %4 %5").arg(field.name, -36).arg(field.compared, 12).arg(field.failed, 8).arg(field.maximumUlp, 22).arg(field.maximumRelativeError, 14, 'g', 3) << "\n";
+	}
+	for(const QString& failure : this->failures){
+		out << failure << "\n";
+	}
+	out << this->validatedCases << " cases, " << this->failedCases << " failed\n";
+}
@@ -0,0 +1,62 @@
+#ifndef DIFFERENTIALVALIDATOR_H
+#define DIFFERENTIALVALIDATOR_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QTextStream>
+#include "imagemetriccalculator.h"
+#include "bitdepthconverter.h"
+#include "referencemetric.h"
+#include "taskpool.h"
+#include "validationcase.h"
+
+//explicit tolerances of the optimized paths against the long double reference. a value passes if it is within the ulp
+//distance or within the relative tolerance. if the reference is 0, the error is taken relative to the full scale of the field
+#define VALIDATE_MAXIMUM_ULP 4
+#define VALIDATE_EXACT_RELATIVE_TOLERANCE 0.0 //pixels, min and max
+#define VALIDATE_SUM_RELATIVE_TOLERANCE 0.0 //sum and average, integer samples are summed exactly, only the ulp distance of the final rounding is accepted
+#define VALIDATE_DEVIATION_RELATIVE_TOLERANCE 1e-14 //standard deviation and coefficient of variation, the variance is exact before the square root
+#define VALIDATE_CONVERSION_TOLERANCE 1 //8 bit steps, the lookup table is built in double, the reference uses long double
+#define VALIDATE_MAXIMUM_REPORTED_FAILURES 20
+
+struct FieldReport {
+	QString name; //path/field
+	quint64 compared;
+	quint64 failed;
+	quint64 maximumUlp;
+	double maximumRelativeError;
+};
+
+//compares every optimized path with ReferenceMetric: the metric calculation without task pool, the metric calculation
+//with task pool (blocks of lines on several threads) and the bit depth conversion with task pool, for the full range of the
+//bit depth with every available vectorized kernel and for a random window, level, gamma and logarithmic mapping
+class DifferentialValidator
+{
+public:
+	explicit DifferentialValidator(TaskPool* taskPool);
+
+	bool validate(const ValidationCase& validationCase);
+	quint64 getValidatedCases() const {return this->validatedCases;}
+	quint64 getFailedCases() const {return this->failedCases;}
+	void printReport(QTextStream& out) const;
+
+	static quint64 ulpDistance(double a, double b);
+	static DisplayMapping randomMapping(const ValidationCase& validationCase);
+
+private:
+	ImageMetricCalculator serialCalculator;
+	ImageMetricCalculator pooledCalculator;
+	BitDepthConverter converter;
+	QVector<FieldReport> fields;
+	QStringList failures;
+	quint64 validatedCases;
+	quint64 failedCases;
+
+	bool validateMetric(const QString& path, ImageMetricCalculator* calculator, const ValidationCase& validationCase, const ReferenceStatistics& reference, QStringList* messages);
+	bool validateConversion(const ValidationCase& validationCase, const QString& path, const DisplayMapping& mapping, QStringList* messages);
+	bool compare(const QString& path, const QString& field, double actual, long double expected, double relativeTolerance, long double fullScale, QStringList* messages);
+	FieldReport& getField(const QString& name);
+};
+
+#endif //DIFFERENTIALVALIDATOR_H
@@ -0,0 +1,47 @@
+//differential validation of the optimized metric and conversion paths against the scalar long double reference (referencemetric.h).
+//random frames cover all bit depths, odd widths, padded lines, extreme values and roi shapes inside, across and outside the frame
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QTextStream>
+#include "differentialvalidator.h"
+#include "validationcase.h"
+#include "taskpool.h"
+
+int main(int argc, char *argv[]) {
+	QCoreApplication app(argc, argv);
+	QCoreApplication::setApplicationName("signalmonitor-validate");
+	QTextStream out(stdout);
+
+	QCommandLineParser parser;
+	parser.setApplicationDescription("Compares the metric calculation and the bit depth conversion with a scalar long double reference.");
+	parser.addHelpOption();
+	QCommandLineOption casesOption({"n", "cases"}, "Number of random cases. Default: 2000.", "cases", "2000");
+	QCommandLineOption seedOption("seed", "Seed of the first case, the following cases use the next seeds. Default: 1.", "seed", "1");
+	QCommandLineOption caseOption("case", "Only validate the case with this seed, e.g. to repeat a reported failure.", "seed");
+	QCommandLineOption threadsOption({"t", "threads"}, "Threads of the task pool. Default: 4.", "threads", "4");
+	QCommandLineOption samplesOption("max-samples", "Maximum samples per line. Default: 2049.", "samples", "2049");
+	QCommandLineOption linesOption("max-lines", "Maximum lines per frame. Default: 512.", "lines", "512");
+	parser.addOptions({casesOption, seedOption, caseOption, threadsOption, samplesOption, linesOption});
+	parser.process(app);
+
+	//the task pool splits frames into blocks of lines, at least 2 threads are needed to validate the combination of the blocks
+	TaskPool pool(qMax(2, parser.value(threadsOption).toInt()));
+	pool.start();
+	DifferentialValidator validator(&pool);
+	unsigned int maximumSamplesPerLine = parser.value(samplesOption).toUInt();
+	unsigned int maximumLinesPerFrame = parser.value(linesOption).toUInt();
+	quint64 firstSeed = parser.isSet(caseOption) ? parser.value(caseOption).toULongLong() : parser.value(seedOption).toULongLong();
+	quint64 numberOfCases = parser.isSet(caseOption) ? 1 : parser.value(casesOption).toULongLong();
+	for(quint64 i = 0; i < numberOfCases; i++){
+		ValidationCase validationCase(firstSeed + i, maximumSamplesPerLine, maximumLinesPerFrame);
+		if(parser.isSet(caseOption)){
+			out << validationCase.describe() << "\n";
+		}
+		validator.validate(validationCase);
+	}
+	pool.stop();
+
+	validator.printReport(out);
+	return validator.getFailedCases() == 0 ? 0 : 1;
+}
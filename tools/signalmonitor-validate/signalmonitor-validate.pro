@@ -0,0 +1,41 @@
+QT = core
+QMAKE_PROJECT_DEPTH = 0
+
+TARGET = signalmonitor-validate
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle
+
+DEFINES += \
+	QT_DEPRECATED_WARNINGS #emit warnings if depracted Qt features are used
+
+SOURCES += \
+	main.cpp \
+	validationcase.cpp \
+	differentialvalidator.cpp
+
+HEADERS += \
+	validationcase.h \
+	differentialvalidator.h
+
+INCLUDEPATH += \
+	../../src
+
+#link the static core library that is built by tools/signalmonitorcore
+CORE_BUILD_DIR = $$shell_path($$OUT_PWD/../signalmonitorcore)
+win32{
+	CONFIG(debug, debug|release) {
+		CORE_LIBRARY = $$shell_path($$CORE_BUILD_DIR/debug/signalmonitorcore.lib)
+	}
+	CONFIG(release, debug|release) {
+		CORE_LIBRARY = $$shell_path($$CORE_BUILD_DIR/release/signalmonitorcore.lib)
+	}
+}
+unix{
+	CORE_LIBRARY = $$shell_path($$CORE_BUILD_DIR/libsignalmonitorcore.a)
+}
+LIBS += $$CORE_LIBRARY
+unix{
+	LIBS += -lpthread
+}
+PRE_TARGETDEPS += $$CORE_LIBRARY
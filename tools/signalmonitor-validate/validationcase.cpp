@@ -0,0 +1,124 @@
+#include "validationcase.h"
+#include <QStringList>
+#include <random>
+#include <string.h>
+
+
+ValidationCase::ValidationCase(quint64 seed, unsigned int maximumSamplesPerLine, unsigned int maximumLinesPerFrame)
+	: seed(seed)
+{
+	std::mt19937_64 generator(seed);
+	auto randomInt = [&generator](int minimum, int maximum) {
+		return std::uniform_int_distribution<int>(minimum, maximum)(generator);
+	};
+
+	//dimensions: every bit depth, odd widths and lines with padding
+	unsigned int bitDepth = static_cast<unsigned int>(randomInt(1, 32));
+	unsigned int bytesPerSample = bitDepth <= 8 ? 1 : (bitDepth <= 16 ? 2 : 4);
+	unsigned int samplesPerLine = static_cast<unsigned int>(randomInt(1, static_cast<int>(qMax(1u, maximumSamplesPerLine))));
+	unsigned int linesPerFrame = static_cast<unsigned int>(randomInt(1, static_cast<int>(qMax(1u, maximumLinesPerFrame))));
+	unsigned int paddingSamples = randomInt(0, 3) == 0 ? static_cast<unsigned int>(randomInt(1, 7)) : 0;
+	unsigned int bytesPerLine = (samplesPerLine + paddingSamples)*bytesPerSample;
+	this->maximumValue = bitDepth == 32 ? 0xFFFFFFFF : (1u << bitDepth) - 1;
+	size_t bytes = static_cast<size_t>(bytesPerLine)*linesPerFrame;
+	this->storage.resize(static_cast<int>((bytes+3)/4));
+	uchar* data = reinterpret_cast<uchar*>(this->storage.data());
+	memset(data, 0xA5, static_cast<size_t>(this->storage.size())*4);
+
+	//samples
+	this->pattern = static_cast<VALUE_PATTERN>(randomInt(0, NUMBER_OF_VALUE_PATTERNS-1));
+	std::uniform_int_distribution<quint32> uniform(0, this->maximumValue);
+	std::uniform_int_distribution<quint32> narrow(this->maximumValue - qMin(this->maximumValue, 3u), this->maximumValue);
+	for(unsigned int y = 0; y < linesPerFrame; y++){
+		uchar* line = data + static_cast<size_t>(y)*bytesPerLine;
+		for(unsigned int x = 0; x < samplesPerLine; x++){
+			quint32 value = 0;
+			switch(this->pattern){
+				case VALUES_UNIFORM: value = uniform(generator); break;
+				case VALUES_ZERO: value = 0; break;
+				case VALUES_MAXIMUM: value = this->maximumValue; break;
+				case VALUES_ALTERNATING: value = (x+y) % 2 == 0 ? 0 : this->maximumValue; break;
+				case VALUES_SPIKES: value = randomInt(0, 999) == 0 ? this->maximumValue : (uniform(generator) & 0xF); break;
+				case VALUES_NARROW: value = narrow(generator); break;
+				default: value = 0;
+			}
+			switch(bytesPerSample){
+				case 1: line[x] = static_cast<uchar>(value); break;
+				case 2: reinterpret_cast<quint16*>(line)[x] = static_cast<quint16>(value); break;
+				default: reinterpret_cast<quint32*>(line)[x] = value;
+			}
+		}
+	}
+
+	//roi
+	int width = static_cast<int>(samplesPerLine);
+	int height = static_cast<int>(linesPerFrame);
+	this->roiShape = static_cast<ROI_SHAPE>(randomInt(0, NUMBER_OF_ROI_SHAPES-1));
+	QRect roi(0, 0, width, height);
+	switch(this->roiShape){
+		case ROI_FULL: break;
+		case ROI_INSIDE: {
+			int x = randomInt(0, width-1);
+			int y = randomInt(0, height-1);
+			roi = QRect(x, y, randomInt(1, width-x), randomInt(1, height-y));
+			break;
+		}
+		case ROI_PARTIALLY_OUTSIDE: roi = QRect(randomInt(-width, width-1), randomInt(-height, height-1), randomInt(1, 2*width), randomInt(1, 2*height)); break;
+		case ROI_SINGLE_PIXEL: roi = QRect(randomInt(0, width-1), randomInt(0, height-1), 1, 1); break;
+		case ROI_SINGLE_LINE: roi = QRect(0, randomInt(0, height-1), width, 1); break;
+		case ROI_SINGLE_COLUMN: roi = QRect(randomInt(0, width-1), 0, 1, height); break;
+		case ROI_OUTSIDE: roi = randomInt(0, 1) == 0 ? QRect(width + randomInt(0, 10), 0, 10, height) : QRect(0, -randomInt(1, 10)-10, width, 10); break;
+		default: break;
+	}
+
+	this->frame.data = data;
+	this->frame.pool = nullptr;
+	this->frame.slot = -1;
+	this->frame.sequenceNumber = seed;
+	this->frame.source = REPLAY;
+	this->frame.bitDepth = bitDepth;
+	this->frame.samplesPerLine = samplesPerLine;
+	this->frame.linesPerFrame = linesPerFrame;
+	this->frame.bytesPerLine = bytesPerLine;
+	this->frame.bufferNr = 0;
+	this->frame.frameNr = 0;
+	this->frame.configurationVersion = 0;
+	this->frame.imageMetric = static_cast<IMAGE_METRIC>(randomInt(SUM, COEFFVAR));
+	this->frame.roi = roi;
+	this->frame.acquisitionTimestamp = 0;
+	this->frame.handoffTimestamp = 0;
+}
+
+QString ValidationCase::describe() const {
+	const QRect& roi = this->frame.roi;
+	QStringList metricNames = {"sum", "average", "stddev", "coeffvar"};
+	return QString("case %1: %2 bit, %3 x %4 samples, %5 bytes per line, %6 values, roi %7 (%8, %9, %10 x %11), metric %12")
+		.arg(this->seed).arg(this->frame.bitDepth).arg(this->frame.samplesPerLine).arg(this->frame.linesPerFrame).arg(this->frame.bytesPerLine)
+		.arg(patternName(this->pattern)).arg(roiShapeName(this->roiShape)).arg(roi.x()).arg(roi.y()).arg(roi.width()).arg(roi.height())
+		.arg(metricNames.value(static_cast<int>(this->frame.imageMetric)));
+}
+
+QString ValidationCase::patternName(VALUE_PATTERN pattern) {
+	switch(pattern){
+		case VALUES_UNIFORM: return "uniform";
+		case VALUES_ZERO: return "zero";
+		case VALUES_MAXIMUM: return "maximum";
+		case VALUES_ALTERNATING: return "alternating";
+		case VALUES_SPIKES: return "spikes";
+		case VALUES_NARROW: return "narrow";
+		default: return "unknown";
+	}
+}
+
+QString ValidationCase::roiShapeName(ROI_SHAPE shape) {
+	switch(shape){
+		case ROI_FULL: return "full";
+		case ROI_INSIDE: return "inside";
+		case ROI_PARTIALLY_OUTSIDE: return "partially outside";
+		case ROI_SINGLE_PIXEL: return "single pixel";
+		case ROI_SINGLE_LINE: return "single line";
+		case ROI_SINGLE_COLUMN: return "single column";
+		case ROI_OUTSIDE: return "outside";
+		default: return "unknown";
+	}
+}
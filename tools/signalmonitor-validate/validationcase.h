@@ -0,0 +1,53 @@
+#ifndef VALIDATIONCASE_H
+#define VALIDATIONCASE_H
+
+#include <QString>
+#include <QVector>
+#include "framedescriptor.h"
+
+enum VALUE_PATTERN {
+	VALUES_UNIFORM,
+	VALUES_ZERO,
+	VALUES_MAXIMUM,
+	VALUES_ALTERNATING, //0 and maximum
+	VALUES_SPIKES, //low values with a few maximum values
+	VALUES_NARROW, //values close to the maximum, small deviation relative to the mean
+	NUMBER_OF_VALUE_PATTERNS
+};
+
+enum ROI_SHAPE {
+	ROI_FULL,
+	ROI_INSIDE,
+	ROI_PARTIALLY_OUTSIDE,
+	ROI_SINGLE_PIXEL,
+	ROI_SINGLE_LINE,
+	ROI_SINGLE_COLUMN,
+	ROI_OUTSIDE,
+	NUMBER_OF_ROI_SHAPES
+};
+
+//random frame, roi and metric for the differential validation. a case is completely defined by its seed, so a failing case
+//can be repeated with --case. lines may have padding at the end, the padding contains values that must never be used
+class ValidationCase
+{
+public:
+	ValidationCase(quint64 seed, unsigned int maximumSamplesPerLine, unsigned int maximumLinesPerFrame);
+
+	const FrameDescriptor& getFrame() const {return this->frame;}
+	quint64 getSeed() const {return this->seed;}
+	quint32 getMaximumValue() const {return this->maximumValue;}
+	QString describe() const;
+
+	static QString patternName(VALUE_PATTERN pattern);
+	static QString roiShapeName(ROI_SHAPE shape);
+
+private:
+	quint64 seed;
+	VALUE_PATTERN pattern;
+	ROI_SHAPE roiShape;
+	quint32 maximumValue;
+	QVector<quint32> storage;
+	FrameDescriptor frame;
+};
+
+#endif //VALIDATIONCASE_H
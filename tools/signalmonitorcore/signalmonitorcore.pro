@@ -0,0 +1,11 @@
+QT = core
+QMAKE_PROJECT_DEPTH = 0
+
+TARGET = signalmonitorcore
+TEMPLATE = lib
+CONFIG += staticlib
+
+DEFINES += \
+	QT_DEPRECATED_WARNINGS #emit warnings if depracted Qt features are used
+
+include(../../src/signalmonitorcore.pri)
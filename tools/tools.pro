@@ -0,0 +1,16 @@
+#tools of the signal monitor that are built without OCTproZ: qmake tools.pro && make
+#signalmonitorcore, signalmonitor-cli and signalmonitor-validate only need QtCore, signalmonitor-bench needs QtWidgets, hostsimulator needs the OCTproZ_DevKit like the extension
+
+TEMPLATE = subdirs
+
+SUBDIRS += \
+	signalmonitorcore \
+	signalmonitor-cli \
+	signalmonitor-bench \
+	signalmonitor-validate \
+	hostsimulator
+
+signalmonitor-cli.depends = signalmonitorcore
+signalmonitor-bench.depends = signalmonitorcore
+signalmonitor-validate.depends = signalmonitorcore
+hostsimulator.depends = signalmonitorcore